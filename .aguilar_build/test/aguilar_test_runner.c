@@ -0,0 +1,181 @@
+// NOTE: Generated by Aguilar, do not edit.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+typedef struct { const char* name; const char* file; void (*fn)(void); } aguilar_test_t;
+
+void test_spsc_stress(void);
+void test_mpmc_stress(void);
+void test_seqlock_torn_reads(void);
+void test_simd_f32_matches_scalar(void);
+void test_simd_bytes_match_scalar(void);
+void test_line_reader_long_lines_and_crlf(void);
+void test_file_read_batch_uring(void);
+void test_file_read_batch_pread(void);
+void test_loop_timers(void);
+void test_loop_read_timeout(void);
+void test_loop_connect_refused(void);
+void test_large_project_build(void);
+void test_find_tests_long_lines_and_crlf(void);
+
+static aguilar_test_t aguilar_tests[] = {
+    { "test_spsc_stress", "tests/awn_test.c", test_spsc_stress },
+    { "test_mpmc_stress", "tests/awn_test.c", test_mpmc_stress },
+    { "test_seqlock_torn_reads", "tests/awn_test.c", test_seqlock_torn_reads },
+    { "test_simd_f32_matches_scalar", "tests/awn_test.c", test_simd_f32_matches_scalar },
+    { "test_simd_bytes_match_scalar", "tests/awn_test.c", test_simd_bytes_match_scalar },
+    { "test_line_reader_long_lines_and_crlf", "tests/awn_test.c", test_line_reader_long_lines_and_crlf },
+    { "test_file_read_batch_uring", "tests/awn_test.c", test_file_read_batch_uring },
+    { "test_file_read_batch_pread", "tests/awn_test.c", test_file_read_batch_pread },
+    { "test_loop_timers", "tests/awn_test.c", test_loop_timers },
+    { "test_loop_read_timeout", "tests/awn_test.c", test_loop_read_timeout },
+    { "test_loop_connect_refused", "tests/awn_test.c", test_loop_connect_refused },
+    { "test_large_project_build", "tests/build_test.c", test_large_project_build },
+    { "test_find_tests_long_lines_and_crlf", "tests/build_test.c", test_find_tests_long_lines_and_crlf },
+};
+static double aguilar_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+typedef struct { int index; pid_t pid; double start; double ms; int status; } aguilar_result_t;
+
+static int aguilar_compare_results(const void* a, const void* b)
+{
+    double x = ((const aguilar_result_t*)a)->ms;
+    double y = ((const aguilar_result_t*)b)->ms;
+    return (x < y) - (x > y);
+}
+
+int main(int argc, char** argv)
+{
+    int count = (int)(sizeof(aguilar_tests) / sizeof(aguilar_tests[0]));
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int shard = 1, shards = 1, list = 0;
+    double slow_ms = 1000.0;
+    long timeout_ms = 0;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0) list = 1;
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobs = atol(argv[++i]);
+        else if (strcmp(argv[i], "--slow") == 0 && i + 1 < argc) slow_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) timeout_ms = atol(argv[++i]);
+        else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d/%d", &shard, &shards) != 2 || shards < 1 || shard < 1 || shard > shards) {
+                fprintf(stderr, "Expected --shard I/N with 1 <= I <= N\n");
+                return 2;
+            }
+        }
+        else filter = argv[i];
+    }
+
+    if (jobs < 1) jobs = 1;
+
+    aguilar_result_t* results = calloc(count + 1, sizeof(aguilar_result_t));
+    int* slots = calloc(jobs, sizeof(int));
+    int selected = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (i % shards != shard - 1) continue;
+        if (filter != NULL && strstr(aguilar_tests[i].name, filter) == NULL) continue;
+        results[selected++].index = i;
+    }
+
+    if (list) {
+        for (int i = 0; i < selected; i++) {
+            printf("%s (%s)\n", aguilar_tests[results[i].index].name, aguilar_tests[results[i].index].file);
+        }
+        return 0;
+    }
+
+    int next = 0, running = 0, failed = 0, slow = 0;
+    double start = aguilar_now_ms();
+
+    while (next < selected || running > 0) {
+        while (running < jobs && next < selected) {
+            aguilar_result_t* result = &results[next];
+
+            fflush(stdout);
+            fflush(stderr);
+
+            result->start = aguilar_now_ms();
+            result->pid = fork();
+
+            if (result->pid == 0) {
+                if (timeout_ms > 0) {
+                    struct itimerval timer = { { 0, 0 }, { timeout_ms / 1000, (timeout_ms % 1000) * 1000 } };
+                    setitimer(ITIMER_REAL, &timer, NULL);
+                }
+                aguilar_tests[result->index].fn();
+                fflush(stdout);
+                _exit(0);
+            }
+
+            for (int s = 0; s < jobs; s++) {
+                if (slots[s] == 0) { slots[s] = next + 1; break; }
+            }
+
+            next++;
+            running++;
+        }
+
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid < 0) break;
+
+        for (int s = 0; s < jobs; s++) {
+            if (slots[s] == 0 || results[slots[s] - 1].pid != pid) continue;
+
+            aguilar_result_t* result = &results[slots[s] - 1];
+            slots[s] = 0;
+            running--;
+
+            result->ms = aguilar_now_ms() - result->start;
+            result->status = status;
+
+            const char* name = aguilar_tests[result->index].name;
+
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                printf("PASS %9.2f ms  %s%s\n", result->ms, name, result->ms >= slow_ms ? "  [slow]" : "");
+            } else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM && timeout_ms > 0) {
+                printf("FAIL %9.2f ms  %s  (timed out)\n", result->ms, name);
+                failed++;
+            } else if (WIFSIGNALED(status)) {
+                printf("FAIL %9.2f ms  %s  (%s)\n", result->ms, name, strsignal(WTERMSIG(status)));
+                failed++;
+            } else {
+                printf("FAIL %9.2f ms  %s  (exit code %d)\n", result->ms, name, WEXITSTATUS(status));
+                failed++;
+            }
+
+            slow += result->ms >= slow_ms;
+            break;
+        }
+    }
+
+    double total_ms = aguilar_now_ms() - start;
+    double serial_ms = 0;
+    for (int i = 0; i < selected; i++) serial_ms += results[i].ms;
+
+    qsort(results, selected, sizeof(aguilar_result_t), aguilar_compare_results);
+
+    printf("\nSlowest tests:\n");
+    for (int i = 0; i < selected && i < 10; i++) {
+        printf("  %9.2f ms  %s\n", results[i].ms, aguilar_tests[results[i].index].name);
+    }
+
+    printf("\n%d passed, %d failed, %d slow (>= %.0f ms), shard %d/%d, %.1f ms wall, %.1f ms total.\n",
+            selected - failed, failed, slow, slow_ms, shard, shards, total_ms, serial_ms);
+
+    return failed ? 1 : 0;
+}
@@ -6,8 +6,13 @@
         - new [name]: Create a new project based on a predefined template.
         - build (file): Build either a file or a project based on whether it can find a config file.
         - sync: Update an existing repository with any changes made to template files.   
-        - run [file]: Build a single file (application is stored in a cache) and run it.
+        - serve: Keep a per-user daemon running that answers warm runs and no-op builds over a Unix socket.
+        - run (--profile|--mem) [file]: Build a single file (application is stored in a cache) and run it, optionally under a sampling profiler or memory report.
         - install: Install the application in the user's bin folder.
+        - test [filter] (--jobs N) (--shard I/N) (--slow MS) (--timeout MS) (--list): Build and run every test_ function in parallel.
+        - cache [stats|gc|clear]: Inspect or trim the shared compile cache (AGUILAR_CACHE_DIR).
+        - worker (port) (address): Compile preprocessed sources sent by builds with AGUILAR_WORKERS set.
+        - bench (--sizes 1,10,100,1000) (--runs N) (--out FILE) (--micro) (--keep) (--profile): Benchmark Aguilar on generated projects and write the results as JSON.
         - help: Print everything you need to know.
         - zen: Print a zen of code.
 */
@@ -16,16 +21,42 @@
 
 // WARNING(Alex): This only works on Linux (Maybe MacOS?).
 
+#define _GNU_SOURCE
+
 #define AWN_IMPLEMENTATION
 #include "awn.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <ctype.h>
+#include <endian.h>
 #include <dirent.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <elf.h>
+#include <linux/fs.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
 
 #define AGUILAR_VERSION "0.1"
 
@@ -35,8 +66,7 @@
 #error Mac OS not supported!
 #elif (defined(linux) || defined(__linux) || defined(__linux__))
 
-    #define CACHE_OUT_PATH "~/.cache/aguilar_program.out"
-    #define CACHE_CONFIG_PATH "/.cache/aguilar_program.cache"
+    #define CACHE_RUN_PATH "/.cache/aguilar/run"
 
 #endif
 
@@ -58,6 +88,12 @@ function bool Aguilar_FileExists(const char* file, struct stat *sb)
     return true;
 }
 
+// NOTE(Alex): Nanosecond resolution, so two writes within the same second are still told apart.
+function i64 Aguilar_ModTime(struct stat *sb)
+{
+    return (i64)sb->st_mtim.tv_sec * 1000000000 + sb->st_mtim.tv_nsec;
+}
+
 #define ERROR_STR_LEN 1024
 char __error[ERROR_STR_LEN] = { 0 };
 
@@ -73,6 +109,24 @@ function char* Aguilar_GetError()
     return __error;
 }
 
+// NOTE(Alex): printf into fresh arena memory that is exactly big enough.
+function char* Aguilar_Format(arena_t *arena, const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    char* result = AWN_ArenaPush(arena, sizeof(char) * (length + 1));
+
+    va_start(args, format);
+    vsnprintf(result, length + 1, format, args);
+    va_end(args);
+
+    return result;
+}
+
 #define ENV_COMPILER "AGUILAR_COMPILER"
 
 function char* Aguilar_GetCompilerEnv()
@@ -92,6 +146,487 @@ function char* Aguilar_GetCompilerEnv()
     return "gcc";
 }
 
+// NOTE(Alex): TCC only ever compiles `run` scripts in process (see Aguilar_RunTcc), anything
+//              that needs a compiler driver still gets gcc from Aguilar_GetCompilerEnv.
+function bool Aguilar_CompilerIsTcc()
+{
+    const char* env = getenv(ENV_COMPILER);
+    return env != NULL and (strcmp(env, "TCC") == 0 or strcmp(env, "tcc") == 0);
+}
+
+#define TEMPLATE_DATA_PATH "/.local/bin/Aguilar_data"
+#define TEMPLATE_MAIN_FILE "main.c"
+#define SYNC_MANIFEST_FILE ".aguilar_sync"
+
+// NOTE(Alex): FNV-1a, good enough to detect changed files and to key caches.
+#define HASH_SEED 0xcbf29ce484222325ULL
+
+function u64 Aguilar_HashBytes(u64 hash, const void* data, usize size)
+{
+    const u8* bytes = data;
+    for (usize i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+function u64 Aguilar_HashString(u64 hash, const char* str)
+{
+    return Aguilar_HashBytes(hash, str, strlen(str) + 1);
+}
+
+// NOTE(Alex): FNV-1a with 128 bits, for the shared caches. Everyone pointing at a cache is
+//              handed its entries, so a collision there serves someone else's executable.
+typedef unsigned __int128 u128;
+#define HASH128_SEED (((u128)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL)
+#define HASH128_PRIME (((u128)0x0000000001000000ULL << 64) | 0x000000000000013bULL)
+
+function u128 Aguilar_Hash128Bytes(u128 hash, const void* data, usize size)
+{
+    const u8* bytes = data;
+    for (usize i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= HASH128_PRIME;
+    }
+    return hash;
+}
+
+function int Aguilar_HashFile(const char* path, u64* hash)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        Aguilar_SetError("Failed to open file for hashing!");
+        return -1;
+    }
+
+    u8 buffer[KB(64)];
+    u64 result = HASH_SEED;
+    ssize_t count;
+
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+        result = Aguilar_HashBytes(result, buffer, count);
+    }
+
+    close(fd);
+
+    if (count < 0) {
+        Aguilar_SetError("Failed to read file for hashing!");
+        return -1;
+    }
+
+    *hash = result;
+    return 0;
+}
+
+// NOTE(Alex): Temporaries carry host and pid, so concurrent writers (even on other
+//              machines sharing an NFS cache) never pick the same name.
+function bool Aguilar_FormatTempPath(char* buffer, usize buffer_size, const char* path)
+{
+    local_persist char host[64] = { 0 };
+    if (host[0] == '\0' and gethostname(host, sizeof(host) - 1) != 0) {
+        strcpy(host, "localhost");
+    }
+
+    return snprintf(buffer, buffer_size, "%s.tmp.%s.%d", path, host, getpid()) < (int)buffer_size;
+}
+
+// NOTE(Alex): Copies into a temporary next to the destination and renames it into place,
+//              so readers never see a half written file. Tries a reflink first, then
+//              copy_file_range (both stay in the kernel), then a plain read/write loop.
+function int Aguilar_CopyFile(const char* from, const char* to, mode_t mode)
+{
+    int in = open(from, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        Aguilar_SetError("Failed to open file for copying!");
+        return -1;
+    }
+
+    char tmp[PATH_MAX];
+    if (!Aguilar_FormatTempPath(tmp, sizeof(tmp), to)) {
+        close(in);
+        Aguilar_SetError("Path is too long!");
+        return -1;
+    }
+
+    int out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode & 07777);
+    if (out < 0) {
+        close(in);
+        Aguilar_SetError("Failed to create file while copying!");
+        return -1;
+    }
+
+    bool done = (ioctl(out, FICLONE, in) == 0);
+
+    if (!done) {
+        ssize_t count;
+        while ((count = copy_file_range(in, 0, out, 0, MB(64), 0)) > 0);
+
+        if (count == 0) {
+            done = true;
+        } else if (errno == EXDEV or errno == ENOSYS or errno == EINVAL or errno == EOPNOTSUPP) {
+            // NOTE(Alex): Nothing can have been copied for these, so just start over with read/write.
+            //              Both offsets are rewound anyway, a copy that cannot start from
+            //              the top would be silently short.
+            u8 buffer[KB(64)];
+            done = lseek(in, 0, SEEK_SET) == 0 and lseek(out, 0, SEEK_SET) == 0 and ftruncate(out, 0) == 0;
+
+            while (done and (count = read(in, buffer, sizeof(buffer))) > 0) {
+                if (write(out, buffer, count) != count) {
+                    done = false;
+                    break;
+                }
+            }
+
+            if (count < 0) {
+                done = false;
+            }
+        }
+    }
+
+    close(in);
+    fchmod(out, mode & 07777);
+
+    if (close(out) != 0 or !done or rename(tmp, to) != 0) {
+        unlink(tmp);
+        Aguilar_SetError("Failed to copy file!");
+        return -1;
+    }
+
+    return 0;
+}
+
+// NOTE(Alex): Creates every missing directory along the path, like mkdir -p.
+function int Aguilar_MakeDirs(const char* path)
+{
+    char buffer[PATH_MAX];
+    if (snprintf(buffer, sizeof(buffer), "%s", path) >= (int)sizeof(buffer)) {
+        Aguilar_SetError("Path is too long!");
+        return -1;
+    }
+
+    for (char* c = buffer + 1; ; c++) {
+        if (*c == '/' or *c == '\0') {
+            char end = *c;
+            *c = '\0';
+
+            if (mkdir(buffer, S_IRWXU | S_IRWXG | S_IRWXO) != 0 and errno != EEXIST) {
+                Aguilar_SetError("System failed to create new directory!");
+                return -1;
+            }
+
+            *c = end;
+            if (end == '\0') {
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// NOTE(Alex): Searches PATH the same way the shell would, returns NULL when not found.
+function char* Aguilar_FindInPath(arena_t *arena, const char* name)
+{
+    if (strchr(name, '/') != NULL) {
+        return access(name, X_OK) == 0 ? (char*)name : NULL;
+    }
+
+    const char* path_env = getenv("PATH");
+    if (path_env == NULL) {
+        return NULL;
+    }
+
+    const char* start = path_env;
+    while (*start != '\0') {
+        const char* end = strchr(start, ':');
+        usize length = end ? (usize)(end - start) : strlen(start);
+
+        char candidate[PATH_MAX];
+        if (length > 0 and snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)length, start, name) < (int)sizeof(candidate)
+                and access(candidate, X_OK) == 0) {
+            char* result = AWN_ArenaPush(arena, strlen(candidate) + 1);
+            memcpy(result, candidate, strlen(candidate));
+            return result;
+        }
+
+        if (end == NULL) {
+            break;
+        }
+
+        start = end + 1;
+    }
+
+    return NULL;
+}
+
+function char* Aguilar_FormatDataPath(arena_t *arena)
+{
+    const char* home = getenv("HOME");
+    if (home == NULL) {
+        Aguilar_SetError("Failed to get home directory!");
+        return NULL;
+    }
+
+    char* data_path = AWN_ArenaPush(arena, sizeof(char) * (strlen(home) + strlen(TEMPLATE_DATA_PATH) + 1));
+    sprintf(data_path, "%s%s", home, TEMPLATE_DATA_PATH);
+
+    return data_path;
+}
+
+// NOTE(Alex): The sync manifest remembers what every template file looked like the last
+//              time it was copied, so unchanged files are skipped without reading them.
+STRUCT(sync_entry_t)
+{
+    char* path;
+    u64 hash;
+    u64 size;
+    i64 template_mtime;
+    i64 dest_mtime;
+};
+
+STRUCT(sync_state_t)
+{
+    sync_entry_t* entries;
+    int count;
+    int cap;
+
+    sync_entry_t* old_entries;
+    int old_count;
+
+    int copied;
+    int unchanged;
+};
+
+function void Aguilar_SyncReadManifest(arena_t *arena, sync_state_t *state, const char* manifest_path)
+{
+    FILE* manifest = fopen(manifest_path, "r");
+    if (manifest == NULL) {
+        return;
+    }
+
+    int cap = 64;
+    state->old_entries = AWN_ArenaPush(arena, sizeof(sync_entry_t) * cap);
+
+    char line[PATH_MAX + 128];
+    while (fgets(line, sizeof(line), manifest) != NULL) {
+        sync_entry_t entry = { 0 };
+        int path_offset = 0;
+
+        if (sscanf(line, "%lx %lu %ld %ld %n", &entry.hash, &entry.size, &entry.template_mtime, &entry.dest_mtime, &path_offset) != 4) {
+            continue;
+        }
+
+        char* path = line + path_offset;
+        path[strcspn(path, "\n")] = '\0';
+
+        entry.path = AWN_ArenaPush(arena, strlen(path) + 1);
+        memcpy(entry.path, path, strlen(path));
+
+        if (state->old_count == cap) {
+            state->old_entries = AWN_ArenaResize(arena, state->old_entries, sizeof(sync_entry_t) * cap, sizeof(sync_entry_t) * cap * 2);
+            cap *= 2;
+        }
+
+        state->old_entries[state->old_count++] = entry;
+    }
+
+    fclose(manifest);
+}
+
+function sync_entry_t* Aguilar_SyncFindEntry(sync_state_t *state, const char* path)
+{
+    for (int i = 0; i < state->old_count; i++) {
+        if (strcmp(state->old_entries[i].path, path) == 0) {
+            return &state->old_entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+function int Aguilar_SyncWriteManifest(sync_state_t *state, const char* manifest_path)
+{
+    char tmp[PATH_MAX];
+    Aguilar_FormatTempPath(tmp, sizeof(tmp), manifest_path);
+
+    FILE* manifest = fopen(tmp, "w");
+    if (manifest == NULL) {
+        Aguilar_SetError("Failed to write sync manifest!");
+        return -1;
+    }
+
+    for (int i = 0; i < state->count; i++) {
+        sync_entry_t *entry = &state->entries[i];
+        fprintf(manifest, "%016lx %lu %ld %ld %s\n", entry->hash, entry->size, entry->template_mtime, entry->dest_mtime, entry->path);
+    }
+
+    if (fclose(manifest) != 0 or rename(tmp, manifest_path) != 0) {
+        unlink(tmp);
+        Aguilar_SetError("Failed to write sync manifest!");
+        return -1;
+    }
+
+    return 0;
+}
+
+function int Aguilar_SyncFile(arena_t *arena, sync_state_t *state, const char* rel, const char* from, const char* to, struct stat *from_sb)
+{
+    struct stat to_sb;
+    bool to_exists = Aguilar_FileExists(to, &to_sb);
+    sync_entry_t *old = Aguilar_SyncFindEntry(state, rel);
+
+    sync_entry_t entry = { 0 };
+    entry.size = from_sb->st_size;
+    entry.template_mtime = Aguilar_ModTime(from_sb);
+
+    bool copy = true;
+
+    if (to_exists and old != NULL
+            and old->size == (u64)from_sb->st_size and old->template_mtime == Aguilar_ModTime(from_sb)
+            and to_sb.st_size == from_sb->st_size and old->dest_mtime == Aguilar_ModTime(&to_sb)) {
+        // NOTE(Alex): Neither side was touched since the last sync.
+        entry.hash = old->hash;
+        copy = false;
+    } else {
+        if (Aguilar_HashFile(from, &entry.hash) != 0) {
+            return -1;
+        }
+
+        u64 to_hash = 0;
+        if (to_exists and to_sb.st_size == from_sb->st_size
+                and Aguilar_HashFile(to, &to_hash) == 0 and to_hash == entry.hash) {
+            copy = false;
+        }
+    }
+
+    if (copy) {
+        if (Aguilar_CopyFile(from, to, from_sb->st_mode) != 0) {
+            return -1;
+        }
+
+        Aguilar_FileExists(to, &to_sb);
+        state->copied++;
+    } else {
+        state->unchanged++;
+    }
+
+    entry.dest_mtime = Aguilar_ModTime(&to_sb);
+    entry.path = AWN_ArenaPush(arena, strlen(rel) + 1);
+    memcpy(entry.path, rel, strlen(rel));
+
+    if (state->count == state->cap) {
+        int new_cap = state->cap == 0 ? 64 : state->cap * 2;
+        state->entries = AWN_ArenaResize(arena, state->entries, sizeof(sync_entry_t) * state->cap, sizeof(sync_entry_t) * new_cap);
+        state->cap = new_cap;
+    }
+
+    state->entries[state->count++] = entry;
+
+    return 0;
+}
+
+// NOTE(Alex): Walks the template directory once, recursing into sub directories.
+//              The template main.c is skipped, it only seeds new projects.
+function int Aguilar_SyncDirectory(arena_t *arena, sync_state_t *state, const char* template_dir, const char* dest_dir, const char* rel_dir)
+{
+    DIR *dir = opendir(template_dir);
+    if (dir == NULL) {
+        Aguilar_SetError("Could not open the template directory!");
+        return -1;
+    }
+
+    int result = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 or strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        if (rel_dir[0] == '\0' and strcmp(entry->d_name, TEMPLATE_MAIN_FILE) == 0) {
+            continue;
+        }
+
+        char from[PATH_MAX];
+        char to[PATH_MAX];
+        char rel[PATH_MAX];
+
+        snprintf(from, sizeof(from), "%s/%s", template_dir, entry->d_name);
+        snprintf(to, sizeof(to), "%s/%s", dest_dir, entry->d_name);
+        snprintf(rel, sizeof(rel), "%s%s%s", rel_dir, rel_dir[0] ? "/" : "", entry->d_name);
+
+        struct stat sb;
+        if (lstat(from, &sb) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(sb.st_mode)) {
+            if (!Aguilar_FileExists(to, 0) and mkdir(to, sb.st_mode & 07777) != 0) {
+                Aguilar_SetError("System failed to create new directory!");
+                result = -1;
+                break;
+            }
+
+            if (Aguilar_SyncDirectory(arena, state, from, to, rel) != 0) {
+                result = -1;
+                break;
+            }
+        } else if (S_ISLNK(sb.st_mode)) {
+            char target[PATH_MAX] = { 0 };
+            char current[PATH_MAX] = { 0 };
+
+            if (readlink(from, target, sizeof(target) - 1) < 0) {
+                continue;
+            }
+
+            if (readlink(to, current, sizeof(current) - 1) < 0 or strcmp(target, current) != 0) {
+                unlink(to);
+                if (symlink(target, to) != 0) {
+                    Aguilar_SetError("Failed to create symbolic link!");
+                    result = -1;
+                    break;
+                }
+                state->copied++;
+            } else {
+                state->unchanged++;
+            }
+        } else if (S_ISREG(sb.st_mode)) {
+            if (Aguilar_SyncFile(arena, state, rel, from, to, &sb) != 0) {
+                result = -1;
+                break;
+            }
+        }
+    }
+
+    closedir(dir);
+
+    return result;
+}
+
+function int Aguilar_SyncTemplate(arena_t *arena, const char* dest_dir, const char* manifest_path)
+{
+    char* data_path = Aguilar_FormatDataPath(arena);
+    if (data_path == NULL) {
+        return -1;
+    }
+
+    sync_state_t state = { 0 };
+    Aguilar_SyncReadManifest(arena, &state, manifest_path);
+
+    if (Aguilar_SyncDirectory(arena, &state, data_path, dest_dir, "") != 0) {
+        return -1;
+    }
+
+    if (Aguilar_SyncWriteManifest(&state, manifest_path) != 0) {
+        return -1;
+    }
+
+    printf("Synced template: %d copied, %d unchanged.\n", state.copied, state.unchanged);
+
+    return 0;
+}
+
 function int Aguilar_NewProject(arena_t *arena, char* name)
 {
     if (Aguilar_FileExists(name, 0)) {
@@ -104,7 +639,7 @@ function int Aguilar_NewProject(arena_t *arena, char* name)
         return -1;
     }
 
-    char* src_path = AWN_ArenaPush(arena, sizeof(char) * (strlen(name) + strlen("src") + 1));
+    char* src_path = AWN_ArenaPush(arena, sizeof(char) * (strlen(name) + strlen("src") + 2));
 
     sprintf(src_path, "%s/%s", name, "src");
 
@@ -116,26 +651,32 @@ function int Aguilar_NewProject(arena_t *arena, char* name)
         return -1;
     }
 
+    char* data_path = Aguilar_FormatDataPath(arena);
+    if (data_path == NULL) {
+        return -1;
+    }
+
+    char* template_main = AWN_ArenaPush(arena, sizeof(char) * (strlen(data_path) + strlen(TEMPLATE_MAIN_FILE) + 2));
+    sprintf(template_main, "%s/%s", data_path, TEMPLATE_MAIN_FILE);
+
     char* main_path = AWN_ArenaPush(arena, sizeof(char) * (strlen(name) * 2 + strlen("/src/") + 64));
 
     sprintf(main_path, "%s/src/%s_main.c", name, name);
 
-    char* command = AWN_ArenaPush(arena, sizeof(char) * (strlen(main_path) + 128));
-
-    sprintf(command, "cp ~/.local/bin/Aguilar_data/main.c %s", main_path);
+    struct stat sb;
+    if (!Aguilar_FileExists(template_main, &sb)) {
+        Aguilar_SetError("Template main.c not found, run install first!");
+        return -1;
+    }
 
-    success = system(command);
-    
-    if (success != 0) {
-        Aguilar_SetError("System command failed!");
+    if (Aguilar_CopyFile(template_main, main_path, sb.st_mode) != 0) {
         return -1;
     }
 
-    sprintf(command, "rsync -a ~/.local/bin/Aguilar_data/ %s/src/ --exclude=main.c", name);
-    success = system(command);
+    char* manifest_path = AWN_ArenaPush(arena, sizeof(char) * (strlen(name) + strlen(SYNC_MANIFEST_FILE) + 2));
+    sprintf(manifest_path, "%s/%s", name, SYNC_MANIFEST_FILE);
 
-    if (success != 0) {
-        Aguilar_SetError("System command failed!");
+    if (Aguilar_SyncTemplate(arena, src_path, manifest_path) != 0) {
         return -1;
     }
 
@@ -149,10 +690,7 @@ function int Aguilar_SyncProject(arena_t* arena)
         return -1;
     }
 
-    int success = system("rsync -a ~/.local/bin/Aguilar_data/ src/ --exclude=main.c");
-
-    if (success != 0) {
-        Aguilar_SetError("Command failed!");
+    if (Aguilar_SyncTemplate(arena, "src", SYNC_MANIFEST_FILE) != 0) {
         return -1;
     }
 
@@ -167,24 +705,24 @@ function int Aguilar_SyncProject(arena_t* arena)
 
 function char* Aguilar_ParseConfigLine(arena_t *arena, char* line, size_t line_length, int divide_point, char* prefix)
 {
-    const size_t list_length = 256;
+    // NOTE(Alex): Worst case every character is its own value and gets a prefix.
+    const size_t list_length = line_length * (strlen(prefix) + 1) + 1;
     char* result = AWN_ArenaPush(arena, sizeof(char) * list_length);
+    char* value_str = AWN_ArenaPush(arena, sizeof(char) * (line_length + 1));
 
     int current = divide_point;
-
-    char value_str[128];
     int value_idx = 0;
-    while (current <= line_length) {
-        if (line[current] == ' ' or line[current] == '\n') {
+    while (current < line_length) {
+        if (line[current] == ' ' or line[current] == '\n' or line[current] == '\r') {
             current++;
             continue;
         }
 
         if (line[current] == ';') {
-            strncat(result, prefix, 256 - strlen(prefix) - 1);
-            strncat(result, value_str, 256 - strlen(value_str) - 1);
+            strncat(result, prefix, list_length - strlen(result) - 1);
+            strncat(result, value_str, list_length - strlen(result) - 1);
 
-            memset(value_str, 0, 128);
+            memset(value_str, 0, line_length + 1);
             value_idx = 0;
 
             current++;
@@ -197,41 +735,228 @@ function char* Aguilar_ParseConfigLine(arena_t *arena, char* line, size_t line_l
     }
 
     if (value_idx != 0) {
-        strncat(result, prefix, 256 - strlen(prefix) - 1);
-        strncat(result, value_str, 256 - strlen(value_str) - 1);
+        strncat(result, prefix, list_length - strlen(result) - 1);
+        strncat(result, value_str, list_length - strlen(result) - 1);
     }
 
     return result;
 }
 
-function char* Aguilar_ReadProjectFile(arena_t *arena)
+ENUM(target_kind_t)
+{
+    TARGET_EXE,
+    TARGET_STATIC,
+    TARGET_SHARED,
+};
+
+// NOTE(Alex): A target declared in .aguilar. Sources may also be directories, which
+//              stand for every .c file inside them.
+STRUCT(build_target_t)
+{
+    char* name;
+    target_kind_t kind;
+    char** sources;
+    int source_count;
+    char** deps;
+    int dep_count;
+    char* output;
+};
+
+// NOTE(Alex): A gen line in .aguilar: the file to generate, the generator's source and the
+//              files it reads, which are handed to it as arguments.
+STRUCT(generator_t)
 {
+    char* output;
+    char* source;
+    char** inputs;
+    int input_count;
+};
+
+// NOTE(Alex): Everything a .aguilar file can set. Flags go to both the compile and the
+//              link step, libraries only to the link step.
+STRUCT(project_config_t)
+{
+    build_target_t* targets;
+    int target_count;
 
-#define CHECK_END(c) (c) != '\n'\
-    and (c) != '\r'\
-    and (c) != '\0'\
-    and (c) != EOF
+    generator_t* generators;
+    int generator_count;
 
-    if (!Aguilar_FileExists(".aguilar", 0)) {
-        return 0;
-    }
+    char** assets;
+    int asset_count;
 
-    FILE* project_file = fopen(".aguilar", "r");
+    char* flags;
+    char* libs;
+    char* linker;
+    char* debug;
+    char* pch;
+};
 
-    if (project_file == 0) {
-        Aguilar_SetError("Failed to open .aguilar file!");
-        return 0;
-    }
+function char** Aguilar_SplitList(arena_t *arena, char* list, int* count)
+{
+    *count = 0;
 
-    const int size_max = 1024;
-    char line[size_max];
+    char* copy = AWN_ArenaPush(arena, strlen(list) + 1);
+    memcpy(copy, list, strlen(list));
 
-    char *args_result = AWN_ArenaPush(arena, sizeof(char) * 2048);
+    char** tokens = AWN_ArenaPush(arena, sizeof(char*) * (strlen(list) / 2 + 1));
 
-    bool found_flags = false;
+    char* saveptr = NULL;
+    for (char* token = strtok_r(copy, " ", &saveptr); token != NULL; token = strtok_r(NULL, " ", &saveptr)) {
+        tokens[(*count)++] = token;
+    }
 
-    while (fgets(line, size_max, project_file) != NULL) {
-        int divide_point = 0;
+    return tokens;
+}
+
+function build_target_t* Aguilar_FindTarget(project_config_t *config, const char* name)
+{
+    for (int i = 0; i < config->target_count; i++) {
+        if (strcmp(config->targets[i].name, name) == 0) {
+            return &config->targets[i];
+        }
+    }
+
+    return NULL;
+}
+
+// NOTE(Alex): Makes room for one more element in an arena array. The capacity is implied by
+//              the count: eight to start with, doubling whenever the count hits a power of two.
+function void* Aguilar_ArrayReserve(arena_t *arena, void* array, int count, usize elem_size)
+{
+    if (count == 0) {
+        return AWN_ArenaPush(arena, elem_size * 8);
+    }
+
+    if (count >= 8 and (count & (count - 1)) == 0) {
+        return AWN_ArenaResize(arena, array, elem_size * count, elem_size * count * 2);
+    }
+
+    return array;
+}
+
+// NOTE(Alex): exe/static/shared lines add sources to a target (creating it on first use),
+//              deps lines add dependencies. Either may come first in the file.
+function int Aguilar_AddTargetLine(arena_t *arena, project_config_t *config, const char* key, char* list)
+{
+    int count = 0;
+    char** tokens = Aguilar_SplitList(arena, list, &count);
+
+    if (count == 0) {
+        Aguilar_SetError("Parsing Error: Target line without a name!");
+        return -1;
+    }
+
+    build_target_t *target = Aguilar_FindTarget(config, tokens[0]);
+
+    if (target == NULL) {
+        config->targets = Aguilar_ArrayReserve(arena, config->targets, config->target_count, sizeof(build_target_t));
+        target = &config->targets[config->target_count++];
+        memset(target, 0, sizeof(build_target_t));
+        target->name = tokens[0];
+        target->kind = TARGET_EXE;
+    }
+
+    for (int i = 1; i < count; i++) {
+        if (strcmp(key, "deps") == 0) {
+            target->deps = Aguilar_ArrayReserve(arena, target->deps, target->dep_count, sizeof(char*));
+            target->deps[target->dep_count++] = tokens[i];
+        } else {
+            target->sources = Aguilar_ArrayReserve(arena, target->sources, target->source_count, sizeof(char*));
+            target->sources[target->source_count++] = tokens[i];
+        }
+    }
+
+    if (strcmp(key, "static") == 0) {
+        target->kind = TARGET_STATIC;
+    } else if (strcmp(key, "shared") == 0) {
+        target->kind = TARGET_SHARED;
+    }
+
+    return 0;
+}
+
+// NOTE(Alex): gen: output; generator.c; inputs...
+function int Aguilar_AddGeneratorLine(arena_t *arena, project_config_t *config, char* list)
+{
+    int count = 0;
+    char** tokens = Aguilar_SplitList(arena, list, &count);
+
+    if (count < 2) {
+        Aguilar_SetError("Parsing Error: Generator line needs an output and a source!");
+        return -1;
+    }
+
+    if (strchr(tokens[0], '/') != NULL) {
+        Aguilar_SetError("Parsing Error: Generator output must be a plain file name!");
+        return -1;
+    }
+
+    config->generators = Aguilar_ArrayReserve(arena, config->generators, config->generator_count, sizeof(generator_t));
+    config->generators[config->generator_count++] = (generator_t){ tokens[0], tokens[1], tokens + 2, count - 2 };
+
+    return 0;
+}
+
+function bool Aguilar_ConfigKeyIs(char* line, int divide_point, const char* key)
+{
+    int key_length = divide_point - 1;
+    while (key_length > 0 and line[key_length - 1] == ' ') {
+        key_length--;
+    }
+
+    return key_length == (int)strlen(key) and strncmp(line, key, key_length) == 0;
+}
+
+// NOTE(Alex): Returns 0 when there is no .aguilar file, the defaults are filled in either way.
+function int Aguilar_ReadProjectConfig(arena_t *arena, project_config_t *config)
+{
+
+#define CHECK_END(c) (c) != '\n'\
+    and (c) != '\r'\
+    and (c) != '\0'\
+    and (c) != EOF
+
+    config->flags = AWN_ArenaPush(arena, sizeof(char) * 2048);
+    config->libs = AWN_ArenaPush(arena, sizeof(char) * 2048);
+    config->linker = 0;
+    config->debug = 0;
+    config->pch = 0;
+    config->targets = 0;
+    config->target_count = 0;
+    config->generators = 0;
+    config->generator_count = 0;
+    config->assets = 0;
+    config->asset_count = 0;
+
+    if (!Aguilar_FileExists(".aguilar", 0)) {
+        strncat(config->flags, DEFAULT_FLAGS, 2048 - 1);
+        return 0;
+    }
+
+    str_t project_file = AWN_FileReadAll(arena, ".aguilar");
+
+    if (project_file.data == NULL) {
+        Aguilar_SetError("Failed to open .aguilar file!");
+        return -1;
+    }
+
+    bool found_flags = false;
+
+    // NOTE(Alex): The file is read once into the arena and every line is a view into it. The byte
+    //              after a line is its newline (or the final NUL), so it can be cut in place.
+    str_t rest = project_file;
+    str_t line_view;
+
+    while (AWN_StrNextLine(&rest, &line_view)) {
+        if (AWN_StrTrim(line_view).size == 0) {
+            continue;
+        }
+
+        char* line = (char*)line_view.data;
+        line[line_view.size] = '\0';
+
+        int divide_point = 0;
 
         while (CHECK_END(line[divide_point])) {
             if (line[divide_point] == ':') {
@@ -242,12 +967,64 @@ function char* Aguilar_ReadProjectFile(arena_t *arena)
             divide_point++;
         }
 
-        const int line_length = strlen(line);
+        const int line_length = (int)line_view.size;
 
         if (divide_point == line_length) {
             // NOTE(Alex): Throw parsing error
             Aguilar_SetError("Parsing Error: Did not find dividing colon!");
-            return 0;
+            return -1;
+        }
+
+        // NOTE(Alex): Named keys first, anything else falls back to the first letter.
+        if (Aguilar_ConfigKeyIs(line, divide_point, "linker")) {
+            config->linker = Aguilar_ParseConfigLine(arena, line, line_length, divide_point, "");
+            continue;
+        }
+
+        if (Aguilar_ConfigKeyIs(line, divide_point, "debug")) {
+            config->debug = Aguilar_ParseConfigLine(arena, line, line_length, divide_point, "");
+            continue;
+        }
+
+        if (Aguilar_ConfigKeyIs(line, divide_point, "pch")) {
+            config->pch = Aguilar_ParseConfigLine(arena, line, line_length, divide_point, " ");
+            continue;
+        }
+
+        if (Aguilar_ConfigKeyIs(line, divide_point, "gen")) {
+            char* list = Aguilar_ParseConfigLine(arena, line, line_length, divide_point, " ");
+            if (Aguilar_AddGeneratorLine(arena, config, list) != 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (Aguilar_ConfigKeyIs(line, divide_point, "asset")) {
+            int count = 0;
+            char** tokens = Aguilar_SplitList(arena, Aguilar_ParseConfigLine(arena, line, line_length, divide_point, " "), &count);
+
+            for (int i = 0; i < count; i++) {
+                config->assets = Aguilar_ArrayReserve(arena, config->assets, config->asset_count, sizeof(char*));
+                config->assets[config->asset_count++] = tokens[i];
+            }
+            continue;
+        }
+
+        const char* target_keys[] = { "exe", "static", "shared", "deps" };
+        const char* target_key = NULL;
+
+        for (int i = 0; i < (int)AWN_ArrayCount(target_keys); i++) {
+            if (Aguilar_ConfigKeyIs(line, divide_point, target_keys[i])) {
+                target_key = target_keys[i];
+            }
+        }
+
+        if (target_key != NULL) {
+            char* list = Aguilar_ParseConfigLine(arena, line, line_length, divide_point, " ");
+            if (Aguilar_AddTargetLine(arena, config, target_key, list) != 0) {
+                return -1;
+            }
+            continue;
         }
 
         // NOTE(Alex): Right hand side is a semicolon separated list.
@@ -255,322 +1032,6303 @@ function char* Aguilar_ReadProjectFile(arena_t *arena)
             case 'l': {
                 /* // NOTE(Alex): Parse libraries */
                 char* parse = Aguilar_ParseConfigLine(arena, line, line_length, divide_point, " -l");
-                strncat(args_result, parse, 2048 - strlen(parse) - 1);
+                strncat(config->libs, parse, 2048 - strlen(config->libs) - 1);
             } break;
 
             case 'f': {
                 // NOTE(Alex): Parse flags
                 char* parse = Aguilar_ParseConfigLine(arena, line, line_length, divide_point, " ");
-                strncat(args_result, parse, 2048 - strlen(parse) - 1);
+                strncat(config->flags, parse, 2048 - strlen(config->flags) - 1);
                 found_flags = true;
             } break;
         }
     }
 
-    // NOTE(Alex): Append defaults
-    if (!found_flags) {
-        strncat(args_result, " ", 2);
-        strncat(args_result, DEFAULT_FLAGS, 2048 - strlen(DEFAULT_FLAGS) - 1);
+    // NOTE(Alex): Append defaults
+    if (!found_flags) {
+        strncat(config->flags, DEFAULT_FLAGS, 2048 - strlen(config->flags) - 1);
+    }
+
+#undef CHECK_END
+
+    return 1;
+}
+
+#define LINKER_PROBE_PATH "/.cache/aguilar/linkers"
+
+// NOTE(Alex): The compiler is identified by where it lives and when it was installed,
+//              which changes whenever the toolchain is upgraded, without having to spawn it.
+function u64 Aguilar_HashCompiler(arena_t *arena, u64 hash, const char* compiler)
+{
+    hash = Aguilar_HashString(hash, compiler);
+
+    char* path = Aguilar_FindInPath(arena, compiler);
+    struct stat sb;
+
+    if (path != NULL and stat(path, &sb) == 0) {
+        char real[PATH_MAX];
+        if (realpath(path, real) != NULL) {
+            hash = Aguilar_HashString(hash, real);
+        }
+
+        hash = Aguilar_HashBytes(hash, &sb.st_size, sizeof(sb.st_size));
+        hash = Aguilar_HashBytes(hash, &sb.st_mtim, sizeof(sb.st_mtim));
+    }
+
+    return hash;
+}
+
+// NOTE(Alex): Whether the compiler driver takes -fuse-ld=<linker>, gcc only knows mold from 12.1
+//              on. Finding out means running the driver, so the answer is kept per compiler and
+//              linker under ~/.cache/aguilar/linkers.
+function bool Aguilar_CompilerAcceptsLinker(arena_t *arena, const char* linker)
+{
+    const char* compiler = Aguilar_GetCompilerEnv();
+    u64 key = Aguilar_HashString(Aguilar_HashCompiler(arena, HASH_SEED, compiler), linker);
+
+    // NOTE(Alex): The driver looks for ld.<linker> and then <linker>. Where they live and when
+    //              they were installed is part of the key, so installing or upgrading the linker
+    //              asks again instead of trusting an old "no".
+    key = Aguilar_HashCompiler(arena, key, Aguilar_Format(arena, "ld.%s", linker));
+    key = Aguilar_HashCompiler(arena, key, linker);
+
+    const char* home = getenv("HOME");
+    char* dir = home != NULL ? Aguilar_Format(arena, "%s%s", home, LINKER_PROBE_PATH) : NULL;
+    char* path = dir != NULL ? Aguilar_Format(arena, "%s/%016lx", dir, key) : NULL;
+
+    int fd = path != NULL ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+    if (fd >= 0) {
+        char answer = 0;
+        bool known = read(fd, &answer, 1) == 1;
+        close(fd);
+        if (known) {
+            return answer == '1';
+        }
+    }
+
+    char* command = Aguilar_Format(arena, "%s -fuse-ld=%s -Wl,--version >/dev/null 2>&1", compiler, linker);
+    bool accepted = system(command) == 0;
+
+    // NOTE(Alex): Two builds probing at once write the same answer, so no lock is needed.
+    if (dir != NULL and Aguilar_MakeDirs(dir) == 0) {
+        FILE* file = fopen(path, "w");
+        if (file != NULL) {
+            fputc(accepted ? '1' : '0', file);
+            fclose(file);
+        }
+    }
+
+    return accepted;
+}
+
+// NOTE(Alex): The flags that make the driver link with linker, or NULL when it can't. mold
+//              installs an `ld` under libexec/mold for drivers that don't know its name, -B
+//              makes those pick it up in place of the system one.
+function char* Aguilar_UseLinker(arena_t *arena, const char* linker)
+{
+    if (Aguilar_CompilerAcceptsLinker(arena, linker)) {
+        return Aguilar_Format(arena, " -fuse-ld=%s", linker);
+    }
+
+    char* mold = strcmp(linker, "mold") == 0 ? Aguilar_FindInPath(arena, "mold") : NULL;
+    char real[PATH_MAX];
+    if (mold == NULL or realpath(mold, real) == NULL or strrchr(real, '/') == NULL) {
+        return NULL;
+    }
+
+    *strrchr(real, '/') = '\0';
+    char* libexec = Aguilar_Format(arena, "%s/../libexec/mold", real);
+    if (!Aguilar_FileExists(Aguilar_Format(arena, "%s/ld", libexec), 0)) {
+        return NULL;
+    }
+
+    return Aguilar_Format(arena, " -B%s", libexec);
+}
+
+// NOTE(Alex): Picks the linker passed through -fuse-ld. An explicit choice in .aguilar wins,
+//              otherwise mold is preferred over lld, and the driver default is the fallback.
+//              A linker the compiler can't use counts as missing.
+function char* Aguilar_GetLinkerFlags(arena_t *arena, const char* linker)
+{
+    if (linker != 0 and linker[0] != '\0') {
+        if (strcmp(linker, "default") == 0 or strcmp(linker, "bfd") == 0) {
+            return "";
+        }
+
+        char* program = AWN_ArenaPush(arena, strlen(linker) + 8);
+        sprintf(program, "ld.%s", linker);
+
+        char* flags = NULL;
+        if (Aguilar_FindInPath(arena, program) != NULL or Aguilar_FindInPath(arena, linker) != NULL) {
+            flags = Aguilar_UseLinker(arena, linker);
+        }
+
+        if (flags != NULL) {
+            return flags;
+        }
+
+        printf("Linker %s not found or not supported by the compiler, using the default linker.\n", linker);
+        return "";
+    }
+
+    char* flags = NULL;
+    if (Aguilar_FindInPath(arena, "ld.mold") != NULL or Aguilar_FindInPath(arena, "mold") != NULL) {
+        flags = Aguilar_UseLinker(arena, "mold");
+    }
+
+    if (flags == NULL and Aguilar_FindInPath(arena, "ld.lld") != NULL) {
+        flags = Aguilar_UseLinker(arena, "lld");
+    }
+
+    return flags != NULL ? flags : "";
+}
+
+// NOTE(Alex): split keeps the DWARF in .dwo files next to the objects so the linker never
+//              has to move it, compressed shrinks it with zlib, none drops it entirely.
+function char* Aguilar_GetDebugFlags(const char* debug)
+{
+    if (debug == 0 or debug[0] == '\0' or strcmp(debug, "full") == 0) {
+        return "";
+    }
+
+    if (strcmp(debug, "split") == 0) {
+        return " -gsplit-dwarf";
+    }
+
+    if (strcmp(debug, "compressed") == 0) {
+        return " -gz";
+    }
+
+    if (strcmp(debug, "none") == 0) {
+        return " -g0";
+    }
+
+    printf("Unknown debug mode %s, expected full, split, compressed or none.\n", debug);
+    return "";
+}
+
+function f64 Aguilar_TimeMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+#define BUILD_DIR ".aguilar_build"
+
+// NOTE(Alex): Without link arguments the compiler driver compiles and links in one go.
+//              With them, compiling and linking are separate steps so each can be timed.
+function int Aguilar_RunBuildInstruction(arena_t *arena, char* source, char* args, char* link_args, char* output)
+{
+    const char* compiler = Aguilar_GetCompilerEnv();
+
+    size_t command_length = strlen(source) + strlen(compiler) + strlen(ARG_OUTPUT);
+
+    // NOTE(Alex): Run with default options.
+    if (args == 0) {
+        args = DEFAULT_FLAGS;
+    }
+
+    command_length += strlen(args);
+
+    const char* output_file = "app.out";
+
+    if (output != 0) {
+        output_file = output;
+    }
+
+    if (link_args == 0) {
+        char* command = AWN_ArenaPush(arena, sizeof(char) * (command_length + 6 + strlen(output_file)));
+
+        sprintf(command, "%s %s -o %s %s", compiler, args, output_file, source);
+
+        printf("%s\n", command);
+        fflush(stdout);
+
+        int res = system(command);
+
+        return res;
+    }
+
+    if (Aguilar_MakeDirs(BUILD_DIR) != 0) {
+        return -1;
+    }
+
+    const char* base = strrchr(output_file, '/') ? strrchr(output_file, '/') + 1 : output_file;
+    char* object = AWN_ArenaPush(arena, sizeof(char) * (strlen(BUILD_DIR) + strlen(base) + 4));
+    sprintf(object, "%s/%s.o", BUILD_DIR, base);
+
+    char* command = AWN_ArenaPush(arena, sizeof(char) * (command_length + strlen(link_args) + strlen(object) * 2 + strlen(output_file) + 16));
+
+    sprintf(command, "%s %s -c -o %s %s", compiler, args, object, source);
+    printf("%s\n", command);
+    fflush(stdout);
+
+    f64 compile_start = Aguilar_TimeMs();
+    int res = system(command);
+    f64 compile_time = Aguilar_TimeMs() - compile_start;
+
+    if (res != 0) {
+        return res;
+    }
+
+    sprintf(command, "%s %s -o %s %s%s", compiler, args, output_file, object, link_args);
+    printf("%s\n", command);
+    fflush(stdout);
+
+    f64 link_start = Aguilar_TimeMs();
+    res = system(command);
+    f64 link_time = Aguilar_TimeMs() - link_start;
+
+    printf("Compile: %.1f ms, link: %.1f ms\n", compile_time, link_time);
+
+    return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Shared, content addressed compile cache.
+//              Enabled by pointing AGUILAR_CACHE_DIR at a directory (a local volume, or a
+//              mount shared between machines). Entries are named by a 128-bit hash of the
+//              compiler, the arguments, the libraries and the preprocessed source, and are
+//              published by renaming a finished temporary into place, so concurrent writers
+//              are safe. Everything that was hashed is stored next to the entry (as .key) and
+//              compared on every hit, so even a collision is only a miss. The file mtime is
+//              the last use time, which is what LRU eviction sorts on.
+
+#define ENV_CACHE_DIR "AGUILAR_CACHE_DIR"
+#define ENV_CACHE_SIZE "AGUILAR_CACHE_SIZE"
+#define CACHE_DEFAULT_SIZE_MB 2048
+#define CACHE_KEY_SUFFIX ".key"
+
+STRUCT(cache_key_t)
+{
+    u64 hi;
+    u64 lo;
+    char* input;
+    usize input_size;
+};
+
+function const char* Aguilar_GetSharedCacheDir()
+{
+    const char* dir = getenv(ENV_CACHE_DIR);
+    if (dir == NULL or dir[0] == '\0') {
+        return NULL;
+    }
+    return dir;
+}
+
+function u64 Aguilar_GetSharedCacheSize()
+{
+    const char* size = getenv(ENV_CACHE_SIZE);
+    u64 size_mb = size != NULL ? strtoull(size, 0, 10) : 0;
+
+    if (size_mb == 0) {
+        size_mb = CACHE_DEFAULT_SIZE_MB;
+    }
+
+    return size_mb << 20;
+}
+
+// NOTE(Alex): Takes ownership of input, which is what open_memstream hands back.
+function cache_key_t Aguilar_CacheKeyFromInput(arena_t *arena, char* input, usize input_size)
+{
+    cache_key_t key;
+    u128 hash = Aguilar_Hash128Bytes(HASH128_SEED, input, input_size);
+    key.hi = (u64)(hash >> 64);
+    key.lo = (u64)hash;
+
+    key.input = AWN_ArenaPush(arena, input_size + 1);
+    memcpy(key.input, input, input_size);
+    key.input_size = input_size;
+    free(input);
+
+    return key;
+}
+
+// NOTE(Alex): A link only names its libraries, so what they contain is part of the key too.
+//              They are looked up like the linker would, in -L directories first and then
+//              wherever the compiler driver finds them.
+function void Aguilar_WriteLibraryStamps(arena_t *arena, FILE* stream, const char* compiler, const char* args)
+{
+    int count = 0;
+    char** tokens = Aguilar_SplitList(arena, Aguilar_Format(arena, "%s", args), &count);
+
+    for (int i = 0; i < count; i++) {
+        if (strncmp(tokens[i], "-l", 2) != 0 or tokens[i][2] == '\0') {
+            continue;
+        }
+
+        const char* name = tokens[i] + 2;
+        char* found = NULL;
+        const char* suffixes[] = { "so", "a" };
+
+        for (int s = 0; s < 2 and found == NULL; s++) {
+            for (int j = 0; j < count and found == NULL; j++) {
+                if (strncmp(tokens[j], "-L", 2) == 0) {
+                    char* path = Aguilar_Format(arena, "%s/lib%s.%s", tokens[j] + 2, name, suffixes[s]);
+                    found = Aguilar_FileExists(path, 0) ? path : NULL;
+                }
+            }
+
+            if (found == NULL) {
+                char* command = Aguilar_Format(arena, "%s -print-file-name=lib%s.%s 2>/dev/null", compiler, name, suffixes[s]);
+                FILE* pipe = popen(command, "r");
+                char line[PATH_MAX] = { 0 };
+                if (pipe != NULL) {
+                    if (fgets(line, sizeof(line), pipe) != NULL) {
+                        line[strcspn(line, "\n")] = '\0';
+                    }
+                    pclose(pipe);
+                }
+                found = strchr(line, '/') != NULL ? Aguilar_Format(arena, "%s", line) : NULL;
+            }
+        }
+
+        str_t contents = found != NULL ? AWN_FileReadAll(arena, found) : (str_t){ 0 };
+        if (contents.data == NULL) {
+            fprintf(stream, "lib %s missing\n", name);
+            continue;
+        }
+
+        u128 hash = Aguilar_Hash128Bytes(HASH128_SEED, contents.data, contents.size);
+        fprintf(stream, "lib %s %s %016lx%016lx\n", name, found, (u64)(hash >> 64), (u64)hash);
+    }
+}
+
+// NOTE(Alex): Line markers stay in, so the line table of a cached binary matches its source,
+//              but paths under the working directory are hashed relative to it (and -g does not
+//              get to write the directory itself), so two checkouts still share entries.
+function int Aguilar_ComputeBuildKey(arena_t *arena, const char* compiler, const char* source, const char* args, const char* link_args, cache_key_t* key)
+{
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd) - 1) == NULL) {
+        Aguilar_SetError("Failed to get the working directory!");
+        return -1;
+    }
+    strcat(cwd, "/");
+    usize cwd_length = strlen(cwd);
+
+    char* command = Aguilar_Format(arena, "%s %s -E -fno-working-directory %s 2>/dev/null", compiler, args, source);
+    FILE* pipe = popen(command, "r");
+    if (pipe == NULL) {
+        Aguilar_SetError("Failed to run the preprocessor!");
+        return -1;
+    }
+
+    char* input = NULL;
+    usize input_size = 0;
+    FILE* stream = open_memstream(&input, &input_size);
+    if (stream == NULL) {
+        pclose(pipe);
+        Aguilar_SetError("Failed to hash the build!");
+        return -1;
+    }
+
+    fprintf(stream, "compiler %s %016lx\n", compiler, Aguilar_HashCompiler(arena, HASH_SEED, compiler));
+    fprintf(stream, "args %s\n", args);
+    fprintf(stream, "link %s\n", link_args);
+    Aguilar_WriteLibraryStamps(arena, stream, compiler, Aguilar_Format(arena, "%s %s", args, link_args));
+
+    char* line = NULL;
+    usize line_cap = 0;
+    ssize_t line_length;
+    while ((line_length = getline(&line, &line_cap, pipe)) > 0) {
+        char* quote = line[0] == '#' ? strchr(line, '"') : NULL;
+        if (quote != NULL and strncmp(quote + 1, cwd, cwd_length) == 0) {
+            fwrite(line, 1, quote + 1 - line, stream);
+            fputs(quote + 1 + cwd_length, stream);
+        } else {
+            fwrite(line, 1, line_length, stream);
+        }
+    }
+    free(line);
+
+    int status = pclose(pipe);
+    fclose(stream);
+
+    if (status != 0) {
+        free(input);
+        Aguilar_SetError("Preprocessor failed!");
+        return -1;
+    }
+
+    *key = Aguilar_CacheKeyFromInput(arena, input, input_size);
+    return 0;
+}
+
+function void Aguilar_FormatCacheEntryPath(char* buffer, usize buffer_size, const char* dir, cache_key_t key)
+{
+    snprintf(buffer, buffer_size, "%s/objects/%02x/%016lx%016lx", dir, (u32)(key.hi >> 56), key.hi, key.lo);
+}
+
+function bool Aguilar_SharedCacheFetch(arena_t *arena, const char* dir, cache_key_t key, const char* output)
+{
+    char entry[PATH_MAX];
+    Aguilar_FormatCacheEntryPath(entry, sizeof(entry), dir, key);
+
+    struct stat sb;
+    if (!Aguilar_FileExists(entry, &sb)) {
+        return false;
+    }
+
+    char* key_path = Aguilar_Format(arena, "%s" CACHE_KEY_SUFFIX, entry);
+    str_t stored = AWN_FileReadAll(arena, key_path);
+    if (stored.data == NULL or stored.size != key.input_size or memcmp(stored.data, key.input, key.input_size) != 0) {
+        return false;
+    }
+
+    if (Aguilar_CopyFile(entry, output, sb.st_mode) != 0) {
+        return false;
+    }
+
+    // NOTE(Alex): Touch the entry so eviction sees it as recently used.
+    utimensat(AT_FDCWD, entry, NULL, 0);
+    utimensat(AT_FDCWD, key_path, NULL, 0);
+
+    return true;
+}
+
+STRUCT(cache_entry_t)
+{
+    char* path;
+    u64 size;
+    i64 mtime;
+};
+
+STRUCT(cache_listing_t)
+{
+    cache_entry_t* entries;
+    int count;
+    u64 total_size;
+};
+
+function cache_listing_t Aguilar_SharedCacheList(arena_t *arena, const char* dir)
+{
+    cache_listing_t listing = { 0 };
+    int cap = 0;
+
+    char objects[PATH_MAX];
+    snprintf(objects, sizeof(objects), "%s/objects", dir);
+
+    DIR* objects_dir = opendir(objects);
+    if (objects_dir == NULL) {
+        return listing;
+    }
+
+    struct dirent *bucket;
+    while ((bucket = readdir(objects_dir)) != NULL) {
+        if (bucket->d_name[0] == '.') {
+            continue;
+        }
+
+        char bucket_path[PATH_MAX];
+        if (snprintf(bucket_path, sizeof(bucket_path), "%s/%s", objects, bucket->d_name) >= (int)sizeof(bucket_path)) {
+            continue;
+        }
+
+        DIR* bucket_dir = opendir(bucket_path);
+        if (bucket_dir == NULL) {
+            continue;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(bucket_dir)) != NULL) {
+            char entry_path[PATH_MAX];
+            struct stat sb;
+
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+
+            if (snprintf(entry_path, sizeof(entry_path), "%s/%s", bucket_path, entry->d_name) >= (int)sizeof(entry_path)
+                    or !Aguilar_FileExists(entry_path, &sb) or !S_ISREG(sb.st_mode)) {
+                continue;
+            }
+
+            // NOTE(Alex): Abandoned temporaries from crashed writers are dropped after an hour.
+            if (strstr(entry->d_name, ".tmp.") != NULL) {
+                if (time(NULL) - sb.st_mtime > 3600) {
+                    unlink(entry_path);
+                }
+                continue;
+            }
+
+            // NOTE(Alex): A key is counted (and evicted) with its entry.
+            usize name_length = strlen(entry->d_name);
+            if (name_length > strlen(CACHE_KEY_SUFFIX) and strcmp(entry->d_name + name_length - strlen(CACHE_KEY_SUFFIX), CACHE_KEY_SUFFIX) == 0) {
+                continue;
+            }
+
+            struct stat key_sb;
+            char key_path[PATH_MAX + 8];
+            snprintf(key_path, sizeof(key_path), "%s" CACHE_KEY_SUFFIX, entry_path);
+            if (stat(key_path, &key_sb) == 0) {
+                sb.st_size += key_sb.st_size;
+            }
+
+            if (listing.count == cap) {
+                int new_cap = cap == 0 ? 256 : cap * 2;
+                listing.entries = AWN_ArenaResize(arena, listing.entries, sizeof(cache_entry_t) * cap, sizeof(cache_entry_t) * new_cap);
+                cap = new_cap;
+            }
+
+            cache_entry_t *item = &listing.entries[listing.count++];
+            item->size = sb.st_size;
+            item->mtime = Aguilar_ModTime(&sb);
+            item->path = AWN_ArenaPush(arena, strlen(entry_path) + 1);
+            memcpy(item->path, entry_path, strlen(entry_path));
+
+            listing.total_size += sb.st_size;
+        }
+
+        closedir(bucket_dir);
+    }
+
+    closedir(objects_dir);
+
+    return listing;
+}
+
+function int Aguilar_CompareCacheEntries(const void* a, const void* b)
+{
+    const cache_entry_t *x = a;
+    const cache_entry_t *y = b;
+    return (x->mtime > y->mtime) - (x->mtime < y->mtime);
+}
+
+// NOTE(Alex): Evicts least recently used entries until the cache is under 90% of its cap,
+//              so a full cache is not collected again on the very next publish.
+function int Aguilar_SharedCacheCollect(arena_t *arena, const char* dir, bool verbose)
+{
+    arena_state_t state = AWN_ArenaStateRecord(arena);
+
+    cache_listing_t listing = Aguilar_SharedCacheList(arena, dir);
+    u64 cap = Aguilar_GetSharedCacheSize();
+
+    int removed = 0;
+
+    if (listing.total_size > cap) {
+        qsort(listing.entries, listing.count, sizeof(cache_entry_t), Aguilar_CompareCacheEntries);
+
+        u64 target = cap / 10 * 9;
+        for (int i = 0; i < listing.count and listing.total_size > target; i++) {
+            char key_path[PATH_MAX + 8];
+            snprintf(key_path, sizeof(key_path), "%s" CACHE_KEY_SUFFIX, listing.entries[i].path);
+            unlink(key_path);
+
+            if (unlink(listing.entries[i].path) == 0 or errno == ENOENT) {
+                listing.total_size -= listing.entries[i].size;
+                removed++;
+            }
+        }
+    }
+
+    if (verbose) {
+        printf("Removed %d entries, %.1f MB left.\n", removed, listing.total_size / (1024.0 * 1024.0));
+    }
+
+    AWN_ArenaStateRestore(state);
+
+    return 0;
+}
+
+function void Aguilar_SharedCachePublish(arena_t *arena, const char* dir, cache_key_t key, const char* built)
+{
+    char entry[PATH_MAX];
+    Aguilar_FormatCacheEntryPath(entry, sizeof(entry), dir, key);
+
+    char bucket[PATH_MAX];
+    snprintf(bucket, sizeof(bucket), "%s", entry);
+    *strrchr(bucket, '/') = '\0';
+
+    struct stat sb;
+    if (!Aguilar_FileExists(built, &sb) or Aguilar_MakeDirs(bucket) != 0) {
+        return;
+    }
+
+    // NOTE(Alex): A failed publish only costs a future cache miss, so errors are ignored.
+    //              The key goes first, an entry without one is never served.
+    char key_path[PATH_MAX + 8];
+    char tmp[PATH_MAX + 64];
+    snprintf(key_path, sizeof(key_path), "%s" CACHE_KEY_SUFFIX, entry);
+    if (!Aguilar_FormatTempPath(tmp, sizeof(tmp), key_path)) {
+        return;
+    }
+
+    FILE* file = fopen(tmp, "w");
+    bool written = file != NULL and fwrite(key.input, 1, key.input_size, file) == key.input_size;
+    if (file == NULL or fclose(file) != 0 or !written or rename(tmp, key_path) != 0) {
+        unlink(tmp);
+        return;
+    }
+
+    Aguilar_CopyFile(built, entry, sb.st_mode);
+
+    // NOTE(Alex): Walking the whole cache is too slow to do on every publish, the low
+    //              bits of the key pick roughly one publish in sixteen to collect.
+    if ((key.lo & 0xf) == 0) {
+        Aguilar_SharedCacheCollect(arena, dir, false);
+    }
+}
+
+function int Aguilar_CachedBuildInstruction(arena_t *arena, char* source, char* args, char* link_args, char* output)
+{
+    const char* dir = Aguilar_GetSharedCacheDir();
+    if (dir == NULL) {
+        return Aguilar_RunBuildInstruction(arena, source, args, link_args, output);
+    }
+
+    if (args == 0) {
+        args = DEFAULT_FLAGS;
+    }
+
+    cache_key_t key;
+    if (Aguilar_ComputeBuildKey(arena, Aguilar_GetCompilerEnv(), source, args, link_args != 0 ? link_args : "", &key) != 0) {
+        // NOTE(Alex): Let the real compiler report what went wrong.
+        return Aguilar_RunBuildInstruction(arena, source, args, link_args, output);
+    }
+
+    if (Aguilar_SharedCacheFetch(arena, dir, key, output)) {
+        printf("Shared cache hit, not recompiling!\n");
+        return 0;
+    }
+
+    // NOTE(Alex): The key doesn't depend on where we are, so neither may the debug info.
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) != NULL) {
+        args = Aguilar_Format(arena, "%s -fdebug-prefix-map=%s=.", args, cwd);
+    }
+
+    int res = Aguilar_RunBuildInstruction(arena, source, args, link_args, output);
+
+    if (res == 0) {
+        Aguilar_SharedCachePublish(arena, dir, key, output);
+    }
+
+    return res;
+}
+
+function int Aguilar_RemoveTree(const char* path)
+{
+    struct stat sb;
+    if (lstat(path, &sb) != 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    if (S_ISDIR(sb.st_mode)) {
+        DIR* dir = opendir(path);
+        if (dir == NULL) {
+            return -1;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 or strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+
+            char child[PATH_MAX];
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            Aguilar_RemoveTree(child);
+        }
+
+        closedir(dir);
+        return rmdir(path);
+    }
+
+    return unlink(path);
+}
+
+function int Aguilar_Cache(arena_t *arena, const char* command)
+{
+    const char* dir = Aguilar_GetSharedCacheDir();
+    if (dir == NULL) {
+        Aguilar_SetError("No shared cache configured, set " ENV_CACHE_DIR "!");
+        return -1;
+    }
+
+    if (command == NULL or strcmp(command, "stats") == 0) {
+        cache_listing_t listing = Aguilar_SharedCacheList(arena, dir);
+
+        i64 oldest = 0;
+        i64 newest = 0;
+        for (int i = 0; i < listing.count; i++) {
+            if (oldest == 0 or listing.entries[i].mtime < oldest) {
+                oldest = listing.entries[i].mtime;
+            }
+            if (listing.entries[i].mtime > newest) {
+                newest = listing.entries[i].mtime;
+            }
+        }
+
+        i64 now = (i64)time(NULL) * 1000000000;
+
+        printf("Cache directory: %s\n", dir);
+        printf("Entries: %d\n", listing.count);
+        printf("Size: %.1f MB / %.1f MB\n", listing.total_size / (1024.0 * 1024.0), Aguilar_GetSharedCacheSize() / (1024.0 * 1024.0));
+        if (listing.count > 0) {
+            printf("Least recently used: %ld minutes ago\n", (now - oldest) / 60000000000);
+            printf("Most recently used: %ld minutes ago\n", (now - newest) / 60000000000);
+        }
+    } else if (strcmp(command, "gc") == 0) {
+        return Aguilar_SharedCacheCollect(arena, dir, true);
+    } else if (strcmp(command, "clear") == 0) {
+        char objects[PATH_MAX];
+        snprintf(objects, sizeof(objects), "%s/objects", dir);
+
+        if (Aguilar_RemoveTree(objects) != 0) {
+            Aguilar_SetError("Failed to clear the cache directory!");
+            return -1;
+        }
+
+        printf("Cleared %s\n", dir);
+    } else {
+        Aguilar_SetError("Unknown cache command, expected stats, gc or clear!");
+        return -1;
+    }
+
+    AWN_ArenaClear(arena);
+
+    return 1;
+}
+
+// NOTE(Alex): Reads a make style dependency file (as written by -MMD) and checks that
+//              none of the listed files changed after the target was built.
+function bool Aguilar_DepsUpToDate(arena_t *arena, const char* depfile, i64 target_mtime)
+{
+    FILE* file = fopen(depfile, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    arena_state_t state = AWN_ArenaStateRecord(arena);
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* contents = AWN_ArenaPush(arena, size + 1);
+    size = fread(contents, 1, size, file);
+    fclose(file);
+
+    char* cursor = strchr(contents, ':');
+    bool up_to_date = (cursor != NULL);
+
+    char name[PATH_MAX];
+    int name_length = 0;
+
+    for (cursor = cursor ? cursor + 1 : contents; up_to_date and cursor <= contents + size; cursor++) {
+        char c = *cursor;
+
+        if (c == '\\' and (cursor[1] == '\n' or cursor[1] == '\r')) {
+            cursor++;
+            continue;
+        }
+
+        if (c == '\\' and cursor[1] == ' ') {
+            c = ' ';
+            cursor++;
+        } else if (c == ' ' or c == '\t' or c == '\n' or c == '\r' or c == '\0') {
+            if (name_length > 0) {
+                name[name_length] = '\0';
+                name_length = 0;
+
+                struct stat sb;
+                if (!Aguilar_FileExists(name, &sb) or Aguilar_ModTime(&sb) > target_mtime) {
+                    up_to_date = false;
+                }
+            }
+
+            // NOTE(Alex): -MP adds phony targets for every header, only the first rule matters.
+            if (c == '\n' and cursor[1] != ' ' and cursor[1] != '\t') {
+                break;
+            }
+            continue;
+        }
+
+        if (name_length < (int)sizeof(name) - 1) {
+            name[name_length++] = c;
+        }
+    }
+
+    AWN_ArenaStateRestore(state);
+
+    return up_to_date;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Precompiled headers.
+//              Headers come from the pch line in .aguilar, or are the local headers that
+//              every source file in src/ includes before anything else. The header is built
+//              once per compiler, flag set and header contents, under .aguilar_build/pch.
+
+#define PCH_DIR BUILD_DIR "/pch"
+#define PCH_MAX_HEADERS 32
+// NOTE(Alex): Below this loading the PCH costs about as much as parsing the headers.
+#define PCH_AUTO_MIN_SIZE KB(16)
+
+STRUCT(pch_headers_t)
+{
+    char paths[PCH_MAX_HEADERS][PATH_MAX];
+    int count;
+};
+
+// NOTE(Alex): Only includes at the very top of a file count. Once a define or any code
+//              shows up, later headers might depend on it and cannot be precompiled.
+function void Aguilar_ScanLeadingIncludes(const char* source, pch_headers_t *headers)
+{
+    headers->count = 0;
+
+    line_reader_t reader;
+    if (!AWN_LineReaderOpen(&reader, source, KB(16))) {
+        AWN_LineReaderClose(&reader);
+        return;
+    }
+
+    const char* dir_end = strrchr(source, '/');
+    int dir_length = dir_end ? (int)(dir_end - source) + 1 : 0;
+
+    bool in_comment = false;
+    str_t line;
+
+    while (headers->count < PCH_MAX_HEADERS and AWN_LineReaderNext(&reader, &line)) {
+        line = AWN_StrTrim(line);
+
+        if (in_comment) {
+            in_comment = memmem(line.data, line.size, "*/", 2) == NULL;
+            continue;
+        }
+
+        if (line.size == 0 or AWN_StrStartsWith(line, AWN_StrLit("//"))) {
+            continue;
+        }
+
+        if (AWN_StrStartsWith(line, AWN_StrLit("/*"))) {
+            in_comment = memmem(line.data + 2, line.size - 2, "*/", 2) == NULL;
+            continue;
+        }
+
+        if (!AWN_StrStartsWith(line, AWN_StrLit("#include"))) {
+            break;
+        }
+
+        const char* open_quote = memchr(line.data, '"', line.size);
+        const char* close_quote = open_quote ? memchr(open_quote + 1, '"', line.data + line.size - open_quote - 1) : NULL;
+
+        // NOTE(Alex): System headers are pulled in by the local headers anyway.
+        if (close_quote == NULL) {
+            continue;
+        }
+
+        char* path = headers->paths[headers->count];
+        snprintf(path, PATH_MAX, "%.*s%.*s", dir_length, source, (int)(close_quote - open_quote - 1), open_quote + 1);
+
+        if (Aguilar_FileExists(path, 0)) {
+            headers->count++;
+        }
+    }
+
+    AWN_LineReaderClose(&reader);
+}
+
+// NOTE(Alex): The precompiled header is force included in front of files that include the same
+//              headers again, which is only harmless when the second include does nothing.
+//              Accepts #pragma once or an #ifndef/#define pair before anything else.
+function bool Aguilar_HeaderHasGuard(const char* path)
+{
+    file_view_t view;
+    if (!AWN_FileMap(&view, path)) {
+        return false;
+    }
+
+    str_t rest = view.data;
+    str_t line;
+    str_t guard = { 0 };
+    bool in_comment = false;
+    bool result = false;
+
+    while (AWN_StrNextLine(&rest, &line)) {
+        line = AWN_StrTrim(line);
+
+        if (in_comment) {
+            in_comment = memmem(line.data, line.size, "*/", 2) == NULL;
+            continue;
+        }
+
+        if (line.size == 0 or AWN_StrStartsWith(line, AWN_StrLit("//"))) {
+            continue;
+        }
+
+        if (AWN_StrStartsWith(line, AWN_StrLit("/*"))) {
+            in_comment = memmem(line.data + 2, line.size - 2, "*/", 2) == NULL;
+            continue;
+        }
+
+        if (line.data[0] != '#') {
+            break;
+        }
+
+        line = AWN_StrTrim((str_t){ line.data + 1, line.size - 1 });
+
+        if (guard.size == 0) {
+            if (AWN_StrStartsWith(line, AWN_StrLit("pragma once"))) {
+                result = true;
+                break;
+            }
+            if (!AWN_StrStartsWith(line, AWN_StrLit("ifndef "))) {
+                break;
+            }
+
+            str_t name = AWN_StrTrim((str_t){ line.data + 7, line.size - 7 });
+            guard = AWN_StrChop(&name, ' ');
+            if (guard.size == 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (AWN_StrStartsWith(line, AWN_StrLit("define "))) {
+            str_t name = AWN_StrTrim((str_t){ line.data + 7, line.size - 7 });
+            result = AWN_StrEq(AWN_StrChop(&name, ' '), guard);
+        }
+        break;
+    }
+
+    AWN_FileUnmap(&view);
+    return result;
+}
+
+// NOTE(Alex): The same header can be spelled differently from different directories.
+function bool Aguilar_SameFile(const char* a, const char* b)
+{
+    char real_a[PATH_MAX];
+    char real_b[PATH_MAX];
+
+    return realpath(a, real_a) != NULL and realpath(b, real_b) != NULL and strcmp(real_a, real_b) == 0;
+}
+
+// NOTE(Alex): The precompiled headers only go in front of a file that already starts by
+//              including all of them in the same order, so forcing them in changes nothing.
+function bool Aguilar_SourceStartsWithHeaders(const char* source, pch_headers_t *pch, pch_headers_t *scratch)
+{
+    if (pch->count == 0) {
+        return false;
+    }
+
+    Aguilar_ScanLeadingIncludes(source, scratch);
+    if (scratch->count < pch->count) {
+        return false;
+    }
+
+    for (int i = 0; i < pch->count; i++) {
+        if (!Aguilar_SameFile(scratch->paths[i], pch->paths[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+function void Aguilar_FindCommonHeaders(pch_headers_t *headers)
+{
+    headers->count = 0;
+
+    DIR* dir = opendir("src");
+    if (dir == NULL) {
+        return;
+    }
+
+    bool first = true;
+    struct dirent *entry;
+    pch_headers_t *file_headers = malloc(sizeof(pch_headers_t));
+
+    while ((entry = readdir(dir)) != NULL) {
+        usize length = strlen(entry->d_name);
+        if (length < 3 or strcmp(entry->d_name + length - 2, ".c") != 0) {
+            continue;
+        }
+
+        char source[PATH_MAX];
+        snprintf(source, sizeof(source), "src/%s", entry->d_name);
+        Aguilar_ScanLeadingIncludes(source, file_headers);
+
+        if (first) {
+            memcpy(headers, file_headers, sizeof(pch_headers_t));
+            first = false;
+            continue;
+        }
+
+        // NOTE(Alex): Keep the common prefix, the order has to match in every file.
+        int common = 0;
+        while (common < headers->count and common < file_headers->count
+                and strcmp(headers->paths[common], file_headers->paths[common]) == 0) {
+            common++;
+        }
+        headers->count = common;
+    }
+
+    free(file_headers);
+    closedir(dir);
+
+    usize total_size = 0;
+    for (int i = 0; i < headers->count; i++) {
+        struct stat sb;
+        if (Aguilar_FileExists(headers->paths[i], &sb)) {
+            total_size += sb.st_size;
+        }
+    }
+
+    if (total_size < PCH_AUTO_MIN_SIZE) {
+        headers->count = 0;
+    }
+}
+
+function void Aguilar_PrunePch(const char* keep)
+{
+    DIR* dir = opendir(PCH_DIR);
+    if (dir == NULL) {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' or strcmp(entry->d_name, keep) == 0) {
+            continue;
+        }
+
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", PCH_DIR, entry->d_name);
+        Aguilar_RemoveTree(path);
+    }
+
+    closedir(dir);
+}
+
+// NOTE(Alex): Returns the flags that make a compile use the precompiled header, or an empty
+//              string when there is nothing worth precompiling (or building it failed).
+//              *out_headers lists what was precompiled, only sources that start with those
+//              includes (Aguilar_SourceStartsWithHeaders) may get the flags.
+function char* Aguilar_PreparePch(arena_t *arena, project_config_t *config, const char* args, pch_headers_t **out_headers)
+{
+    const char* compiler = Aguilar_GetCompilerEnv();
+    bool clang = (strcmp(compiler, CALL_CLANG) == 0);
+
+    pch_headers_t *headers = AWN_ArenaPush(arena, sizeof(pch_headers_t));
+    headers->count = 0;
+    *out_headers = headers;
+
+    if (config->pch != 0 and strcmp(config->pch, " none") == 0) {
+        return "";
+    } else if (config->pch != 0) {
+        char* list = config->pch;
+        char* token;
+
+        while ((token = strtok(list, " ")) != NULL and headers->count < PCH_MAX_HEADERS) {
+            list = NULL;
+
+            char* path = headers->paths[headers->count];
+            snprintf(path, PATH_MAX, "%s", token);
+            if (!Aguilar_FileExists(path, 0)) {
+                snprintf(path, PATH_MAX, "src/%s", token);
+            }
+
+            if (!Aguilar_FileExists(path, 0)) {
+                printf("Precompiled header %s not found, skipping it.\n", token);
+                continue;
+            }
+
+            headers->count++;
+        }
+    } else {
+        Aguilar_FindCommonHeaders(headers);
+    }
+
+    // NOTE(Alex): Later headers may rely on the one without a guard, so the list stops there.
+    for (int i = 0; i < headers->count; i++) {
+        if (!Aguilar_HeaderHasGuard(headers->paths[i])) {
+            printf("Precompiled header %s has no include guard or #pragma once, not precompiling it or anything after it.\n", headers->paths[i]);
+            headers->count = i;
+            break;
+        }
+    }
+
+    if (headers->count == 0) {
+        return "";
+    }
+
+    u64 key = Aguilar_HashCompiler(arena, HASH_SEED, compiler);
+    key = Aguilar_HashString(key, args);
+
+    for (int i = 0; i < headers->count; i++) {
+        u64 content = 0;
+        if (Aguilar_HashFile(headers->paths[i], &content) != 0) {
+            return "";
+        }
+
+        key = Aguilar_HashString(key, headers->paths[i]);
+        key = Aguilar_HashBytes(key, &content, sizeof(content));
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016lx", key);
+
+    char* wrapper = AWN_ArenaPush(arena, sizeof(char) * PATH_MAX);
+    char* output = AWN_ArenaPush(arena, sizeof(char) * PATH_MAX);
+    char* depfile = AWN_ArenaPush(arena, sizeof(char) * PATH_MAX);
+
+    snprintf(wrapper, PATH_MAX, "%s/%s/aguilar_pch.h", PCH_DIR, name);
+    snprintf(output, PATH_MAX, "%s%s", wrapper, clang ? ".pch" : ".gch");
+    snprintf(depfile, PATH_MAX, "%s/%s/aguilar_pch.d", PCH_DIR, name);
+
+    char* flags = AWN_ArenaPush(arena, sizeof(char) * (PATH_MAX + 32));
+    if (clang) {
+        snprintf(flags, PATH_MAX + 32, " -include-pch %s", output);
+    } else {
+        snprintf(flags, PATH_MAX + 32, " -include %s", wrapper);
+    }
+
+    // NOTE(Alex): The key covers the listed headers, the depfile catches anything they include.
+    struct stat sb;
+    if (Aguilar_FileExists(output, &sb) and Aguilar_DepsUpToDate(arena, depfile, Aguilar_ModTime(&sb))) {
+        return flags;
+    }
+
+    Aguilar_PrunePch(name);
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/%s", PCH_DIR, name);
+    if (Aguilar_MakeDirs(dir) != 0) {
+        return "";
+    }
+
+    FILE* file = fopen(wrapper, "w");
+    if (file == NULL) {
+        return "";
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        fclose(file);
+        return "";
+    }
+
+    for (int i = 0; i < headers->count; i++) {
+        fprintf(file, "#include \"%s/%s\"\n", cwd, headers->paths[i]);
+    }
+    fclose(file);
+
+    char* command = AWN_ArenaPush(arena, sizeof(char) * (strlen(compiler) + strlen(args) + PATH_MAX * 3 + 64));
+    sprintf(command, "%s %s -x c-header -MMD -MF %s -o %s %s", compiler, args, depfile, output, wrapper);
+
+    printf("%s\n", command);
+    fflush(stdout);
+
+    f64 start = Aguilar_TimeMs();
+    if (system(command) != 0) {
+        printf("Failed to build the precompiled header, building without it.\n");
+        unlink(output);
+        return "";
+    }
+
+    printf("Precompiled header: %.1f ms\n", Aguilar_TimeMs() - start);
+
+    return flags;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Build graph.
+//              Nodes are shell commands (compiles and links), edges say which outputs a
+//              command needs. Only out of date nodes get a command, and anything whose
+//              inputs are all finished is started right away, up to the job limit.
+
+#define ENV_JOBS "AGUILAR_JOBS"
+#define OBJ_DIR BUILD_DIR "/obj"
+#define BUILD_STAMP OBJ_DIR "/stamp"
+
+STRUCT(build_node_t)
+{
+    char* command;
+    char* output;
+    bool is_link;
+
+    // NOTE(Alex): Compile nodes keep their pieces too, for handing them to a worker.
+    char* source;
+    char* args;
+    char* depfile;
+
+    int* dependents;
+    int dependent_count;
+    int pending;
+
+    pid_t pid;
+    f64 start;
+};
+
+STRUCT(build_graph_t)
+{
+    build_node_t* nodes;
+    int node_count;
+};
+
+function int Aguilar_GraphAddNode(arena_t *arena, build_graph_t *graph, char* output, bool is_link)
+{
+    graph->nodes = Aguilar_ArrayReserve(arena, graph->nodes, graph->node_count, sizeof(build_node_t));
+
+    build_node_t *node = &graph->nodes[graph->node_count];
+    memset(node, 0, sizeof(build_node_t));
+    node->output = output;
+    node->is_link = is_link;
+
+    return graph->node_count++;
+}
+
+// NOTE(Alex): Only edges between nodes that actually run matter for scheduling.
+function void Aguilar_GraphAddEdge(arena_t *arena, build_graph_t *graph, int from, int to)
+{
+    build_node_t *node = &graph->nodes[from];
+    if (node->command == 0 or graph->nodes[to].command == 0) {
+        return;
+    }
+
+    node->dependents = Aguilar_ArrayReserve(arena, node->dependents, node->dependent_count, sizeof(int));
+    node->dependents[node->dependent_count++] = to;
+    graph->nodes[to].pending++;
+}
+
+function int Aguilar_GetJobCount()
+{
+    const char* env = getenv(ENV_JOBS);
+    int jobs = env != NULL ? atoi(env) : 0;
+
+    if (jobs <= 0) {
+        jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    return jobs > 0 ? jobs : 1;
+}
+
+function pid_t Aguilar_SpawnShell(const char* command)
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // NOTE(Alex): A single argument is capped at 128 KB (MAX_ARG_STRLEN), which the link line
+        //              of a few thousand objects passes, so long commands are read from a script.
+        usize length = strlen(command);
+        if (length > KB(64)) {
+            int fd = memfd_create("aguilar-command", 0);
+            usize written = 0;
+
+            while (fd >= 0 and written < length) {
+                ssize_t count = write(fd, command + written, length - written);
+                if (count <= 0) {
+                    _exit(127);
+                }
+                written += (usize)count;
+            }
+
+            char script[64];
+            snprintf(script, sizeof(script), "/proc/self/fd/%d", fd);
+            execl("/bin/sh", "sh", script, (char*)NULL);
+            _exit(127);
+        }
+
+        execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+        _exit(127);
+    }
+
+    return pid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Distributed compilation.
+//              With AGUILAR_WORKERS=host:port,host:port the object files of a multi target build
+//              are preprocessed locally and compiled by `aguilar worker` processes, which only
+//              need a matching compiler, not the project's headers. A job tries every worker once,
+//              starting from one picked by the source's hash, and is compiled locally when none of
+//              them answer. Workers keep their own content addressed cache, so the same
+//              preprocessed input is only compiled once per worker no matter who sends it.
+//
+// WARNING(Alex): Workers do not authenticate anyone, only bind them to networks you trust.
+#define ENV_WORKERS "AGUILAR_WORKERS"
+#define WORKER_DEFAULT_PORT "7474"
+#define WORKER_DEFAULT_BIND "127.0.0.1"
+#define WORKER_MAGIC 0x41475732ULL
+#define WORKER_CACHE_PATH "/.cache/aguilar/worker"
+#define WORKER_CONNECT_TIMEOUT_MS 2000
+#define WORKER_IO_TIMEOUT_S 600
+#define WORKER_MAX_BLOB MB(512)
+
+ENUM(worker_status_t)
+{
+    WORKER_OK,
+    WORKER_MISMATCH,
+    WORKER_COMPILE_FAILED,
+    WORKER_REJECTED,
+    WORKER_UNAVAILABLE,
+};
+
+function bool Aguilar_WriteAll(int fd, const void* data, usize size)
+{
+    const u8* cursor = data;
+    while (size > 0) {
+        ssize_t written = send(fd, cursor, size, MSG_NOSIGNAL);
+        if (written < 0 and errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        cursor += written;
+        size -= written;
+    }
+    return true;
+}
+
+function bool Aguilar_ReadAll(int fd, void* data, usize size)
+{
+    u8* cursor = data;
+    while (size > 0) {
+        ssize_t count = recv(fd, cursor, size, 0);
+        if (count < 0 and errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        cursor += count;
+        size -= count;
+    }
+    return true;
+}
+
+// NOTE(Alex): Everything on the wire is a big endian u64, or a u64 length and that many bytes.
+function bool Aguilar_WriteU64(int fd, u64 value)
+{
+    u64 wire = htobe64(value);
+    return Aguilar_WriteAll(fd, &wire, sizeof(wire));
+}
+
+function bool Aguilar_ReadU64(int fd, u64* value)
+{
+    u64 wire;
+    if (!Aguilar_ReadAll(fd, &wire, sizeof(wire))) {
+        return false;
+    }
+    *value = be64toh(wire);
+    return true;
+}
+
+function bool Aguilar_WriteBlob(int fd, const void* data, usize size)
+{
+    return Aguilar_WriteU64(fd, size) and Aguilar_WriteAll(fd, data, size);
+}
+
+// NOTE(Alex): Blobs can be whole object files, so they live on the heap and not the arena.
+function char* Aguilar_ReadBlob(int fd, usize* size)
+{
+    u64 length;
+    if (!Aguilar_ReadU64(fd, &length) or length > WORKER_MAX_BLOB) {
+        return NULL;
+    }
+
+    char* data = malloc(length + 1);
+    if (data == NULL or !Aguilar_ReadAll(fd, data, length)) {
+        free(data);
+        return NULL;
+    }
+
+    data[length] = '\0';
+    *size = length;
+    return data;
+}
+
+function char* Aguilar_ReadWholeFile(const char* path, usize* size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat sb;
+    if (fd < 0 or fstat(fd, &sb) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    char* data = malloc(sb.st_size + 1);
+    usize total = 0;
+    while (data != NULL and total < (usize)sb.st_size) {
+        ssize_t count = read(fd, data + total, sb.st_size - total);
+        if (count <= 0) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        total += count;
+    }
+
+    close(fd);
+
+    if (data != NULL) {
+        data[total] = '\0';
+        *size = total;
+    }
+    return data;
+}
+
+// NOTE(Alex): Paths and mtimes differ between machines, so workers are matched on what the
+//              compiler says it is: its version line (minus the program name) and target.
+function char* Aguilar_CompilerIdentity(arena_t *arena, const char* compiler)
+{
+    char* command = Aguilar_Format(arena, "%s --version 2>/dev/null | head -n 1; %s -dumpmachine 2>/dev/null", compiler, compiler);
+    FILE* pipe = popen(command, "r");
+    if (pipe == NULL) {
+        return NULL;
+    }
+
+    char output[512];
+    usize length = fread(output, 1, sizeof(output) - 1, pipe);
+    output[length] = '\0';
+
+    if (pclose(pipe) != 0 or length == 0) {
+        return NULL;
+    }
+
+    char* version = strchr(output, ' ');
+    return Aguilar_Format(arena, "%s", version != NULL ? version + 1 : output);
+}
+
+function bool Aguilar_ArgHasValue(const char* token)
+{
+    const char* separate[] = { "-I", "-D", "-U", "-include", "-include-pch", "-imacros", "-isystem", "-iquote", "-idirafter", "-MF", "-MT", "-MQ" };
+    for (usize i = 0; i < sizeof(separate) / sizeof(separate[0]); i++) {
+        if (strcmp(token, separate[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// NOTE(Alex): The worker gets preprocessed input, so anything that only affects the
+//              preprocessor (or points at local files) is dropped.
+function char* Aguilar_RemoteArgs(arena_t *arena, char* args)
+{
+    int count = 0;
+    char** tokens = Aguilar_SplitList(arena, args, &count);
+
+    char* result = AWN_ArenaPush(arena, strlen(args) + 1);
+    usize length = 0;
+
+    for (int i = 0; i < count; i++) {
+        const char* token = tokens[i];
+        if (Aguilar_ArgHasValue(token)) {
+            i++;
+            continue;
+        }
+        if (strncmp(token, "-I", 2) == 0 or strncmp(token, "-D", 2) == 0 or strncmp(token, "-U", 2) == 0 or
+            strncmp(token, "-M", 2) == 0 or strncmp(token, "-include", 8) == 0 or strncmp(token, "-isystem", 8) == 0 or
+            strncmp(token, "-iquote", 7) == 0) {
+            continue;
+        }
+
+        length += sprintf(result + length, "%s%s", length > 0 ? " " : "", token);
+    }
+
+    return result;
+}
+
+// NOTE(Alex): Workers run the compiler for anyone, so only flags that change code generation or
+//              warnings are accepted, none of them may name a path, and the compiler is exec'd
+//              without a shell. Path-free -f flags are fine except the ones that load code or
+//              read and write files next to the compiler. Anything else is compiled locally.
+function bool Aguilar_WorkerArgAllowed(const char* token)
+{
+    if (strchr(token, '/') != NULL) {
+        return false;
+    }
+
+    const char* refused[] = { "-fplugin", "-fprofile", "-fauto-profile", "-fdump", "-fopt-info", "-fcallgraph-info", "-fsave-optimization-record" };
+    for (usize i = 0; i < sizeof(refused) / sizeof(refused[0]); i++) {
+        if (strncmp(token, refused[i], strlen(refused[i])) == 0) {
+            return false;
+        }
+    }
+
+    if (strncmp(token, "-W", 2) == 0) {
+        return strncmp(token, "-Wa,", 4) != 0 and strncmp(token, "-Wl,", 4) != 0 and strncmp(token, "-Wp,", 4) != 0;
+    }
+
+    return strcmp(token, "-w") == 0 or strncmp(token, "-f", 2) == 0 or strncmp(token, "-O", 2) == 0 or
+           strncmp(token, "-g", 2) == 0 or strncmp(token, "-m", 2) == 0 or strncmp(token, "-std=", 5) == 0;
+}
+
+function bool Aguilar_WorkerArgsAllowed(char* args)
+{
+    for (char* cursor = args; *cursor != '\0'; cursor++) {
+        if (!isalnum((unsigned char)*cursor) and strchr(" -_=.,+:/", *cursor) == NULL) {
+            return false;
+        }
+    }
+
+    char* copy = strdup(args);
+    char* saveptr = NULL;
+    bool allowed = copy != NULL;
+
+    for (char* token = strtok_r(copy, " ", &saveptr); token != NULL and allowed; token = strtok_r(NULL, " ", &saveptr)) {
+        allowed = Aguilar_WorkerArgAllowed(token);
+    }
+
+    free(copy);
+    return allowed;
+}
+
+function void Aguilar_WorkerReply(int fd, worker_status_t status, const char* diagnostics, usize diagnostics_size, const char* object, usize object_size)
+{
+    if (Aguilar_WriteU64(fd, status) and Aguilar_WriteBlob(fd, diagnostics, diagnostics_size)) {
+        Aguilar_WriteBlob(fd, object, object_size);
+    }
+}
+
+function void Aguilar_WorkerHandle(arena_t *arena, int fd, const char* identity, const char* cache_dir)
+{
+    struct timeval timeout = { WORKER_IO_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    u64 magic = 0;
+    usize client_size = 0;
+    usize cwd_size = 0;
+    usize args_size = 0;
+    usize input_size = 0;
+
+    if (!Aguilar_ReadU64(fd, &magic) or magic != WORKER_MAGIC) {
+        return;
+    }
+
+    char* client_identity = Aguilar_ReadBlob(fd, &client_size);
+    char* cwd = client_identity != NULL ? Aguilar_ReadBlob(fd, &cwd_size) : NULL;
+    char* args = cwd != NULL ? Aguilar_ReadBlob(fd, &args_size) : NULL;
+    char* input = args != NULL ? Aguilar_ReadBlob(fd, &input_size) : NULL;
+
+    if (input == NULL) {
+        return;
+    }
+
+    if (strcmp(client_identity, identity) != 0) {
+        Aguilar_WorkerReply(fd, WORKER_MISMATCH, identity, strlen(identity), "", 0);
+        return;
+    }
+
+    if (!Aguilar_WorkerArgsAllowed(args) or cwd[0] != '/' or strchr(cwd, '\n') != NULL) {
+        const char* message = "aguilar worker: refusing these compiler flags\n";
+        Aguilar_WorkerReply(fd, WORKER_REJECTED, message, strlen(message), "", 0);
+        return;
+    }
+
+    char* key_input = NULL;
+    usize key_input_size = 0;
+    FILE* key_stream = open_memstream(&key_input, &key_input_size);
+    if (key_stream == NULL) {
+        return;
+    }
+    fprintf(key_stream, "identity %s\ncwd %s\nargs %s\n", identity, cwd, args);
+    fwrite(input, 1, input_size, key_stream);
+    fclose(key_stream);
+    cache_key_t key = Aguilar_CacheKeyFromInput(arena, key_input, key_input_size);
+
+    char dir[] = "/tmp/aguilar-worker-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        return;
+    }
+
+    char* source = Aguilar_Format(arena, "%s/input.i", dir);
+    char* object = Aguilar_Format(arena, "%s/output.o", dir);
+    char* log = Aguilar_Format(arena, "%s/output.log", dir);
+
+    worker_status_t status = WORKER_OK;
+
+    if (!Aguilar_SharedCacheFetch(arena, cache_dir, key, object)) {
+        int source_fd = open(source, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        bool written = source_fd >= 0 and write(source_fd, input, input_size) == (ssize_t)input_size;
+        if (source_fd >= 0) {
+            close(source_fd);
+        }
+
+        int count = 0;
+        char** tokens = Aguilar_SplitList(arena, args, &count);
+        char** argv = AWN_ArenaPush(arena, sizeof(char*) * (count + 9));
+
+        // NOTE(Alex): The compiler runs inside the temporary directory and maps it to the
+        //              client's directory, so DW_AT_comp_dir names where the sources live and not
+        //              the worker. GCC has no -fdebug-compilation-dir, but both take the prefix map.
+        int argc = 0;
+        argv[argc++] = (char*)Aguilar_GetCompilerEnv();
+        for (int i = 0; i < count; i++) {
+            argv[argc++] = tokens[i];
+        }
+        argv[argc++] = Aguilar_Format(arena, "-fdebug-prefix-map=%s=%s", dir, cwd);
+        argv[argc++] = "-x";
+        argv[argc++] = "cpp-output";
+        argv[argc++] = "-c";
+        argv[argc++] = "-o";
+        argv[argc++] = object;
+        argv[argc++] = source;
+        argv[argc] = NULL;
+
+        pid_t pid = written ? fork() : -1;
+        if (pid == 0) {
+            int log_fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+            dup2(log_fd, STDOUT_FILENO);
+            dup2(log_fd, STDERR_FILENO);
+            if (chdir(dir) != 0) {
+                _exit(127);
+            }
+            execvp(argv[0], argv);
+            _exit(127);
+        }
+
+        int exit_status = 1;
+        while (pid > 0 and waitpid(pid, &exit_status, 0) < 0 and errno == EINTR) {}
+
+        if (pid > 0 and WIFEXITED(exit_status) and WEXITSTATUS(exit_status) == 0) {
+            Aguilar_SharedCachePublish(arena, cache_dir, key, object);
+        } else {
+            status = WORKER_COMPILE_FAILED;
+        }
+    }
+
+    usize log_size = 0;
+    usize object_size = 0;
+    char* log_data = Aguilar_ReadWholeFile(log, &log_size);
+    char* object_data = status == WORKER_OK ? Aguilar_ReadWholeFile(object, &object_size) : NULL;
+
+    if (status == WORKER_OK and object_data == NULL) {
+        status = WORKER_COMPILE_FAILED;
+    }
+
+    Aguilar_WorkerReply(fd, status, log_data != NULL ? log_data : "", log_size, object_data != NULL ? object_data : "", object_size);
+
+    free(log_data);
+    free(object_data);
+    unlink(source);
+    unlink(object);
+    unlink(log);
+    rmdir(dir);
+}
+
+function int Aguilar_Worker(arena_t *arena, const char* port, const char* bind_address)
+{
+    const char* compiler = Aguilar_GetCompilerEnv();
+    char* identity = Aguilar_CompilerIdentity(arena, compiler);
+    if (identity == NULL) {
+        Aguilar_SetError("Failed to ask the compiler for its version!");
+        return -1;
+    }
+
+    const char* home = getenv("HOME");
+    if (home == NULL) {
+        Aguilar_SetError("Failed to get home directory!");
+        return -1;
+    }
+    char* cache_dir = Aguilar_Format(arena, "%s%s", home, WORKER_CACHE_PATH);
+
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo* addresses = NULL;
+    if (getaddrinfo(bind_address, port, &hints, &addresses) != 0) {
+        Aguilar_SetError("Failed to resolve the bind address!");
+        return -1;
+    }
+
+    int listen_fd = -1;
+    for (struct addrinfo* address = addresses; address != NULL and listen_fd < 0; address = address->ai_next) {
+        listen_fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (listen_fd < 0) {
+            continue;
+        }
+
+        int enable = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        if (bind(listen_fd, address->ai_addr, address->ai_addrlen) != 0 or listen(listen_fd, 128) != 0) {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (listen_fd < 0) {
+        Aguilar_SetError("Failed to listen on the worker port!");
+        return -1;
+    }
+
+    int slots = Aguilar_GetJobCount();
+    int children = 0;
+
+    printf("Worker listening on %s:%s with %d slots, compiler: %.*s\n", bind_address, port, slots, (int)strcspn(identity, "\n"), identity);
+    fflush(stdout);
+
+    for (;;) {
+        // NOTE(Alex): One job per core, extra connections wait in the listen backlog.
+        while (children > 0 and waitpid(-1, NULL, children >= slots ? 0 : WNOHANG) > 0) {
+            children--;
+        }
+
+        int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR or errno == ECONNABORTED) {
+                continue;
+            }
+            Aguilar_SetError("Failed to accept a connection!");
+            return -1;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listen_fd);
+            Aguilar_WorkerHandle(arena, client, identity, cache_dir);
+            _exit(0);
+        }
+
+        close(client);
+        if (pid > 0) {
+            children++;
+        }
+    }
+}
+
+function int Aguilar_ConnectWorker(const char* worker)
+{
+    char host[256];
+    const char* colon = strrchr(worker, ':');
+    const char* port = colon != NULL ? colon + 1 : WORKER_DEFAULT_PORT;
+    usize host_length = colon != NULL ? (usize)(colon - worker) : strlen(worker);
+
+    if (host_length == 0 or host_length >= sizeof(host)) {
+        return -1;
+    }
+    memcpy(host, worker, host_length);
+    host[host_length] = '\0';
+
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* addresses = NULL;
+    if (getaddrinfo(host, port, &hints, &addresses) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* address = addresses; address != NULL and fd < 0; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        // NOTE(Alex): A dead host should cost a couple of seconds, not the TCP default.
+        int result = connect(fd, address->ai_addr, address->ai_addrlen);
+        if (result != 0 and errno == EINPROGRESS) {
+            struct pollfd poll_fd = { fd, POLLOUT, 0 };
+            int error = 0;
+            socklen_t error_size = sizeof(error);
+
+            if (poll(&poll_fd, 1, WORKER_CONNECT_TIMEOUT_MS) == 1 and
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_size) == 0 and error == 0) {
+                result = 0;
+            }
+        }
+
+        if (result != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (fd >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+        struct timeval timeout = { WORKER_IO_TIMEOUT_S, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+
+    return fd;
+}
+
+function worker_status_t Aguilar_WorkerCompile(const char* worker, const char* identity, const char* cwd, const char* args, const char* input, usize input_size, const char* object)
+{
+    int fd = Aguilar_ConnectWorker(worker);
+    if (fd < 0) {
+        return WORKER_UNAVAILABLE;
+    }
+
+    u64 status = WORKER_UNAVAILABLE;
+    usize diagnostics_size = 0;
+    usize object_size = 0;
+    char* diagnostics = NULL;
+    char* object_data = NULL;
+
+    if (Aguilar_WriteU64(fd, WORKER_MAGIC) and Aguilar_WriteBlob(fd, identity, strlen(identity)) and
+        Aguilar_WriteBlob(fd, cwd, strlen(cwd)) and Aguilar_WriteBlob(fd, args, strlen(args)) and Aguilar_WriteBlob(fd, input, input_size) and
+        Aguilar_ReadU64(fd, &status)) {
+        diagnostics = Aguilar_ReadBlob(fd, &diagnostics_size);
+        object_data = diagnostics != NULL ? Aguilar_ReadBlob(fd, &object_size) : NULL;
+    }
+
+    close(fd);
+
+    if (object_data == NULL or status > WORKER_UNAVAILABLE) {
+        status = WORKER_UNAVAILABLE;
+    } else if (status == WORKER_MISMATCH) {
+        fprintf(stderr, "Worker %s has a different compiler: %.*s\n", worker, (int)strcspn(diagnostics, "\n"), diagnostics);
+    } else if (status == WORKER_OK or status == WORKER_COMPILE_FAILED or status == WORKER_REJECTED) {
+        fwrite(diagnostics, 1, diagnostics_size, stderr);
+    }
+
+    if (status == WORKER_OK) {
+        char tmp_path[PATH_MAX];
+        Aguilar_FormatTempPath(tmp_path, sizeof(tmp_path), object);
+
+        int out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        bool written = out >= 0 and write(out, object_data, object_size) == (ssize_t)object_size;
+        if (out >= 0) {
+            written = (close(out) == 0) and written;
+        }
+
+        if (!written or rename(tmp_path, object) != 0) {
+            unlink(tmp_path);
+            status = WORKER_UNAVAILABLE;
+        }
+    }
+
+    free(diagnostics);
+    free(object_data);
+
+    return (worker_status_t)status;
+}
+
+// NOTE(Alex): Runs in a forked child of the build graph, the exit code is the result.
+function int Aguilar_RemoteCompile(arena_t *arena, char** workers, int worker_count, const char* identity, const char* source, char* args, const char* depfile, const char* object)
+{
+    const char* compiler = Aguilar_GetCompilerEnv();
+    char* preprocessed = Aguilar_Format(arena, "%s.i", object);
+
+    char* command = Aguilar_Format(arena, "%s %s -E -MMD -MF %s -MT %s -o %s %s", compiler, args, depfile, object, preprocessed, source);
+    if (system(command) != 0) {
+        unlink(preprocessed);
+        return 1;
+    }
+
+    usize input_size = 0;
+    char* input = Aguilar_ReadWholeFile(preprocessed, &input_size);
+    char* remote_args = Aguilar_RemoteArgs(arena, args);
+    char cwd[PATH_MAX];
+
+    // NOTE(Alex): Flags a worker would refuse are checked here, so no worker is asked at all.
+    if (input != NULL and identity != NULL and Aguilar_WorkerArgsAllowed(remote_args) and getcwd(cwd, sizeof(cwd)) != NULL) {
+        int first = (int)(Aguilar_HashString(HASH_SEED, source) % worker_count);
+
+        for (int i = 0; i < worker_count; i++) {
+            const char* worker = workers[(first + i) % worker_count];
+            worker_status_t status = Aguilar_WorkerCompile(worker, identity, cwd, remote_args, input, input_size, object);
+
+            if (status == WORKER_OK or status == WORKER_COMPILE_FAILED) {
+                free(input);
+                unlink(preprocessed);
+                return status == WORKER_OK ? 0 : 1;
+            }
+
+            // NOTE(Alex): Every worker runs the same checks, the next one would refuse as well.
+            if (status == WORKER_REJECTED) {
+                break;
+            }
+
+            if (status == WORKER_UNAVAILABLE) {
+                fprintf(stderr, "Worker %s unavailable, retrying elsewhere.\n", worker);
+            }
+        }
+    }
+
+    free(input);
+
+    // NOTE(Alex): Every worker failed, the preprocessed file still compiles right here.
+    printf("No worker available, compiling %s locally.\n", source);
+    fflush(stdout);
+
+    command = Aguilar_Format(arena, "%s %s -x cpp-output -c -o %s %s", compiler, remote_args, object, preprocessed);
+    int result = system(command);
+    unlink(preprocessed);
+
+    return result == 0 ? 0 : 1;
+}
+
+function char** Aguilar_GetWorkers(arena_t *arena, int* count)
+{
+    *count = 0;
+
+    const char* env = getenv(ENV_WORKERS);
+    if (env == NULL or env[0] == '\0') {
+        return NULL;
+    }
+
+    char* list = Aguilar_Format(arena, "%s", env);
+    for (char* cursor = list; *cursor != '\0'; cursor++) {
+        if (*cursor == ',') {
+            *cursor = ' ';
+        }
+    }
+
+    return Aguilar_SplitList(arena, list, count);
+}
+
+function int Aguilar_RunGraph(arena_t *arena, build_graph_t *graph, int jobs, f64* compile_ms, f64* link_ms)
+{
+    int* ready = AWN_ArenaPush(arena, sizeof(int) * (graph->node_count + 1));
+    int ready_count = 0;
+
+    for (int i = 0; i < graph->node_count; i++) {
+        if (graph->nodes[i].command != 0 and graph->nodes[i].pending == 0) {
+            ready[ready_count++] = i;
+        }
+    }
+
+    int worker_count = 0;
+    char** workers = Aguilar_GetWorkers(arena, &worker_count);
+    char* identity = NULL;
+
+    if (worker_count > 0) {
+        identity = Aguilar_CompilerIdentity(arena, Aguilar_GetCompilerEnv());
+
+        // NOTE(Alex): Local cores only preprocess now, so keep every worker busy too.
+        if (getenv(ENV_JOBS) == NULL) {
+            jobs *= worker_count + 1;
+        }
+    }
+
+    int running = 0;
+    bool failed = false;
+
+    for (;;) {
+        while (!failed and running < jobs and ready_count > 0) {
+            build_node_t *node = &graph->nodes[ready[--ready_count]];
+
+            printf("%s\n", node->command);
+
+            node->start = Aguilar_TimeMs();
+
+            if (worker_count > 0 and !node->is_link and node->source != 0) {
+                fflush(stdout);
+                fflush(stderr);
+
+                node->pid = fork();
+                if (node->pid == 0) {
+                    _exit(Aguilar_RemoteCompile(arena, workers, worker_count, identity, node->source, node->args, node->depfile, node->output));
+                }
+            } else {
+                node->pid = Aguilar_SpawnShell(node->command);
+            }
+
+            if (node->pid < 0) {
+                Aguilar_SetError("Failed to start a build process!");
+                failed = true;
+                break;
+            }
+
+            running++;
+        }
+
+        if (running == 0) {
+            break;
+        }
+
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int i = 0; i < graph->node_count; i++) {
+            build_node_t *node = &graph->nodes[i];
+            if (node->pid != pid or node->command == 0) {
+                continue;
+            }
+
+            node->pid = 0;
+            running--;
+
+            f64 elapsed = Aguilar_TimeMs() - node->start;
+            *(node->is_link ? link_ms : compile_ms) += elapsed;
+
+            if (!WIFEXITED(status) or WEXITSTATUS(status) != 0) {
+                // NOTE(Alex): Let the running jobs finish, but start nothing new.
+                unlink(node->output);
+                failed = true;
+                break;
+            }
+
+            for (int d = 0; d < node->dependent_count; d++) {
+                if (--graph->nodes[node->dependents[d]].pending == 0) {
+                    ready[ready_count++] = node->dependents[d];
+                }
+            }
+            break;
+        }
+    }
+
+    if (failed) {
+        Aguilar_SetError("Compiler encountered an error!");
+        return -1;
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Multi target builds.
+//              Every source is compiled once into .aguilar_build/obj, no matter how many
+//              targets use it. Objects rebuild when their -MMD depfile says so, targets
+//              relink when any of their inputs are newer, and a stamp of the flags forces
+//              everything to rebuild when those change.
+
+function int Aguilar_CompareStrings(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// NOTE(Alex): Directories stand for every .c file directly inside them.
+function char** Aguilar_ExpandSources(arena_t *arena, build_target_t *target, int* count)
+{
+    char** result = 0;
+    *count = 0;
+
+    for (int i = 0; i < target->source_count; i++) {
+        struct stat sb;
+        if (!Aguilar_FileExists(target->sources[i], &sb) or !S_ISDIR(sb.st_mode)) {
+            result = Aguilar_ArrayReserve(arena, result, *count, sizeof(char*));
+            result[(*count)++] = target->sources[i];
+            continue;
+        }
+
+        DIR* dir = opendir(target->sources[i]);
+        if (dir == NULL) {
+            continue;
+        }
+
+        int first = *count;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            usize length = strlen(entry->d_name);
+            if (length < 3 or strcmp(entry->d_name + length - 2, ".c") != 0) {
+                continue;
+            }
+
+            result = Aguilar_ArrayReserve(arena, result, *count, sizeof(char*));
+            result[(*count)++] = Aguilar_Format(arena, "%s/%s", target->sources[i], entry->d_name);
+        }
+
+        closedir(dir);
+
+        qsort(&result[first], *count - first, sizeof(char*), Aguilar_CompareStrings);
+    }
+
+    return result;
+}
+
+function char* Aguilar_FormatObjectPath(arena_t *arena, const char* source)
+{
+    const char* base = strrchr(source, '/') ? strrchr(source, '/') + 1 : source;
+    return Aguilar_Format(arena, "%s/%s.%08x.o", OBJ_DIR, base, (u32)Aguilar_HashString(HASH_SEED, source));
+}
+
+function char* Aguilar_FormatTargetOutput(arena_t *arena, build_target_t *target)
+{
+    switch (target->kind) {
+        case TARGET_STATIC: return Aguilar_Format(arena, "lib%s.a", target->name);
+        case TARGET_SHARED: return Aguilar_Format(arena, "lib%s.so", target->name);
+        default: return target->name;
+    }
+}
+
+// NOTE(Alex): Depth first, appending a target after all of its dependencies.
+function int Aguilar_VisitTarget(project_config_t *config, int index, u8* marks, int* order, int* order_count)
+{
+    if (marks[index] == 2) {
+        return 0;
+    }
+
+    if (marks[index] == 1) {
+        printf("At target %s, ", config->targets[index].name);
+        Aguilar_SetError("Dependency cycle between targets!");
+        return -1;
+    }
+
+    marks[index] = 1;
+
+    build_target_t *target = &config->targets[index];
+    for (int i = 0; i < target->dep_count; i++) {
+        build_target_t *dep = Aguilar_FindTarget(config, target->deps[i]);
+        if (dep == NULL) {
+            printf("At target %s, ", target->name);
+            Aguilar_SetError("Dependency on an unknown target!");
+            return -1;
+        }
+
+        if (Aguilar_VisitTarget(config, (int)(dep - config->targets), marks, order, order_count) != 0) {
+            return -1;
+        }
+    }
+
+    marks[index] = 2;
+    order[(*order_count)++] = index;
+
+    return 0;
+}
+
+function i64 Aguilar_FileModTime(const char* path)
+{
+    struct stat sb;
+    return Aguilar_FileExists(path, &sb) ? Aguilar_ModTime(&sb) : -1;
+}
+
+function bool Aguilar_StampMatches(const char* path, u64 stamp)
+{
+    bool match = false;
+
+    FILE* file = fopen(path, "r");
+    if (file != NULL) {
+        u64 old_stamp = 0;
+        match = (fscanf(file, "%lx", &old_stamp) == 1 and old_stamp == stamp);
+        fclose(file);
+    }
+
+    return match;
+}
+
+function void Aguilar_WriteStamp(const char* path, u64 stamp)
+{
+    FILE* file = fopen(path, "w");
+    if (file != NULL) {
+        fprintf(file, "%016lx\n", stamp);
+        fclose(file);
+    }
+}
+
+// NOTE(Alex): Gives an object node its compile command, unless the object is up to date.
+function void Aguilar_PrepareObjectNode(arena_t *arena, build_graph_t *graph, int node, const char* source, const char* args, bool stamp_valid)
+{
+    char* object = graph->nodes[node].output;
+    char* depfile = Aguilar_Format(arena, "%s.d", object);
+    i64 object_time = Aguilar_FileModTime(object);
+
+    if (!stamp_valid or object_time < 0 or !Aguilar_DepsUpToDate(arena, depfile, object_time)) {
+        graph->nodes[node].command = Aguilar_Format(arena, "%s %s -MMD -MF %s -c -o %s %s",
+                Aguilar_GetCompilerEnv(), args, depfile, object, source);
+        graph->nodes[node].source = Aguilar_Format(arena, "%s", source);
+        graph->nodes[node].args = Aguilar_Format(arena, "%s", args);
+        graph->nodes[node].depfile = depfile;
+    }
+}
+
+function int Aguilar_BuildTargets(arena_t *arena, project_config_t *config, char* args, char* link_args)
+{
+    int count = config->target_count;
+
+    int* order = AWN_ArenaPush(arena, sizeof(int) * count);
+    u8* marks = AWN_ArenaPush(arena, sizeof(u8) * count);
+    int order_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (Aguilar_VisitTarget(config, i, marks, order, &order_count) != 0) {
+            return -1;
+        }
+    }
+
+    bool any_shared = false;
+    for (int i = 0; i < count; i++) {
+        config->targets[i].output = Aguilar_FormatTargetOutput(arena, &config->targets[i]);
+        any_shared = any_shared or config->targets[i].kind == TARGET_SHARED;
+    }
+
+    // NOTE(Alex): Objects are shared between targets, so if any of them ends up in a
+    //              shared library they all have to be position independent.
+    char* compile_args = Aguilar_Format(arena, "%s%s", args, any_shared ? " -fPIC" : "");
+    pch_headers_t *pch_headers = NULL;
+    pch_headers_t *scratch_headers = AWN_ArenaPush(arena, sizeof(pch_headers_t));
+    const char* pch_flags = Aguilar_PreparePch(arena, config, compile_args, &pch_headers);
+
+    if (Aguilar_MakeDirs(OBJ_DIR) != 0) {
+        return -1;
+    }
+
+    // NOTE(Alex): Changing flags, libraries or the compiler invalidates everything.
+    u64 stamp = Aguilar_HashCompiler(arena, HASH_SEED, Aguilar_GetCompilerEnv());
+    stamp = Aguilar_HashString(stamp, compile_args);
+    stamp = Aguilar_HashString(stamp, pch_flags);
+    stamp = Aguilar_HashString(stamp, link_args);
+
+    bool stamp_valid = Aguilar_StampMatches(BUILD_STAMP, stamp);
+
+    build_graph_t graph = { 0 };
+
+    int** target_objects = AWN_ArenaPush(arena, sizeof(int*) * count);
+    int* target_object_counts = AWN_ArenaPush(arena, sizeof(int) * count);
+    int* target_nodes = AWN_ArenaPush(arena, sizeof(int) * count);
+    char** object_sources = 0;
+
+    for (int t = 0; t < count; t++) {
+        build_target_t *target = &config->targets[t];
+
+        int source_count = 0;
+        char** sources = Aguilar_ExpandSources(arena, target, &source_count);
+
+        if (source_count == 0) {
+            printf("At target %s, ", target->name);
+            Aguilar_SetError("Target has no sources!");
+            return -1;
+        }
+
+        target_objects[t] = AWN_ArenaPush(arena, sizeof(int) * source_count);
+        target_object_counts[t] = source_count;
+
+        for (int i = 0; i < source_count; i++) {
+            int node = -1;
+            for (int n = 0; n < graph.node_count; n++) {
+                if (!graph.nodes[n].is_link and strcmp(object_sources[n], sources[i]) == 0) {
+                    node = n;
+                    break;
+                }
+            }
+
+            if (node < 0) {
+                char* object = Aguilar_FormatObjectPath(arena, sources[i]);
+                node = Aguilar_GraphAddNode(arena, &graph, object, false);
+
+                object_sources = Aguilar_ArrayReserve(arena, object_sources, node, sizeof(char*));
+                object_sources[node] = sources[i];
+
+                bool use_pch = pch_flags[0] != '\0' and Aguilar_SourceStartsWithHeaders(sources[i], pch_headers, scratch_headers);
+                Aguilar_PrepareObjectNode(arena, &graph, node, sources[i], Aguilar_Format(arena, "%s%s", compile_args, use_pch ? pch_flags : ""), stamp_valid);
+            }
+
+            target_objects[t][i] = node;
+        }
+    }
+
+    for (int o = 0; o < order_count; o++) {
+        int t = order[o];
+        build_target_t *target = &config->targets[t];
+
+        int node = Aguilar_GraphAddNode(arena, &graph, target->output, true);
+        target_nodes[t] = node;
+
+        object_sources = Aguilar_ArrayReserve(arena, object_sources, node, sizeof(char*));
+        object_sources[node] = target->output;
+
+        i64 output_time = Aguilar_FileModTime(target->output);
+        bool dirty = !stamp_valid or output_time < 0;
+
+        char* inputs = NULL;
+        usize inputs_length = 0;
+        FILE* inputs_stream = open_memstream(&inputs, &inputs_length);
+
+        for (int i = 0; i < target_object_counts[t]; i++) {
+            build_node_t *object = &graph.nodes[target_objects[t][i]];
+            dirty = dirty or object->command != 0 or Aguilar_FileModTime(object->output) > output_time;
+            fprintf(inputs_stream, " %s", object->output);
+        }
+
+        fclose(inputs_stream);
+
+        // NOTE(Alex): Libraries link in dependency order, a library before the ones it uses.
+        char* libraries = "";
+        bool needs_rpath = false;
+
+        if (target->kind != TARGET_STATIC) {
+            u8* dep_marks = AWN_ArenaPush(arena, sizeof(u8) * count);
+            int* dep_order = AWN_ArenaPush(arena, sizeof(int) * count);
+            int dep_count = 0;
+
+            Aguilar_VisitTarget(config, t, dep_marks, dep_order, &dep_count);
+
+            for (int i = dep_count - 2; i >= 0; i--) {
+                build_target_t *dep = &config->targets[dep_order[i]];
+                if (dep->kind == TARGET_EXE) {
+                    continue;
+                }
+
+                libraries = Aguilar_Format(arena, "%s %s", libraries, dep->output);
+                needs_rpath = needs_rpath or dep->kind == TARGET_SHARED;
+            }
+        }
+
+        for (int i = 0; i < target->dep_count; i++) {
+            build_target_t *dep = Aguilar_FindTarget(config, target->deps[i]);
+            build_node_t *dep_node = &graph.nodes[target_nodes[dep - config->targets]];
+            dirty = dirty or dep_node->command != 0 or Aguilar_FileModTime(dep->output) > output_time;
+        }
+
+        if (dirty) {
+            const char* compiler = Aguilar_GetCompilerEnv();
+            const char* rpath = needs_rpath ? " -Wl,-rpath,'$ORIGIN'" : "";
+
+            switch (target->kind) {
+                case TARGET_STATIC: {
+                    graph.nodes[node].command = Aguilar_Format(arena, "rm -f %s && ar rcs %s%s", target->output, target->output, inputs);
+                } break;
+
+                case TARGET_SHARED: {
+                    graph.nodes[node].command = Aguilar_Format(arena, "%s %s -shared -Wl,-soname,%s -o %s%s%s%s%s",
+                            compiler, compile_args, target->output, target->output, inputs, libraries, rpath, link_args);
+                } break;
+
+                case TARGET_EXE: {
+                    graph.nodes[node].command = Aguilar_Format(arena, "%s %s -o %s%s%s%s%s",
+                            compiler, compile_args, target->output, inputs, libraries, rpath, link_args);
+                } break;
+            }
+        }
+
+        free(inputs);
+
+        for (int i = 0; i < target_object_counts[t]; i++) {
+            Aguilar_GraphAddEdge(arena, &graph, target_objects[t][i], node);
+        }
+
+        for (int i = 0; i < target->dep_count; i++) {
+            build_target_t *dep = Aguilar_FindTarget(config, target->deps[i]);
+            Aguilar_GraphAddEdge(arena, &graph, target_nodes[dep - config->targets], node);
+        }
+    }
+
+    int work = 0;
+    for (int i = 0; i < graph.node_count; i++) {
+        work += graph.nodes[i].command != 0;
+    }
+
+    if (work == 0) {
+        printf("Nothing to do, every target is up to date.\n");
+        return 0;
+    }
+
+    f64 compile_ms = 0;
+    f64 link_ms = 0;
+    f64 start = Aguilar_TimeMs();
+
+    if (Aguilar_RunGraph(arena, &graph, Aguilar_GetJobCount(), &compile_ms, &link_ms) != 0) {
+        return -1;
+    }
+
+    Aguilar_WriteStamp(BUILD_STAMP, stamp);
+
+    printf("Ran %d of %d steps in %.1f ms (compile: %.1f ms, link: %.1f ms)\n",
+            work, graph.node_count, Aguilar_TimeMs() - start, compile_ms, link_ms);
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Tests.
+//              Any function written as "void test_name(void)" at the start of a line in
+//              src/ or tests/ is a test. Every .c file in those directories becomes one object
+//              (with its main renamed, see Aguilar_TestMainName) in a single test binary, so
+//              tests can call anything the project defines. Objects are built incrementally
+//              under .aguilar_build/test by the same graph as target builds, workers included.
+//              The generated runner forks one process per test, so a crashing test only fails
+//              itself.
+
+#define TEST_DIR BUILD_DIR "/test"
+#define TEST_BINARY TEST_DIR "/aguilar_tests"
+#define TEST_RUNNER TEST_DIR "/aguilar_test_runner.c"
+
+global const char* test_runner_header =
+    "// NOTE: Generated by Aguilar, do not edit.\n"
+    "#define _GNU_SOURCE\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <signal.h>\n"
+    "#include <time.h>\n"
+    "#include <unistd.h>\n"
+    "#include <sys/time.h>\n"
+    "#include <sys/wait.h>\n"
+    "\n"
+    "typedef struct { const char* name; const char* file; void (*fn)(void); } aguilar_test_t;\n"
+    "\n";
+
+global const char* test_runner_main =
+    "static double aguilar_now_ms(void)\n"
+    "{\n"
+    "    struct timespec ts;\n"
+    "    clock_gettime(CLOCK_MONOTONIC, &ts);\n"
+    "    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;\n"
+    "}\n"
+    "\n"
+    "typedef struct { int index; pid_t pid; double start; double ms; int status; } aguilar_result_t;\n"
+    "\n"
+    "static int aguilar_compare_results(const void* a, const void* b)\n"
+    "{\n"
+    "    double x = ((const aguilar_result_t*)a)->ms;\n"
+    "    double y = ((const aguilar_result_t*)b)->ms;\n"
+    "    return (x < y) - (x > y);\n"
+    "}\n"
+    "\n"
+    "int main(int argc, char** argv)\n"
+    "{\n"
+    "    int count = (int)(sizeof(aguilar_tests) / sizeof(aguilar_tests[0]));\n"
+    "    long jobs = sysconf(_SC_NPROCESSORS_ONLN);\n"
+    "    int shard = 1, shards = 1, list = 0;\n"
+    "    double slow_ms = 1000.0;\n"
+    "    long timeout_ms = 0;\n"
+    "    const char* filter = NULL;\n"
+    "\n"
+    "    for (int i = 1; i < argc; i++) {\n"
+    "        if (strcmp(argv[i], \"--list\") == 0) list = 1;\n"
+    "        else if (strcmp(argv[i], \"--jobs\") == 0 && i + 1 < argc) jobs = atol(argv[++i]);\n"
+    "        else if (strcmp(argv[i], \"--slow\") == 0 && i + 1 < argc) slow_ms = atof(argv[++i]);\n"
+    "        else if (strcmp(argv[i], \"--timeout\") == 0 && i + 1 < argc) timeout_ms = atol(argv[++i]);\n"
+    "        else if (strcmp(argv[i], \"--shard\") == 0 && i + 1 < argc) {\n"
+    "            if (sscanf(argv[++i], \"%d/%d\", &shard, &shards) != 2 || shards < 1 || shard < 1 || shard > shards) {\n"
+    "                fprintf(stderr, \"Expected --shard I/N with 1 <= I <= N\\n\");\n"
+    "                return 2;\n"
+    "            }\n"
+    "        }\n"
+    "        else filter = argv[i];\n"
+    "    }\n"
+    "\n"
+    "    if (jobs < 1) jobs = 1;\n"
+    "\n"
+    "    aguilar_result_t* results = calloc(count + 1, sizeof(aguilar_result_t));\n"
+    "    int* slots = calloc(jobs, sizeof(int));\n"
+    "    int selected = 0;\n"
+    "\n"
+    "    for (int i = 0; i < count; i++) {\n"
+    "        if (i % shards != shard - 1) continue;\n"
+    "        if (filter != NULL && strstr(aguilar_tests[i].name, filter) == NULL) continue;\n"
+    "        results[selected++].index = i;\n"
+    "    }\n"
+    "\n"
+    "    if (list) {\n"
+    "        for (int i = 0; i < selected; i++) {\n"
+    "            printf(\"%s (%s)\\n\", aguilar_tests[results[i].index].name, aguilar_tests[results[i].index].file);\n"
+    "        }\n"
+    "        return 0;\n"
+    "    }\n"
+    "\n"
+    "    int next = 0, running = 0, failed = 0, slow = 0;\n"
+    "    double start = aguilar_now_ms();\n"
+    "\n"
+    "    while (next < selected || running > 0) {\n"
+    "        while (running < jobs && next < selected) {\n"
+    "            aguilar_result_t* result = &results[next];\n"
+    "\n"
+    "            fflush(stdout);\n"
+    "            fflush(stderr);\n"
+    "\n"
+    "            result->start = aguilar_now_ms();\n"
+    "            result->pid = fork();\n"
+    "\n"
+    "            if (result->pid == 0) {\n"
+    "                if (timeout_ms > 0) {\n"
+    "                    struct itimerval timer = { { 0, 0 }, { timeout_ms / 1000, (timeout_ms % 1000) * 1000 } };\n"
+    "                    setitimer(ITIMER_REAL, &timer, NULL);\n"
+    "                }\n"
+    "                aguilar_tests[result->index].fn();\n"
+    "                fflush(stdout);\n"
+    "                _exit(0);\n"
+    "            }\n"
+    "\n"
+    "            for (int s = 0; s < jobs; s++) {\n"
+    "                if (slots[s] == 0) { slots[s] = next + 1; break; }\n"
+    "            }\n"
+    "\n"
+    "            next++;\n"
+    "            running++;\n"
+    "        }\n"
+    "\n"
+    "        int status = 0;\n"
+    "        pid_t pid = wait(&status);\n"
+    "        if (pid < 0) break;\n"
+    "\n"
+    "        for (int s = 0; s < jobs; s++) {\n"
+    "            if (slots[s] == 0 || results[slots[s] - 1].pid != pid) continue;\n"
+    "\n"
+    "            aguilar_result_t* result = &results[slots[s] - 1];\n"
+    "            slots[s] = 0;\n"
+    "            running--;\n"
+    "\n"
+    "            result->ms = aguilar_now_ms() - result->start;\n"
+    "            result->status = status;\n"
+    "\n"
+    "            const char* name = aguilar_tests[result->index].name;\n"
+    "\n"
+    "            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {\n"
+    "                printf(\"PASS %9.2f ms  %s%s\\n\", result->ms, name, result->ms >= slow_ms ? \"  [slow]\" : \"\");\n"
+    "            } else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM && timeout_ms > 0) {\n"
+    "                printf(\"FAIL %9.2f ms  %s  (timed out)\\n\", result->ms, name);\n"
+    "                failed++;\n"
+    "            } else if (WIFSIGNALED(status)) {\n"
+    "                printf(\"FAIL %9.2f ms  %s  (%s)\\n\", result->ms, name, strsignal(WTERMSIG(status)));\n"
+    "                failed++;\n"
+    "            } else {\n"
+    "                printf(\"FAIL %9.2f ms  %s  (exit code %d)\\n\", result->ms, name, WEXITSTATUS(status));\n"
+    "                failed++;\n"
+    "            }\n"
+    "\n"
+    "            slow += result->ms >= slow_ms;\n"
+    "            break;\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    double total_ms = aguilar_now_ms() - start;\n"
+    "    double serial_ms = 0;\n"
+    "    for (int i = 0; i < selected; i++) serial_ms += results[i].ms;\n"
+    "\n"
+    "    qsort(results, selected, sizeof(aguilar_result_t), aguilar_compare_results);\n"
+    "\n"
+    "    printf(\"\\nSlowest tests:\\n\");\n"
+    "    for (int i = 0; i < selected && i < 10; i++) {\n"
+    "        printf(\"  %9.2f ms  %s\\n\", results[i].ms, aguilar_tests[results[i].index].name);\n"
+    "    }\n"
+    "\n"
+    "    printf(\"\\n%d passed, %d failed, %d slow (>= %.0f ms), shard %d/%d, %.1f ms wall, %.1f ms total.\\n\",\n"
+    "            selected - failed, failed, slow, slow_ms, shard, shards, total_ms, serial_ms);\n"
+    "\n"
+    "    return failed ? 1 : 0;\n"
+    "}\n";
+
+STRUCT(test_file_t)
+{
+    char* path;
+    char** tests;
+    int test_count;
+};
+
+function void Aguilar_FindTestsInFile(arena_t *arena, char* path, test_file_t** files, int* file_count)
+{
+    line_reader_t reader;
+    if (!AWN_LineReaderOpen(&reader, path, KB(16))) {
+        AWN_LineReaderClose(&reader);
+        return;
+    }
+
+    test_file_t *entry = NULL;
+    str_t line;
+
+    while (AWN_LineReaderNext(&reader, &line)) {
+        if (!AWN_StrStartsWith(line, AWN_StrLit("void test_"))) {
+            continue;
+        }
+
+        usize length = 5;
+        while (length < line.size and (line.data[length] == '_' or isalnum((unsigned char)line.data[length]))) {
+            length++;
+        }
+
+        // NOTE(Alex): Only definitions and declarations, not e.g. "void test_ptr = ...".
+        if (length == line.size or line.data[length] != '(') {
+            continue;
+        }
+
+        if (entry == NULL) {
+            *files = Aguilar_ArrayReserve(arena, *files, *file_count, sizeof(test_file_t));
+            entry = &(*files)[(*file_count)++];
+            memset(entry, 0, sizeof(test_file_t));
+            entry->path = path;
+        }
+
+        char* name = Aguilar_Format(arena, "%.*s", (int)length - 5, line.data + 5);
+
+        bool duplicate = false;
+        for (int i = 0; i < entry->test_count; i++) {
+            duplicate = duplicate or strcmp(entry->tests[i], name) == 0;
+        }
+
+        if (!duplicate) {
+            entry->tests = Aguilar_ArrayReserve(arena, entry->tests, entry->test_count, sizeof(char*));
+            entry->tests[entry->test_count++] = name;
+        }
+    }
+
+    AWN_LineReaderClose(&reader);
+}
+
+// NOTE(Alex): Files without tests are kept as well, they are linked in for the tests to use.
+function void Aguilar_FindTests(arena_t *arena, const char* dir_path, test_file_t** files, int* file_count)
+{
+    build_target_t dir_target = { 0 };
+    char* sources[] = { (char*)dir_path };
+    dir_target.sources = sources;
+    dir_target.source_count = 1;
+
+    if (!Aguilar_FileExists(dir_path, 0)) {
+        return;
+    }
+
+    int count = 0;
+    char** paths = Aguilar_ExpandSources(arena, &dir_target, &count);
+
+    for (int i = 0; i < count; i++) {
+        int before = *file_count;
+        Aguilar_FindTestsInFile(arena, paths[i], files, file_count);
+
+        if (*file_count == before) {
+            *files = Aguilar_ArrayReserve(arena, *files, *file_count, sizeof(test_file_t));
+            (*files)[(*file_count)++] = (test_file_t){ paths[i], NULL, 0 };
+        }
+    }
+}
+
+// NOTE(Alex): Every file may have its own main, the one in src/foo.c is renamed to
+//              main_src_foo, so a test can still run the program's main.
+function char* Aguilar_TestMainName(arena_t *arena, const char* path)
+{
+    char* name = Aguilar_Format(arena, "main_%s", path);
+
+    usize length = strlen(name);
+    if (length > 2 and strcmp(name + length - 2, ".c") == 0) {
+        name[length - 2] = '\0';
+    }
+
+    for (char* c = name; *c != '\0'; c++) {
+        if (!isalnum((unsigned char)*c)) {
+            *c = '_';
+        }
+    }
+
+    return name;
+}
+
+// NOTE(Alex): Only rewritten when it changes, so an unchanged test list does not relink.
+function int Aguilar_WriteTestRunner(arena_t *arena, test_file_t* files, int file_count)
+{
+    char* contents = NULL;
+    usize length = 0;
+    FILE* stream = open_memstream(&contents, &length);
+
+    fputs(test_runner_header, stream);
+
+    for (int f = 0; f < file_count; f++) {
+        for (int t = 0; t < files[f].test_count; t++) {
+            fprintf(stream, "void %s(void);\n", files[f].tests[t]);
+        }
+    }
+
+    fprintf(stream, "\nstatic aguilar_test_t aguilar_tests[] = {\n");
+    for (int f = 0; f < file_count; f++) {
+        for (int t = 0; t < files[f].test_count; t++) {
+            fprintf(stream, "    { \"%s\", \"%s\", %s },\n", files[f].tests[t], files[f].path, files[f].tests[t]);
+        }
+    }
+    fprintf(stream, "};\n%s", test_runner_main);
+    fclose(stream);
+
+    int result = 0;
+    bool changed = true;
+
+    FILE* existing = fopen(TEST_RUNNER, "r");
+    if (existing != NULL) {
+        char* old = AWN_ArenaPush(arena, length + 2);
+        usize read_length = fread(old, 1, length + 1, existing);
+        fclose(existing);
+
+        changed = (read_length != length or memcmp(old, contents, length) != 0);
+    }
+
+    if (changed) {
+        FILE* file = fopen(TEST_RUNNER, "w");
+        if (file != NULL) {
+            fwrite(contents, 1, length, file);
+            fclose(file);
+        } else {
+            Aguilar_SetError("Failed to write the test runner!");
+            result = -1;
+        }
+    }
+
+    free(contents);
+
+    return result;
+}
+
+function int Aguilar_Test(arena_t *arena, int argc, char** argv)
+{
+    test_file_t* files = 0;
+    int file_count = 0;
+
+    Aguilar_FindTests(arena, "src", &files, &file_count);
+    Aguilar_FindTests(arena, "tests", &files, &file_count);
+
+    int test_count = 0;
+    for (int f = 0; f < file_count; f++) {
+        test_count += files[f].test_count;
+    }
+
+    if (test_count == 0) {
+        Aguilar_SetError("No tests found, write functions named void test_name(void) in src/ or tests/!");
+        return -1;
+    }
+
+    project_config_t config;
+    if (Aguilar_ReadProjectConfig(arena, &config) < 0) {
+        return -1;
+    }
+
+    char* args = Aguilar_Format(arena, "%s%s", config.flags, Aguilar_GetDebugFlags(config.debug));
+    char* link_args = Aguilar_Format(arena, "%s%s", Aguilar_GetLinkerFlags(arena, config.linker), config.libs);
+
+    if (Aguilar_MakeDirs(TEST_DIR) != 0 or Aguilar_WriteTestRunner(arena, files, file_count) != 0) {
+        return -1;
+    }
+
+    u64 stamp = Aguilar_HashCompiler(arena, HASH_SEED, Aguilar_GetCompilerEnv());
+    stamp = Aguilar_HashString(stamp, args);
+    stamp = Aguilar_HashString(stamp, link_args);
+    bool stamp_valid = Aguilar_StampMatches(TEST_DIR "/stamp", stamp);
+
+    build_graph_t graph = { 0 };
+
+    char* inputs = NULL;
+    usize inputs_length = 0;
+    FILE* inputs_stream = open_memstream(&inputs, &inputs_length);
+
+    for (int f = 0; f <= file_count; f++) {
+        const char* source = f < file_count ? files[f].path : TEST_RUNNER;
+        const char* base = strrchr(source, '/') + 1;
+        char* object = Aguilar_Format(arena, "%s/%s.%08x.o", TEST_DIR, base, (u32)Aguilar_HashString(HASH_SEED, source));
+
+        char* object_args = f < file_count
+            ? Aguilar_Format(arena, "%s -Dmain=%s", args, Aguilar_TestMainName(arena, source))
+            : args;
+
+        int node = Aguilar_GraphAddNode(arena, &graph, object, false);
+        Aguilar_PrepareObjectNode(arena, &graph, node, source, object_args, stamp_valid);
+
+        fprintf(inputs_stream, " %s", object);
+    }
+
+    fclose(inputs_stream);
+
+    int link = Aguilar_GraphAddNode(arena, &graph, TEST_BINARY, true);
+    i64 binary_time = Aguilar_FileModTime(TEST_BINARY);
+    bool dirty = !stamp_valid or binary_time < 0;
+
+    for (int i = 0; i < link; i++) {
+        dirty = dirty or graph.nodes[i].command != 0 or Aguilar_FileModTime(graph.nodes[i].output) > binary_time;
+    }
+
+    if (dirty) {
+        graph.nodes[link].command = Aguilar_Format(arena, "%s %s -o %s%s%s", Aguilar_GetCompilerEnv(), args, TEST_BINARY, inputs, link_args);
+    }
+
+    free(inputs);
+
+    for (int i = 0; i < link; i++) {
+        Aguilar_GraphAddEdge(arena, &graph, i, link);
+    }
+
+    f64 compile_ms = 0;
+    f64 link_ms = 0;
+    if (Aguilar_RunGraph(arena, &graph, Aguilar_GetJobCount(), &compile_ms, &link_ms) != 0) {
+        return -1;
+    }
+
+    Aguilar_WriteStamp(TEST_DIR "/stamp", stamp);
+
+    // NOTE(Alex): The runner takes over from here, its exit code is the result of the run.
+    char** runner_argv = AWN_ArenaPush(arena, sizeof(char*) * (argc + 2));
+    runner_argv[0] = TEST_BINARY;
+    for (int i = 0; i < argc; i++) {
+        runner_argv[i + 1] = argv[i];
+    }
+
+    fflush(stdout);
+    execv(TEST_BINARY, runner_argv);
+
+    Aguilar_SetError("Failed to start the test runner!");
+    return -1;
+}
+
+function u64 Aguilar_RunCacheKey(arena_t *arena, const char* abs_file, const char* arg)
+{
+    u64 key = Aguilar_HashString(HASH_SEED, abs_file);
+    key = Aguilar_HashString(key, arg != 0 ? arg : "");
+    return Aguilar_HashCompiler(arena, key, Aguilar_GetCompilerEnv());
+}
+
+// NOTE(Alex): Every script (and argument set) gets its own cache entry, named by a hash
+//              of its absolute path, the compiler arguments and the compiler itself, so scripts
+//              running at the same time never share an output file and switching compilers
+//              never runs a binary the other one built.
+function char* Aguilar_FormatRunCachePath(arena_t *arena, u64 key, const char* extension)
+{
+    const char* home = getenv("HOME");
+    if (home == NULL) {
+        Aguilar_SetError("Failed to get home directory!");
+        return NULL;
+    }
+
+    char* path = AWN_ArenaPush(arena, sizeof(char) * (strlen(home) + strlen(CACHE_RUN_PATH) + strlen(extension) + 32));
+    sprintf(path, "%s%s/%016lx%s", home, CACHE_RUN_PATH, key, extension);
+
+    return path;
+}
+
+// NOTE(Alex): The settings are written to a temporary and renamed into place, so a reader
+//              either sees the old settings or the new ones, never half of each.
+function int Aguilar_WriteCacheSettings(const char* settings_path, const char* file, i64 mod_time)
+{
+    char tmp[PATH_MAX];
+    if (!Aguilar_FormatTempPath(tmp, sizeof(tmp), settings_path)) {
+        Aguilar_SetError("Path is too long!");
+        return -1;
+    }
+
+    FILE* settings_file = fopen(tmp, "w");
+    if (settings_file == NULL) {
+        Aguilar_SetError("Failed to write cache settings file!");
+        return -1;
+    }
+
+    fprintf(settings_file, "%s\n%ld\n", file, mod_time);
+
+    if (fclose(settings_file) != 0 or rename(tmp, settings_path) != 0) {
+        unlink(tmp);
+        Aguilar_SetError("Failed to write cache settings file!");
+        return -1;
+    }
+
+    return 0;
+}
+
+// NOTE(Alex): Returns true when the settings describe the given file at the given time.
+function bool Aguilar_CacheSettingsMatch(const char* settings_path, const char* file, i64 mod_time)
+{
+    FILE* settings_file = fopen(settings_path, "r");
+    if (settings_file == NULL) {
+        return false;
+    }
+
+    char line[PATH_MAX + 2];
+    bool match = false;
+
+    if (fgets(line, sizeof(line), settings_file) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+
+        if (strcmp(line, file) == 0 and fgets(line, sizeof(line), settings_file) != NULL) {
+            match = (strtoll(line, 0, 10) == mod_time);
+        }
+    }
+
+    fclose(settings_file);
+
+    return match;
+}
+
+// NOTE(Alex): Makes sure the run cache entry for the key holds a program built from the sources,
+//              compiling it under the entry's lock when it is stale. Returns the program's path,
+//              warm is set when the entry was already up to date.
+function char* Aguilar_RunCacheCompile(arena_t *arena, const char* abs_file, i64 mod_time, char* sources, char* user_args, u64 key, bool* warm)
+{
+    *warm = false;
+
+    char* out_path = Aguilar_FormatRunCachePath(arena, key, ".out");
+    char* settings_path = Aguilar_FormatRunCachePath(arena, key, ".cache");
+    if (out_path == NULL or settings_path == NULL) {
+        return NULL;
+    }
+
+    // NOTE(Alex): Warm path, no locking needed since entries are only ever renamed into place.
+    if (Aguilar_CacheSettingsMatch(settings_path, abs_file, mod_time) and Aguilar_FileExists(out_path, 0)) {
+        *warm = true;
+        return out_path;
+    }
+
+    char* lock_path = Aguilar_FormatRunCachePath(arena, key, ".lock");
+    *strrchr(lock_path, '/') = '\0';
+    if (Aguilar_MakeDirs(lock_path) != 0) {
+        return NULL;
+    }
+    lock_path[strlen(lock_path)] = '/';
+
+    // NOTE(Alex): Only one process compiles a given entry, everyone else waits here
+    //              and then finds the fresh binary when they re-check the settings.
+    int lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (lock_fd < 0 or flock(lock_fd, LOCK_EX) != 0) {
+        Aguilar_SetError("Failed to lock the run cache!");
+        return NULL;
+    }
+
+    if (Aguilar_CacheSettingsMatch(settings_path, abs_file, mod_time) and Aguilar_FileExists(out_path, 0)) {
+        close(lock_fd);
+        return out_path;
+    }
+
+    char tmp_path[PATH_MAX];
+    Aguilar_FormatTempPath(tmp_path, sizeof(tmp_path), out_path);
+
+    // NOTE(Alex): Scripts have no .aguilar, but still get the fastest linker around.
+    const char* linker_flags = Aguilar_GetLinkerFlags(arena, 0);
+    char* args = AWN_ArenaPush(arena, sizeof(char) * (strlen(user_args) + strlen(linker_flags) + 1));
+    sprintf(args, "%s%s", user_args, linker_flags);
+
+    int ret = Aguilar_CachedBuildInstruction(arena, sources, args, 0, tmp_path);
+
+    if (ret != 0) {
+        unlink(tmp_path);
+        close(lock_fd);
+        Aguilar_SetError("Compiler encountered an error!");
+        return NULL;
+    }
+
+    if (rename(tmp_path, out_path) != 0) {
+        unlink(tmp_path);
+        close(lock_fd);
+        Aguilar_SetError("Failed to move the program into the cache!");
+        return NULL;
+    }
+
+    if (Aguilar_WriteCacheSettings(settings_path, abs_file, mod_time) != 0) {
+        close(lock_fd);
+        return NULL;
+    }
+
+    close(lock_fd);
+
+    return out_path;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Code generators (`gen:` lines in .aguilar).
+//              A generator is a C program that is compiled through the run cache and run before
+//              the build, with its inputs as arguments and the project root as working directory.
+//              Whatever it prints becomes a file in .aguilar_build/gen. Generated headers are
+//              found through -I, generated .c files join the build. A generator only reruns when
+//              its source or one of its inputs changed. Headers the generator itself includes
+//              are not part of that, touch the source to force a rerun.
+#define GEN_DIR BUILD_DIR "/gen"
+
+function char* Aguilar_GeneratedPath(arena_t *arena, generator_t *generator)
+{
+    return Aguilar_Format(arena, GEN_DIR "/%s", generator->output);
+}
+
+function bool Aguilar_IsGeneratedSource(generator_t *generator)
+{
+    usize length = strlen(generator->output);
+    return length > 2 and strcmp(generator->output + length - 2, ".c") == 0;
+}
+
+function int Aguilar_RunGenerator(arena_t *arena, generator_t *generator)
+{
+    struct stat sb;
+    char abs_source[PATH_MAX];
+
+    if (!Aguilar_FileExists(generator->source, &sb) or realpath(generator->source, abs_source) == NULL) {
+        Aguilar_SetError("Generator source does not exist!");
+        return -1;
+    }
+
+    // NOTE(Alex): The stamp covers the generator's source and every input, by name and content.
+    u64 stamp = Aguilar_HashString(HASH_SEED, generator->output);
+    u64 hash = 0;
+
+    if (Aguilar_HashFile(generator->source, &hash) != 0) {
+        return -1;
+    }
+    stamp = Aguilar_HashBytes(stamp, &hash, sizeof(hash));
+
+    for (int i = 0; i < generator->input_count; i++) {
+        if (Aguilar_HashFile(generator->inputs[i], &hash) != 0) {
+            Aguilar_SetError("Generator input does not exist!");
+            return -1;
+        }
+
+        stamp = Aguilar_HashString(stamp, generator->inputs[i]);
+        stamp = Aguilar_HashBytes(stamp, &hash, sizeof(hash));
+    }
+
+    char* output_path = Aguilar_GeneratedPath(arena, generator);
+    char* stamp_path = Aguilar_Format(arena, "%s.stamp", output_path);
+
+    if (Aguilar_StampMatches(stamp_path, stamp) and Aguilar_FileExists(output_path, 0)) {
+        return 0;
+    }
+
+    // NOTE(Alex): Same cache entry as `aguilar run` on the generator, so trying it out by hand
+    //              already compiles it for the build.
+    bool warm = false;
+    u64 key = Aguilar_RunCacheKey(arena, abs_source, 0);
+    char* program = Aguilar_RunCacheCompile(arena, abs_source, Aguilar_ModTime(&sb), generator->source, DEFAULT_FLAGS, key, &warm);
+
+    if (program == NULL) {
+        return -1;
+    }
+
+    char tmp_path[PATH_MAX];
+    if (!Aguilar_FormatTempPath(tmp_path, sizeof(tmp_path), output_path)) {
+        Aguilar_SetError("Path is too long!");
+        return -1;
+    }
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0) {
+        Aguilar_SetError("Failed to create the generated file!");
+        return -1;
+    }
+
+    char** argv = AWN_ArenaPush(arena, sizeof(char*) * (generator->input_count + 2));
+    argv[0] = program;
+    for (int i = 0; i < generator->input_count; i++) {
+        argv[i + 1] = generator->inputs[i];
+    }
+
+    printf("Generating %s\n", generator->output);
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fd, STDOUT_FILENO);
+        execv(program, argv);
+        _exit(127);
+    }
+
+    close(fd);
+
+    int status = 0;
+    while (pid > 0 and waitpid(pid, &status, 0) < 0 and errno == EINTR) {
+    }
+
+    if (pid < 0 or !WIFEXITED(status) or WEXITSTATUS(status) != 0) {
+        unlink(tmp_path);
+        Aguilar_SetError("Generator failed!");
+        return -1;
+    }
+
+    // NOTE(Alex): Identical output leaves the old file alone, so nothing compiled from it
+    //              looks out of date.
+    u64 new_hash = 0;
+    u64 old_hash = 0;
+
+    if (Aguilar_HashFile(tmp_path, &new_hash) == 0 and Aguilar_FileExists(output_path, 0) and
+        Aguilar_HashFile(output_path, &old_hash) == 0 and new_hash == old_hash) {
+        unlink(tmp_path);
+    } else if (rename(tmp_path, output_path) != 0) {
+        unlink(tmp_path);
+        Aguilar_SetError("Failed to move the generated file into place!");
+        return -1;
+    }
+
+    Aguilar_WriteStamp(stamp_path, stamp);
+
+    return 0;
+}
+
+// NOTE(Alex): Runs every generator, then points target sources that name a generated .c file
+//              at the file in .aguilar_build/gen.
+function int Aguilar_RunGenerators(arena_t *arena, project_config_t *config)
+{
+    if (config->generator_count == 0) {
+        return 0;
+    }
+
+    if (Aguilar_MakeDirs(GEN_DIR) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < config->generator_count; i++) {
+        if (Aguilar_RunGenerator(arena, &config->generators[i]) != 0) {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < config->target_count; i++) {
+        build_target_t *target = &config->targets[i];
+
+        for (int j = 0; j < target->source_count; j++) {
+            for (int k = 0; k < config->generator_count; k++) {
+                if (strcmp(target->sources[j], config->generators[k].output) == 0) {
+                    target->sources[j] = Aguilar_GeneratedPath(arena, &config->generators[k]);
+                    break;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Embedded assets (`asset:` lines in .aguilar).
+//              Every asset becomes read-only data in one generated file that is linked into every
+//              executable, and awn.h finds it by name (AWN_AssetGet). Compilers with #embed get the
+//              bytes from the preprocessor, older ones from the assembler's .incbin. The file is only
+//              rewritten when an asset changed, and each asset's symbol carries its content hash, so
+//              the file's text (and so its object) changes with it.
+#define ASSET_SOURCE GEN_DIR "/aguilar_assets.c"
+
+function int Aguilar_WriteAssets(arena_t *arena, project_config_t *config)
+{
+    if (config->asset_count == 0) {
+        return 0;
+    }
+
+    u64* hashes = AWN_ArenaPush(arena, sizeof(u64) * config->asset_count);
+    u64 stamp = HASH_SEED;
+
+    for (int i = 0; i < config->asset_count; i++) {
+        // NOTE(Alex): The name ends up inside a C string literal, and the resolved path inside
+        //              #embed and .incbin ones, all written without escaping.
+        if (strpbrk(config->assets[i], "\"\\") != NULL) {
+            Aguilar_SetError("Asset paths cannot contain quotes or backslashes!");
+            return -1;
+        }
+
+        if (Aguilar_HashFile(config->assets[i], &hashes[i]) != 0) {
+            Aguilar_SetError("Asset does not exist!");
+            return -1;
+        }
+
+        hashes[i] = Aguilar_HashString(hashes[i], config->assets[i]);
+        stamp = Aguilar_HashBytes(stamp, &hashes[i], sizeof(u64));
+    }
+
+    for (int i = 0; i < config->target_count; i++) {
+        build_target_t *target = &config->targets[i];
+
+        if (target->kind == TARGET_EXE) {
+            target->sources = Aguilar_ArrayReserve(arena, target->sources, target->source_count, sizeof(char*));
+            target->sources[target->source_count++] = ASSET_SOURCE;
+        }
+    }
+
+    const char* stamp_path = ASSET_SOURCE ".stamp";
+    if (Aguilar_StampMatches(stamp_path, stamp) and Aguilar_FileExists(ASSET_SOURCE, 0)) {
+        return 0;
+    }
+
+    if (Aguilar_MakeDirs(GEN_DIR) != 0) {
+        return -1;
+    }
+
+    char tmp_path[PATH_MAX];
+    Aguilar_FormatTempPath(tmp_path, sizeof(tmp_path), ASSET_SOURCE);
+
+    FILE* file = fopen(tmp_path, "w");
+    if (file == NULL) {
+        Aguilar_SetError("Failed to write the asset file!");
+        return -1;
+    }
+
+    fprintf(file, "// NOTE: Generated by Aguilar from the asset lines in .aguilar, do not edit.\n");
+    fprintf(file, "#include <stddef.h>\n\n");
+    fprintf(file, "typedef struct { const char* name; const unsigned char* data; size_t size; } aguilar_asset_t;\n\n");
+
+    for (int i = 0; i < config->asset_count; i++) {
+        struct stat sb;
+        char abs_path[PATH_MAX];
+
+        if (realpath(config->assets[i], abs_path) == NULL or stat(abs_path, &sb) != 0) {
+            fclose(file);
+            unlink(tmp_path);
+            Aguilar_SetError("Asset does not exist!");
+            return -1;
+        }
+
+        // NOTE(Alex): The project directory or a symlink can bring them back in.
+        if (strpbrk(abs_path, "\"\\") != NULL) {
+            fclose(file);
+            unlink(tmp_path);
+            Aguilar_SetError("Asset paths cannot contain quotes or backslashes!");
+            return -1;
+        }
+
+        // NOTE(Alex): Either way there is a NUL after the data, so text assets are C strings.
+        fprintf(file, "#if defined(__has_embed)\n");
+        fprintf(file, "static const unsigned char aguilar_asset_%016lx[] = {\n", hashes[i]);
+        fprintf(file, "#embed \"%s\" suffix(,)\n", abs_path);
+        fprintf(file, "    0\n};\n");
+        fprintf(file, "#else\n");
+        fprintf(file, "__asm__(\".pushsection .rodata\\n\"\n");
+        fprintf(file, "        \".balign 16\\n\"\n");
+        fprintf(file, "        \"aguilar_asset_%016lx:\\n\"\n", hashes[i]);
+        fprintf(file, "        \".incbin \\\"%s\\\"\\n\"\n", abs_path);
+        fprintf(file, "        \".byte 0\\n\"\n");
+        fprintf(file, "        \".popsection\\n\");\n");
+        fprintf(file, "extern const unsigned char aguilar_asset_%016lx[] __attribute__((visibility(\"hidden\")));\n", hashes[i]);
+        fprintf(file, "#endif\n\n");
+
+        config->assets[i] = Aguilar_Format(arena, "    { \"%s\", aguilar_asset_%016lx, %ld },\n", config->assets[i], hashes[i], (long)sb.st_size);
+    }
+
+    fprintf(file, "const aguilar_asset_t awn_assets[] = {\n");
+    for (int i = 0; i < config->asset_count; i++) {
+        fputs(config->assets[i], file);
+    }
+    fprintf(file, "};\n\n");
+    fprintf(file, "const size_t awn_asset_count = %d;\n", config->asset_count);
+
+    if (fclose(file) != 0 or rename(tmp_path, ASSET_SOURCE) != 0) {
+        unlink(tmp_path);
+        Aguilar_SetError("Failed to write the asset file!");
+        return -1;
+    }
+
+    Aguilar_WriteStamp(stamp_path, stamp);
+
+    return 0;
+}
+
+// NOTE(Alex): Generator inputs and assets can be any file, anywhere, and the daemon only
+//              watches sources, so it never remembers projects that have them as clean.
+function bool Aguilar_ProjectHasUnwatchedInputs(void)
+{
+    file_view_t view;
+    if (!AWN_FileMap(&view, ".aguilar")) {
+        return false;
+    }
+
+    bool found = false;
+    str_t rest = view.data;
+    str_t line;
+
+    while (!found and AWN_StrNextLine(&rest, &line)) {
+        str_t key = AWN_StrTrim(AWN_StrChop(&line, ':'));
+        found = AWN_StrEq(key, AWN_StrLit("gen")) or AWN_StrEq(key, AWN_StrLit("asset"));
+    }
+
+    AWN_FileUnmap(&view);
+
+    return found;
+}
+
+function int Aguilar_Build(arena_t *arena)
+{
+    if (Aguilar_FileExists("build.sh", 0)) {
+        system("./build.sh");
+        return 1;
+    }
+
+    if (Aguilar_FileExists("Makefile", 0)) {
+        system("make");
+        return 1;
+    }
+
+    if (!Aguilar_FileExists("src", 0)) {
+        Aguilar_SetError("No src directory found, cannot run!");
+        return -1;
+    }
+
+    project_config_t config;
+    if (Aguilar_ReadProjectConfig(arena, &config) < 0) {
+        return -1;
+    }
+
+    if (Aguilar_RunGenerators(arena, &config) != 0 or Aguilar_WriteAssets(arena, &config) != 0) {
+        return -1;
+    }
+
+    const char* debug_flags = Aguilar_GetDebugFlags(config.debug);
+    char* args = Aguilar_Format(arena, "%s%s%s", config.flags, debug_flags, config.generator_count > 0 ? " -I" GEN_DIR : "");
+
+    const char* linker_flags = Aguilar_GetLinkerFlags(arena, config.linker);
+    char* link_args = Aguilar_Format(arena, "%s%s", linker_flags, config.libs);
+
+    if (config.target_count > 0) {
+        int result = Aguilar_BuildTargets(arena, &config, args, link_args);
+        AWN_ArenaClear(arena);
+        return result < 0 ? -1 : 1;
+    }
+
+    DIR *src_dir = opendir("src");
+
+    if (src_dir == NULL) {
+        Aguilar_SetError("Could not open the source directory!");
+        return -1;
+    }
+
+    struct dirent *entry;
+
+    char* path = AWN_ArenaPush(arena, 1);
+
+    bool entry_found = false;
+
+    while ((entry = readdir(src_dir)) != NULL and !entry_found) {
+        path = AWN_ArenaResize(arena, path, (arena->pos - arena->pos_prev), sizeof(char) * (strlen("src/") + sizeof(entry->d_name)));
+
+        sprintf(path, "src/%s", entry->d_name);
+
+        // NOTE(Alex): Mapped rather than read, only the line starts are looked at.
+        file_view_t view;
+
+        if (AWN_FileMap(&view, path)) {
+            str_t rest = view.data;
+            str_t line;
+
+            while (!entry_found and AWN_StrNextLine(&rest, &line)) {
+                entry_found = AWN_StrStartsWith(line, AWN_StrLit("int main("));
+            }
+
+            AWN_FileUnmap(&view);
+        }
+    }
+
+    char cwd[128];
+    getcwd(cwd, 128);
+
+    int offset = 0;
+    for (int i = 0; i < strlen(cwd); i++) {
+        if (cwd[i] == '/') {
+            offset = i + 1;
+        }
+    }
+
+    char* out = AWN_ArenaPush(arena, sizeof(char) * (strlen(cwd) - offset + 1));
+
+    memcpy(out, (cwd + offset), (strlen(cwd) - offset) );
+    out[strlen(cwd) - offset] = '\0';
+
+    closedir(src_dir);
+
+    // NOTE(Alex): Generated .c files turn this into a multi file build, which is what targets do.
+    build_target_t main_target = { .name = out, .kind = TARGET_EXE };
+
+    for (int i = 0; i < config.generator_count; i++) {
+        if (Aguilar_IsGeneratedSource(&config.generators[i])) {
+            main_target.sources = Aguilar_ArrayReserve(arena, main_target.sources, main_target.source_count, sizeof(char*));
+            main_target.sources[main_target.source_count++] = Aguilar_GeneratedPath(arena, &config.generators[i]);
+        }
+    }
+
+    if (config.asset_count > 0) {
+        main_target.sources = Aguilar_ArrayReserve(arena, main_target.sources, main_target.source_count, sizeof(char*));
+        main_target.sources[main_target.source_count++] = ASSET_SOURCE;
+    }
+
+    if (main_target.source_count > 0) {
+        main_target.sources = Aguilar_ArrayReserve(arena, main_target.sources, main_target.source_count, sizeof(char*));
+        main_target.sources[main_target.source_count++] = path;
+
+        config.targets = &main_target;
+        config.target_count = 1;
+
+        int result = Aguilar_BuildTargets(arena, &config, args, link_args);
+        AWN_ArenaClear(arena);
+        return result < 0 ? -1 : 1;
+    }
+
+    pch_headers_t *pch_headers = NULL;
+    const char* pch_flags = Aguilar_PreparePch(arena, &config, args, &pch_headers);
+    if (pch_flags[0] != '\0' and !Aguilar_SourceStartsWithHeaders(path, pch_headers, AWN_ArenaPush(arena, sizeof(pch_headers_t)))) {
+        pch_flags = "";
+    }
+    char* compile_args = AWN_ArenaPush(arena, sizeof(char) * (strlen(args) + strlen(pch_flags) + 1));
+    sprintf(compile_args, "%s%s", args, pch_flags);
+
+    if (Aguilar_CachedBuildInstruction(arena, path, compile_args, link_args, out) != 0) {
+        Aguilar_SetError("Compiler encountered an error!");
+        return -1;
+    }
+
+    AWN_ArenaClear(arena);
+
+    return 1;
+}
+
+// NOTE(Alex): Replaces Aguilar with the program, there is nothing left to do afterwards.
+function int Aguilar_ExecProgram(const char* path)
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    execl(path, path, (char*)NULL);
+
+    Aguilar_SetError("Failed to execute program!");
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Sampling profiler for `run --profile`.
+//              perf_event_open needs a permissive perf_event_paranoid, which most machines
+//              do not have, so the program instead links a tiny runtime that samples itself
+//              with setitimer/SIGPROF and walks frame pointers. Aguilar symbolizes the raw
+//              addresses from the executable's .symtab afterwards.
+#define ENV_PROFILE_OUT "AGUILAR_PROFILE_OUT"
+#define RUNTIME_PATH "/.cache/aguilar/runtime"
+#define PROFILE_FLAGS " -g -fno-omit-frame-pointer"
+#define PROFILE_TOP_COUNT 15
+
+ENUM(run_mode_t)
+{
+    RUN_NORMAL,
+    RUN_PROFILE,
+    RUN_MEM,
+};
+
+global const char* profile_runtime =
+    "// NOTE: Generated by Aguilar, do not edit.\n"
+    "// Linked into programs started with `aguilar run --profile`.\n"
+    "#define _GNU_SOURCE\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <stdint.h>\n"
+    "#include <string.h>\n"
+    "#include <signal.h>\n"
+    "#include <dlfcn.h>\n"
+    "#include <link.h>\n"
+    "#include <ucontext.h>\n"
+    "#include <sys/time.h>\n"
+    "\n"
+    "#define AGUILAR_PROF_MAX_DEPTH 64\n"
+    "#define AGUILAR_PROF_CAPACITY (1 << 23)\n"
+    "\n"
+    "extern void* __libc_stack_end;\n"
+    "\n"
+    "static uintptr_t aguilar_prof_buffer[AGUILAR_PROF_CAPACITY];\n"
+    "static size_t aguilar_prof_used;\n"
+    "static size_t aguilar_prof_dropped;\n"
+    "static uintptr_t aguilar_prof_stack_top;\n"
+    "static uintptr_t aguilar_prof_base;\n"
+    "static uintptr_t aguilar_prof_exe_lo = UINTPTR_MAX;\n"
+    "static uintptr_t aguilar_prof_exe_hi;\n"
+    "static const char* aguilar_prof_out;\n"
+    "\n"
+    "static int aguilar_prof_find_exe(struct dl_phdr_info* info, size_t size, void* data)\n"
+    "{\n"
+    "    (void)size; (void)data;\n"
+    "    aguilar_prof_base = info->dlpi_addr;\n"
+    "    for (int i = 0; i < info->dlpi_phnum; i++) {\n"
+    "        if (info->dlpi_phdr[i].p_type != PT_LOAD) continue;\n"
+    "        uintptr_t lo = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;\n"
+    "        uintptr_t hi = lo + info->dlpi_phdr[i].p_memsz;\n"
+    "        if (lo < aguilar_prof_exe_lo) aguilar_prof_exe_lo = lo;\n"
+    "        if (hi > aguilar_prof_exe_hi) aguilar_prof_exe_hi = hi;\n"
+    "    }\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "static void aguilar_prof_handler(int sig, siginfo_t* info, void* context)\n"
+    "{\n"
+    "    (void)sig; (void)info;\n"
+    "    ucontext_t* uc = context;\n"
+    "    uintptr_t pc = 0, sp = 0, fp = 0;\n"
+    "#if defined(__x86_64__)\n"
+    "    pc = uc->uc_mcontext.gregs[REG_RIP];\n"
+    "    sp = uc->uc_mcontext.gregs[REG_RSP];\n"
+    "    fp = uc->uc_mcontext.gregs[REG_RBP];\n"
+    "#elif defined(__aarch64__)\n"
+    "    pc = uc->uc_mcontext.pc;\n"
+    "    sp = uc->uc_mcontext.sp;\n"
+    "    fp = uc->uc_mcontext.regs[29];\n"
+    "#else\n"
+    "    (void)uc;\n"
+    "#endif\n"
+    "    // The stack is walked into a local array first, so a sample's slots are only\n"
+    "    // claimed (with an atomic add, SIGPROF can land in several threads at once)\n"
+    "    // once its size is known.\n"
+    "    uintptr_t frames[AGUILAR_PROF_MAX_DEPTH];\n"
+    "    size_t depth = 0;\n"
+    "    frames[depth++] = pc;\n"
+    "\n"
+    "    // A leaf in a library built without frame pointers still has the return\n"
+    "    // address on top of the stack, so the calling line is not lost.\n"
+    "    uintptr_t leaf_caller = 0;\n"
+    "    if ((pc < aguilar_prof_exe_lo || pc >= aguilar_prof_exe_hi) && sp != 0 && sp + sizeof(uintptr_t) <= aguilar_prof_stack_top) {\n"
+    "        uintptr_t ret = *(uintptr_t*)sp;\n"
+    "        if (ret > aguilar_prof_exe_lo && ret < aguilar_prof_exe_hi) {\n"
+    "            leaf_caller = ret - 1;\n"
+    "            frames[depth++] = leaf_caller;\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    // Only follow frame pointers that stay inside the interrupted stack, anything\n"
+    "    // else is a register reused by code built without frame pointers.\n"
+    "    while (depth < AGUILAR_PROF_MAX_DEPTH && fp >= sp && fp + 2 * sizeof(uintptr_t) <= aguilar_prof_stack_top && (fp & (sizeof(uintptr_t) - 1)) == 0) {\n"
+    "        uintptr_t* frame = (uintptr_t*)fp;\n"
+    "        if (frame[1] == 0) break;\n"
+    "        if (frame[1] - 1 != leaf_caller) frames[depth++] = frame[1] - 1;\n"
+    "        leaf_caller = 0;\n"
+    "        if (frame[0] <= fp) break;\n"
+    "        fp = frame[0];\n"
+    "    }\n"
+    "\n"
+    "    size_t start = __atomic_fetch_add(&aguilar_prof_used, depth + 1, __ATOMIC_RELAXED);\n"
+    "    if (start + depth + 1 > AGUILAR_PROF_CAPACITY) {\n"
+    "        __atomic_fetch_add(&aguilar_prof_dropped, 1, __ATOMIC_RELAXED);\n"
+    "        return;\n"
+    "    }\n"
+    "\n"
+    "    for (size_t d = 0; d < depth; d++) aguilar_prof_buffer[start + 1 + d] = frames[d];\n"
+    "    __atomic_store_n(&aguilar_prof_buffer[start], depth, __ATOMIC_RELEASE);\n"
+    "}\n"
+    "\n"
+    "static void aguilar_prof_write(void)\n"
+    "{\n"
+    "    struct itimerval timer = {0};\n"
+    "    setitimer(ITIMER_PROF, &timer, NULL);\n"
+    "    signal(SIGPROF, SIG_IGN);\n"
+    "\n"
+    "    FILE* out = fopen(aguilar_prof_out, \"w\");\n"
+    "    if (out == NULL) return;\n"
+    "\n"
+    "    fprintf(out, \"base %lx\\n\", (unsigned long)aguilar_prof_base);\n"
+    "    fprintf(out, \"dropped %lu\\n\", (unsigned long)__atomic_load_n(&aguilar_prof_dropped, __ATOMIC_RELAXED));\n"
+    "\n"
+    "    // Slots claimed by a sample that did not fit are never filled in, their zero\n"
+    "    // depths are skipped one at a time.\n"
+    "    size_t used = __atomic_load_n(&aguilar_prof_used, __ATOMIC_ACQUIRE);\n"
+    "    if (used > AGUILAR_PROF_CAPACITY) used = AGUILAR_PROF_CAPACITY;\n"
+    "    for (size_t i = 0; i < used; i += aguilar_prof_buffer[i] + 1) {\n"
+    "        size_t depth = __atomic_load_n(&aguilar_prof_buffer[i], __ATOMIC_ACQUIRE);\n"
+    "        if (depth == 0) continue;\n"
+    "        fputc('s', out);\n"
+    "        for (size_t d = 0; d < depth; d++) {\n"
+    "            uintptr_t pc = aguilar_prof_buffer[i + 1 + d];\n"
+    "            Dl_info dl;\n"
+    "            // The executable is symbolized by Aguilar from .symtab so static functions\n"
+    "            // show up too, shared libraries only get their exported names.\n"
+    "            if (pc >= aguilar_prof_exe_lo && pc < aguilar_prof_exe_hi) {\n"
+    "                fprintf(out, \" %lx\", (unsigned long)pc);\n"
+    "            } else if (dladdr((void*)pc, &dl) && dl.dli_sname != NULL) {\n"
+    "                fprintf(out, \" %lx=%s\", (unsigned long)pc, dl.dli_sname);\n"
+    "            } else if (dladdr((void*)pc, &dl) && dl.dli_fname != NULL) {\n"
+    "                const char* slash = strrchr(dl.dli_fname, '/');\n"
+    "                fprintf(out, \" %lx=[%s]\", (unsigned long)pc, slash != NULL ? slash + 1 : dl.dli_fname);\n"
+    "            } else {\n"
+    "                fprintf(out, \" %lx=[unknown]\", (unsigned long)pc);\n"
+    "            }\n"
+    "        }\n"
+    "        fputc('\\n', out);\n"
+    "    }\n"
+    "\n"
+    "    fclose(out);\n"
+    "}\n"
+    "\n"
+    "static void aguilar_prof_interrupt(int sig)\n"
+    "{\n"
+    "    aguilar_prof_write();\n"
+    "    signal(sig, SIG_DFL);\n"
+    "    raise(sig);\n"
+    "}\n"
+    "\n"
+    "__attribute__((constructor)) static void aguilar_prof_start(void)\n"
+    "{\n"
+    "    aguilar_prof_out = getenv(\"AGUILAR_PROFILE_OUT\");\n"
+    "    if (aguilar_prof_out == NULL) return;\n"
+    "    unsetenv(\"AGUILAR_PROFILE_OUT\");\n"
+    "\n"
+    "    aguilar_prof_stack_top = (uintptr_t)__libc_stack_end;\n"
+    "    dl_iterate_phdr(aguilar_prof_find_exe, NULL);\n"
+    "\n"
+    "    int hz = 997;\n"
+    "    const char* hz_env = getenv(\"AGUILAR_PROFILE_HZ\");\n"
+    "    if (hz_env != NULL && atoi(hz_env) > 0) hz = atoi(hz_env);\n"
+    "\n"
+    "    struct sigaction action;\n"
+    "    memset(&action, 0, sizeof(action));\n"
+    "    action.sa_sigaction = aguilar_prof_handler;\n"
+    "    action.sa_flags = SA_SIGINFO | SA_RESTART;\n"
+    "    sigemptyset(&action.sa_mask);\n"
+    "    sigaction(SIGPROF, &action, NULL);\n"
+    "\n"
+    "    atexit(aguilar_prof_write);\n"
+    "\n"
+    "    // Ctrl-C would otherwise skip atexit and lose every sample.\n"
+    "    struct sigaction previous;\n"
+    "    if (sigaction(SIGINT, NULL, &previous) == 0 && previous.sa_handler == SIG_DFL) {\n"
+    "        signal(SIGINT, aguilar_prof_interrupt);\n"
+    "    }\n"
+    "\n"
+    "    struct itimerval timer;\n"
+    "    timer.it_interval.tv_sec = 0;\n"
+    "    timer.it_interval.tv_usec = 1000000 / hz;\n"
+    "    timer.it_value = timer.it_interval;\n"
+    "    setitimer(ITIMER_PROF, &timer, NULL);\n"
+    "}\n";
+
+// NOTE(Alex): Runtimes live next to the run cache and are only rewritten when Aguilar
+//              itself changed them, so their mtime stays stable for the compile cache.
+function char* Aguilar_WriteRuntime(arena_t *arena, const char* name, const char* contents)
+{
+    const char* home = getenv("HOME");
+    if (home == NULL) {
+        Aguilar_SetError("Failed to get home directory!");
+        return NULL;
+    }
+
+    char* dir = Aguilar_Format(arena, "%s%s", home, RUNTIME_PATH);
+    if (Aguilar_MakeDirs(dir) != 0) {
+        return NULL;
+    }
+
+    char* path = Aguilar_Format(arena, "%s/%s", dir, name);
+    usize length = strlen(contents);
+
+    struct stat sb;
+    if (Aguilar_FileExists(path, &sb) and (usize)sb.st_size == length) {
+        FILE* existing = fopen(path, "r");
+        if (existing != NULL) {
+            char* current = AWN_ArenaPush(arena, length + 1);
+            usize read = fread(current, 1, length, existing);
+            fclose(existing);
+
+            if (read == length and memcmp(current, contents, length) == 0) {
+                return path;
+            }
+        }
+    }
+
+    char tmp_path[PATH_MAX];
+    if (!Aguilar_FormatTempPath(tmp_path, sizeof(tmp_path), path)) {
+        Aguilar_SetError("Runtime path is too long!");
+        return NULL;
+    }
+
+    FILE* file = fopen(tmp_path, "w");
+    if (file == NULL) {
+        Aguilar_SetError("Failed to write runtime source!");
+        return NULL;
+    }
+
+    bool ok = fwrite(contents, 1, length, file) == length;
+    ok = (fclose(file) == 0) and ok;
+
+    if (!ok or rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        Aguilar_SetError("Failed to write runtime source!");
+        return NULL;
+    }
+
+    return path;
+}
+
+STRUCT(elf_symbol_t)
+{
+    u64 address;
+    u64 size;
+    char* name;
+};
+
+STRUCT(symbol_table_t)
+{
+    elf_symbol_t* symbols;
+    int count;
+};
+
+function int Aguilar_CompareSymbols(const void* a, const void* b)
+{
+    const elf_symbol_t* sa = a;
+    const elf_symbol_t* sb = b;
+    return (sa->address > sb->address) - (sa->address < sb->address);
+}
+
+function int Aguilar_ReadSymbols(arena_t *arena, const char* path, symbol_table_t *table)
+{
+    table->symbols = NULL;
+    table->count = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        Aguilar_SetError("Failed to open program for symbolization!");
+        return -1;
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 or (usize)sb.st_size < sizeof(Elf64_Ehdr)) {
+        close(fd);
+        Aguilar_SetError("Program is not an ELF file!");
+        return -1;
+    }
+
+    usize size = sb.st_size;
+    u8* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        Aguilar_SetError("Failed to map program for symbolization!");
+        return -1;
+    }
+
+    Elf64_Ehdr* header = (Elf64_Ehdr*)data;
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 or header->e_ident[EI_CLASS] != ELFCLASS64 or
+        header->e_shentsize != sizeof(Elf64_Shdr) or header->e_shoff + (u64)header->e_shnum * sizeof(Elf64_Shdr) > size) {
+        munmap(data, size);
+        Aguilar_SetError("Program is not a 64-bit ELF file!");
+        return -1;
+    }
+
+    Elf64_Shdr* sections = (Elf64_Shdr*)(data + header->e_shoff);
+    Elf64_Shdr* symtab = NULL;
+
+    // NOTE(Alex): .symtab has static functions too, .dynsym is all a stripped binary keeps.
+    for (int i = 0; i < header->e_shnum; i++) {
+        if (sections[i].sh_type == SHT_SYMTAB) {
+            symtab = &sections[i];
+            break;
+        }
+        if (sections[i].sh_type == SHT_DYNSYM) {
+            symtab = &sections[i];
+        }
+    }
+
+    if (symtab == NULL or symtab->sh_link >= header->e_shnum or symtab->sh_offset + symtab->sh_size > size) {
+        munmap(data, size);
+        return 0;
+    }
+
+    Elf64_Shdr* strtab = &sections[symtab->sh_link];
+    if (strtab->sh_offset + strtab->sh_size > size) {
+        munmap(data, size);
+        return 0;
+    }
+
+    Elf64_Sym* symbols = (Elf64_Sym*)(data + symtab->sh_offset);
+    usize symbol_count = symtab->sh_size / sizeof(Elf64_Sym);
+    const char* strings = (const char*)(data + strtab->sh_offset);
+
+    table->symbols = AWN_ArenaPush(arena, sizeof(elf_symbol_t) * (symbol_count + 1));
+
+    for (usize i = 0; i < symbol_count; i++) {
+        Elf64_Sym* symbol = &symbols[i];
+        if (ELF64_ST_TYPE(symbol->st_info) != STT_FUNC or symbol->st_value == 0 or symbol->st_name >= strtab->sh_size) {
+            continue;
+        }
+
+        const char* name = strings + symbol->st_name;
+        char* copy = AWN_ArenaPush(arena, strnlen(name, strtab->sh_size - symbol->st_name) + 1);
+        strcpy(copy, name);
+
+        table->symbols[table->count++] = (elf_symbol_t){ symbol->st_value, symbol->st_size, copy };
+    }
+
+    munmap(data, size);
+
+    qsort(table->symbols, table->count, sizeof(elf_symbol_t), Aguilar_CompareSymbols);
+
+    return 0;
+}
+
+function const char* Aguilar_LookupSymbol(symbol_table_t *table, u64 address)
+{
+    int low = 0;
+    int high = table->count - 1;
+    int found = -1;
+
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if (table->symbols[mid].address <= address) {
+            found = mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    if (found < 0) {
+        return NULL;
+    }
+
+    elf_symbol_t* symbol = &table->symbols[found];
+    if (symbol->size != 0 and address >= symbol->address + symbol->size) {
+        return NULL;
+    }
+
+    return symbol->name;
+}
+
+STRUCT(profile_entry_t)
+{
+    const char* name;
+    u32 self;
+    u32 total;
+};
+
+function int Aguilar_CompareNames(const void* a, const void* b)
+{
+    return strcmp(*(const char**)a, *(const char**)b);
+}
+
+function int Aguilar_CompareProfileEntries(const void* a, const void* b)
+{
+    const profile_entry_t* ea = a;
+    const profile_entry_t* eb = b;
+    if (ea->self != eb->self) {
+        return ea->self < eb->self ? 1 : -1;
+    }
+    if (ea->total != eb->total) {
+        return ea->total < eb->total ? 1 : -1;
+    }
+    return strcmp(ea->name, eb->name);
+}
+
+function int Aguilar_CompareProfileNames(const void* a, const void* b)
+{
+    return strcmp(((const profile_entry_t*)a)->name, ((const profile_entry_t*)b)->name);
+}
+
+// NOTE(Alex): Turns the runtime's raw samples into folded stacks ("main;work;leaf 42"),
+//              which flamegraph.pl and speedscope both read, and prints the hottest functions.
+function int Aguilar_ReportProfile(arena_t *arena, const char* program, const char* samples_path, const char* folded_path)
+{
+    FILE* input = fopen(samples_path, "r");
+    if (input == NULL) {
+        Aguilar_SetError("Program did not write any samples (did it call _exit or crash?)");
+        return -1;
+    }
+
+    symbol_table_t table;
+    if (Aguilar_ReadSymbols(arena, program, &table) != 0) {
+        fclose(input);
+        return -1;
+    }
+
+    u64 base = 0;
+    u64 dropped = 0;
+
+    char** stacks = NULL;
+    const char** leaves = NULL;
+    const char** names = NULL;
+    int stack_count = 0;
+    int name_count = 0;
+
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+
+    while ((length = getline(&line, &line_capacity, input)) > 0) {
+        if (line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+
+        if (strncmp(line, "base ", 5) == 0) {
+            base = strtoull(line + 5, NULL, 16);
+            continue;
+        }
+        if (strncmp(line, "dropped ", 8) == 0) {
+            dropped = strtoull(line + 8, NULL, 10);
+            continue;
+        }
+        if (line[0] != 's') {
+            continue;
+        }
+
+        const char* frames[64];
+        int depth = 0;
+
+        for (char* token = strtok(line + 1, " "); token != NULL and depth < 64; token = strtok(NULL, " ")) {
+            char* name = strchr(token, '=');
+            if (name != NULL) {
+                frames[depth++] = Aguilar_Format(arena, "%s", name + 1);
+                continue;
+            }
+
+            const char* symbol = Aguilar_LookupSymbol(&table, strtoull(token, NULL, 16) - base);
+            frames[depth++] = symbol != NULL ? symbol : "[unknown]";
+        }
+
+        if (depth == 0) {
+            continue;
+        }
+
+        stacks = Aguilar_ArrayReserve(arena, stacks, stack_count, sizeof(char*));
+        leaves = Aguilar_ArrayReserve(arena, leaves, stack_count, sizeof(char*));
+
+        // NOTE(Alex): Frames come innermost first, folded stacks want the root first.
+        char* folded = NULL;
+        size_t folded_size = 0;
+        FILE* stream = open_memstream(&folded, &folded_size);
+        for (int d = depth - 1; d >= 0; d--) {
+            fprintf(stream, "%s%s", frames[d], d > 0 ? ";" : "");
+        }
+        fclose(stream);
+
+        stacks[stack_count] = Aguilar_Format(arena, "%s", folded);
+        leaves[stack_count] = frames[0];
+        stack_count++;
+        free(folded);
+
+        // NOTE(Alex): Recursion should not count a function twice in its total.
+        for (int d = 0; d < depth; d++) {
+            bool seen = false;
+            for (int e = 0; e < d and !seen; e++) {
+                seen = strcmp(frames[e], frames[d]) == 0;
+            }
+            if (!seen) {
+                names = Aguilar_ArrayReserve(arena, names, name_count, sizeof(char*));
+                names[name_count++] = frames[d];
+            }
+        }
+    }
+
+    free(line);
+    fclose(input);
+
+    if (stack_count == 0) {
+        printf("No samples collected, the program finished too quickly to profile.\n");
+        return 0;
+    }
+
+    qsort(stacks, stack_count, sizeof(char*), Aguilar_CompareNames);
+
+    FILE* output = fopen(folded_path, "w");
+    if (output == NULL) {
+        Aguilar_SetError("Failed to write folded stacks!");
+        return -1;
+    }
+
+    for (int i = 0; i < stack_count;) {
+        int j = i;
+        while (j < stack_count and strcmp(stacks[i], stacks[j]) == 0) {
+            j++;
+        }
+        fprintf(output, "%s %d\n", stacks[i], j - i);
+        i = j;
+    }
+
+    fclose(output);
+
+    qsort(names, name_count, sizeof(char*), Aguilar_CompareNames);
+
+    profile_entry_t* entries = AWN_ArenaPush(arena, sizeof(profile_entry_t) * name_count);
+    int entry_count = 0;
+
+    for (int i = 0; i < name_count;) {
+        int j = i;
+        while (j < name_count and strcmp(names[i], names[j]) == 0) {
+            j++;
+        }
+        entries[entry_count++] = (profile_entry_t){ names[i], 0, (u32)(j - i) };
+        i = j;
+    }
+
+    for (int i = 0; i < stack_count; i++) {
+        profile_entry_t key = { leaves[i], 0, 0 };
+        profile_entry_t* entry = bsearch(&key, entries, entry_count, sizeof(profile_entry_t), Aguilar_CompareProfileNames);
+        if (entry != NULL) {
+            entry->self++;
+        }
+    }
+
+    qsort(entries, entry_count, sizeof(profile_entry_t), Aguilar_CompareProfileEntries);
+
+    printf("\n%d samples", stack_count);
+    if (dropped > 0) {
+        printf(" (%lu dropped, buffer full)", dropped);
+    }
+    printf("\n%8s %8s  %s\n", "self", "total", "function");
+
+    for (int i = 0; i < entry_count and i < PROFILE_TOP_COUNT; i++) {
+        printf("%7.1f%% %7.1f%%  %s\n", 100.0 * entries[i].self / stack_count, 100.0 * entries[i].total / stack_count, entries[i].name);
+    }
+
+    printf("\nFolded stacks written to %s (flamegraph.pl %s > profile.svg)\n", folded_path, folded_path);
+
+    return 0;
+}
+
+// NOTE(Alex): Profiling modes need to look at the program after it exits, so unlike a
+//              plain run it is forked instead of exec'd.
+function int Aguilar_RunChild(const char* program, const char* env_key, const char* env_value, const char* preload, struct rusage* usage)
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        Aguilar_SetError("Failed to start program!");
+        return -1;
+    }
+
+    if (pid == 0) {
+        setenv(env_key, env_value, 1);
+        if (preload != NULL) {
+            setenv("LD_PRELOAD", preload, 1);
+        }
+        execl(program, program, (char*)NULL);
+        _exit(127);
+    }
+
+    // NOTE(Alex): Ctrl-C is for the program, we still want to report what it did.
+    signal(SIGINT, SIG_IGN);
+
+    int status = 0;
+    struct rusage child_usage;
+    while (wait4(pid, &status, 0, &child_usage) < 0 and errno == EINTR) {}
+
+    signal(SIGINT, SIG_DFL);
+
+    if (usage != NULL) {
+        *usage = child_usage;
+    }
+
+    if (WIFEXITED(status) and WEXITSTATUS(status) != 0) {
+        printf("Program exited with code %d\n", WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+        printf("Program killed by signal %d\n", WTERMSIG(status));
+    }
+
+    return 0;
+}
+
+function int Aguilar_ProfileProgram(arena_t *arena, const char* program, const char* file, u64 key)
+{
+    char* samples_path = Aguilar_FormatRunCachePath(arena, key, Aguilar_Format(arena, ".%d.samples", (int)getpid()));
+    if (samples_path == NULL) {
+        return -1;
+    }
+
+    const char* base = strrchr(file, '/') ? strrchr(file, '/') + 1 : file;
+    const char* ext = strrchr(base, '.');
+    int stem = (ext != NULL and ext != base) ? (int)(ext - base) : (int)strlen(base);
+    char* folded_path = Aguilar_Format(arena, "%.*s.folded", stem, base);
+
+    if (Aguilar_RunChild(program, ENV_PROFILE_OUT, samples_path, NULL, NULL) < 0) {
+        return -1;
+    }
+
+    int ret = Aguilar_ReportProfile(arena, program, samples_path, folded_path);
+    unlink(samples_path);
+
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Memory report for `run --mem`.
+//              Peak RSS comes from wait4, allocation counts from a malloc shim Aguilar builds
+//              once and preloads into the program. Scripts using awn.h are compiled with
+//              AWN_ARENA_STATS and -rdynamic so the shim can also find their arena counters.
+#define ENV_MEM_OUT "AGUILAR_MEM_OUT"
+#define MEM_FLAGS " -g -rdynamic -DAWN_ARENA_STATS"
+#define MEM_TOP_COUNT 10
+
+global const char* mem_runtime =
+    "// NOTE: Generated by Aguilar, do not edit.\n"
+    "// Preloaded into programs started with `aguilar run --mem`.\n"
+    "#define _GNU_SOURCE\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <stdint.h>\n"
+    "#include <string.h>\n"
+    "#include <dlfcn.h>\n"
+    "#include <link.h>\n"
+    "#include <malloc.h>\n"
+    "\n"
+    "#define AGUILAR_MEM_CLASSES 48\n"
+    "#define AGUILAR_MEM_SITES 4096\n"
+    "\n"
+    "typedef struct {\n"
+    "    uintptr_t pc;\n"
+    "    size_t count;\n"
+    "    size_t bytes;\n"
+    "} aguilar_mem_site;\n"
+    "\n"
+    "// Same layout as arena_stats_t in awn.h.\n"
+    "typedef struct {\n"
+    "    size_t arena_count;\n"
+    "    size_t push_count;\n"
+    "    size_t grow_count;\n"
+    "    size_t bytes_pushed;\n"
+    "    size_t bytes_reserved;\n"
+    "    size_t peak_reserved;\n"
+    "    size_t peak_used;\n"
+    "} aguilar_arena_stats;\n"
+    "\n"
+    "static void* (*aguilar_real_malloc)(size_t);\n"
+    "static void* (*aguilar_real_calloc)(size_t, size_t);\n"
+    "static void* (*aguilar_real_realloc)(void*, size_t);\n"
+    "static void (*aguilar_real_free)(void*);\n"
+    "static int (*aguilar_real_posix_memalign)(void**, size_t, size_t);\n"
+    "static void* (*aguilar_real_aligned_alloc)(size_t, size_t);\n"
+    "\n"
+    "static const char* aguilar_mem_out;\n"
+    "static int aguilar_mem_enabled;\n"
+    "\n"
+    "static size_t aguilar_mem_mallocs;\n"
+    "static size_t aguilar_mem_frees;\n"
+    "static size_t aguilar_mem_reallocs;\n"
+    "static size_t aguilar_mem_requested;\n"
+    "static size_t aguilar_mem_live;\n"
+    "static size_t aguilar_mem_peak;\n"
+    "static size_t aguilar_mem_class_count[AGUILAR_MEM_CLASSES];\n"
+    "static size_t aguilar_mem_class_bytes[AGUILAR_MEM_CLASSES];\n"
+    "static aguilar_mem_site aguilar_mem_sites[AGUILAR_MEM_SITES];\n"
+    "static size_t aguilar_mem_sites_dropped;\n"
+    "\n"
+    "// dlsym allocates through calloc before the real one is known.\n"
+    "static char aguilar_mem_bootstrap[4096];\n"
+    "static size_t aguilar_mem_bootstrap_used;\n"
+    "\n"
+    "#define AGUILAR_ADD(x, v) __atomic_fetch_add(&(x), (v), __ATOMIC_RELAXED)\n"
+    "\n"
+    "static void aguilar_mem_init(void)\n"
+    "{\n"
+    "    if (aguilar_real_malloc != NULL) return;\n"
+    "    aguilar_real_calloc = dlsym(RTLD_NEXT, \"calloc\");\n"
+    "    aguilar_real_malloc = dlsym(RTLD_NEXT, \"malloc\");\n"
+    "    aguilar_real_realloc = dlsym(RTLD_NEXT, \"realloc\");\n"
+    "    aguilar_real_free = dlsym(RTLD_NEXT, \"free\");\n"
+    "    aguilar_real_posix_memalign = dlsym(RTLD_NEXT, \"posix_memalign\");\n"
+    "    aguilar_real_aligned_alloc = dlsym(RTLD_NEXT, \"aligned_alloc\");\n"
+    "}\n"
+    "\n"
+    "static int aguilar_mem_is_bootstrap(void* ptr)\n"
+    "{\n"
+    "    return (char*)ptr >= aguilar_mem_bootstrap && (char*)ptr < aguilar_mem_bootstrap + sizeof(aguilar_mem_bootstrap);\n"
+    "}\n"
+    "\n"
+    "static void aguilar_mem_record(void* ptr, size_t size, uintptr_t site)\n"
+    "{\n"
+    "    if (ptr == NULL || !aguilar_mem_enabled) return;\n"
+    "\n"
+    "    int size_class = size <= 1 ? 0 : 64 - __builtin_clzll(size - 1);\n"
+    "    if (size_class >= AGUILAR_MEM_CLASSES) size_class = AGUILAR_MEM_CLASSES - 1;\n"
+    "\n"
+    "    AGUILAR_ADD(aguilar_mem_requested, size);\n"
+    "    AGUILAR_ADD(aguilar_mem_class_count[size_class], 1);\n"
+    "    AGUILAR_ADD(aguilar_mem_class_bytes[size_class], size);\n"
+    "\n"
+    "    size_t live = AGUILAR_ADD(aguilar_mem_live, malloc_usable_size(ptr)) + malloc_usable_size(ptr);\n"
+    "    size_t peak = __atomic_load_n(&aguilar_mem_peak, __ATOMIC_RELAXED);\n"
+    "    while (live > peak && !__atomic_compare_exchange_n(&aguilar_mem_peak, &peak, live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}\n"
+    "\n"
+    "    // Open addressing on the return address, slots are claimed once and never move.\n"
+    "    size_t slot = (site * 0x9E3779B97F4A7C15ULL) >> 52;\n"
+    "    for (size_t probe = 0; probe < AGUILAR_MEM_SITES; probe++) {\n"
+    "        aguilar_mem_site* entry = &aguilar_mem_sites[(slot + probe) & (AGUILAR_MEM_SITES - 1)];\n"
+    "        uintptr_t current = __atomic_load_n(&entry->pc, __ATOMIC_RELAXED);\n"
+    "        if (current == 0) {\n"
+    "            uintptr_t empty = 0;\n"
+    "            if (!__atomic_compare_exchange_n(&entry->pc, &empty, site, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {\n"
+    "                current = empty;\n"
+    "            } else {\n"
+    "                current = site;\n"
+    "            }\n"
+    "        }\n"
+    "        if (current == site) {\n"
+    "            AGUILAR_ADD(entry->count, 1);\n"
+    "            AGUILAR_ADD(entry->bytes, size);\n"
+    "            return;\n"
+    "        }\n"
+    "    }\n"
+    "    AGUILAR_ADD(aguilar_mem_sites_dropped, 1);\n"
+    "}\n"
+    "\n"
+    "static void aguilar_mem_release(void* ptr)\n"
+    "{\n"
+    "    if (ptr == NULL || !aguilar_mem_enabled) return;\n"
+    "    AGUILAR_ADD(aguilar_mem_frees, 1);\n"
+    "    __atomic_fetch_sub(&aguilar_mem_live, malloc_usable_size(ptr), __ATOMIC_RELAXED);\n"
+    "}\n"
+    "\n"
+    "void* malloc(size_t size)\n"
+    "{\n"
+    "    aguilar_mem_init();\n"
+    "    void* ptr = aguilar_real_malloc(size);\n"
+    "    if (aguilar_mem_enabled) AGUILAR_ADD(aguilar_mem_mallocs, 1);\n"
+    "    aguilar_mem_record(ptr, size, (uintptr_t)__builtin_return_address(0));\n"
+    "    return ptr;\n"
+    "}\n"
+    "\n"
+    "void* calloc(size_t count, size_t size)\n"
+    "{\n"
+    "    if (aguilar_real_calloc == NULL) {\n"
+    "        size_t total = (count * size + 15) & ~(size_t)15;\n"
+    "        if (aguilar_mem_bootstrap_used + total > sizeof(aguilar_mem_bootstrap)) return NULL;\n"
+    "        void* ptr = aguilar_mem_bootstrap + aguilar_mem_bootstrap_used;\n"
+    "        aguilar_mem_bootstrap_used += total;\n"
+    "        return ptr;\n"
+    "    }\n"
+    "    void* ptr = aguilar_real_calloc(count, size);\n"
+    "    if (aguilar_mem_enabled) AGUILAR_ADD(aguilar_mem_mallocs, 1);\n"
+    "    aguilar_mem_record(ptr, count * size, (uintptr_t)__builtin_return_address(0));\n"
+    "    return ptr;\n"
+    "}\n"
+    "\n"
+    "void* realloc(void* old, size_t size)\n"
+    "{\n"
+    "    aguilar_mem_init();\n"
+    "    if (aguilar_mem_is_bootstrap(old)) {\n"
+    "        void* ptr = aguilar_real_malloc(size);\n"
+    "        if (ptr != NULL) memcpy(ptr, old, size);\n"
+    "        return ptr;\n"
+    "    }\n"
+    "    if (old != NULL && aguilar_mem_enabled) {\n"
+    "        __atomic_fetch_sub(&aguilar_mem_live, malloc_usable_size(old), __ATOMIC_RELAXED);\n"
+    "    }\n"
+    "    void* ptr = aguilar_real_realloc(old, size);\n"
+    "    if (aguilar_mem_enabled) {\n"
+    "        AGUILAR_ADD(*(old != NULL ? &aguilar_mem_reallocs : &aguilar_mem_mallocs), 1);\n"
+    "        if (ptr == NULL && old != NULL && size != 0) {\n"
+    "            AGUILAR_ADD(aguilar_mem_live, malloc_usable_size(old));\n"
+    "        }\n"
+    "    }\n"
+    "    aguilar_mem_record(ptr, size, (uintptr_t)__builtin_return_address(0));\n"
+    "    return ptr;\n"
+    "}\n"
+    "\n"
+    "void free(void* ptr)\n"
+    "{\n"
+    "    if (ptr == NULL || aguilar_mem_is_bootstrap(ptr)) return;\n"
+    "    aguilar_mem_init();\n"
+    "    aguilar_mem_release(ptr);\n"
+    "    aguilar_real_free(ptr);\n"
+    "}\n"
+    "\n"
+    "int posix_memalign(void** out, size_t alignment, size_t size)\n"
+    "{\n"
+    "    aguilar_mem_init();\n"
+    "    int ret = aguilar_real_posix_memalign(out, alignment, size);\n"
+    "    if (ret == 0) {\n"
+    "        if (aguilar_mem_enabled) AGUILAR_ADD(aguilar_mem_mallocs, 1);\n"
+    "        aguilar_mem_record(*out, size, (uintptr_t)__builtin_return_address(0));\n"
+    "    }\n"
+    "    return ret;\n"
+    "}\n"
+    "\n"
+    "void* aligned_alloc(size_t alignment, size_t size)\n"
+    "{\n"
+    "    aguilar_mem_init();\n"
+    "    void* ptr = aguilar_real_aligned_alloc(alignment, size);\n"
+    "    if (aguilar_mem_enabled) AGUILAR_ADD(aguilar_mem_mallocs, 1);\n"
+    "    aguilar_mem_record(ptr, size, (uintptr_t)__builtin_return_address(0));\n"
+    "    return ptr;\n"
+    "}\n"
+    "\n"
+    "static uintptr_t aguilar_mem_base;\n"
+    "static uintptr_t aguilar_mem_exe_lo = UINTPTR_MAX;\n"
+    "static uintptr_t aguilar_mem_exe_hi;\n"
+    "\n"
+    "static int aguilar_mem_find_exe(struct dl_phdr_info* info, size_t size, void* data)\n"
+    "{\n"
+    "    (void)size; (void)data;\n"
+    "    aguilar_mem_base = info->dlpi_addr;\n"
+    "    for (int i = 0; i < info->dlpi_phnum; i++) {\n"
+    "        if (info->dlpi_phdr[i].p_type != PT_LOAD) continue;\n"
+    "        uintptr_t lo = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;\n"
+    "        uintptr_t hi = lo + info->dlpi_phdr[i].p_memsz;\n"
+    "        if (lo < aguilar_mem_exe_lo) aguilar_mem_exe_lo = lo;\n"
+    "        if (hi > aguilar_mem_exe_hi) aguilar_mem_exe_hi = hi;\n"
+    "    }\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "__attribute__((constructor)) static void aguilar_mem_start(void)\n"
+    "{\n"
+    "    aguilar_mem_init();\n"
+    "    aguilar_mem_out = getenv(\"AGUILAR_MEM_OUT\");\n"
+    "    if (aguilar_mem_out == NULL) return;\n"
+    "\n"
+    "    // Children of the program are not part of the report.\n"
+    "    unsetenv(\"AGUILAR_MEM_OUT\");\n"
+    "    unsetenv(\"LD_PRELOAD\");\n"
+    "    aguilar_mem_enabled = 1;\n"
+    "}\n"
+    "\n"
+    "// Preloaded libraries are finalized last, after the program's own atexit handlers.\n"
+    "__attribute__((destructor)) static void aguilar_mem_stop(void)\n"
+    "{\n"
+    "    if (!aguilar_mem_enabled) return;\n"
+    "    aguilar_mem_enabled = 0;\n"
+    "\n"
+    "    FILE* out = fopen(aguilar_mem_out, \"w\");\n"
+    "    if (out == NULL) return;\n"
+    "\n"
+    "    dl_iterate_phdr(aguilar_mem_find_exe, NULL);\n"
+    "\n"
+    "    fprintf(out, \"base %lx\\n\", (unsigned long)aguilar_mem_base);\n"
+    "    fprintf(out, \"totals %zu %zu %zu %zu %zu %zu %zu\\n\", aguilar_mem_mallocs, aguilar_mem_frees, aguilar_mem_reallocs,\n"
+    "            aguilar_mem_requested, aguilar_mem_live, aguilar_mem_peak, aguilar_mem_sites_dropped);\n"
+    "\n"
+    "    for (int i = 0; i < AGUILAR_MEM_CLASSES; i++) {\n"
+    "        if (aguilar_mem_class_count[i] != 0) {\n"
+    "            fprintf(out, \"class %d %zu %zu\\n\", i, aguilar_mem_class_count[i], aguilar_mem_class_bytes[i]);\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    for (int i = 0; i < AGUILAR_MEM_SITES; i++) {\n"
+    "        aguilar_mem_site* site = &aguilar_mem_sites[i];\n"
+    "        if (site->pc == 0) continue;\n"
+    "\n"
+    "        uintptr_t pc = site->pc - 1;\n"
+    "        Dl_info dl;\n"
+    "        if (pc >= aguilar_mem_exe_lo && pc < aguilar_mem_exe_hi) {\n"
+    "            fprintf(out, \"site %zu %zu %lx\\n\", site->count, site->bytes, (unsigned long)pc);\n"
+    "        } else if (dladdr((void*)pc, &dl) && dl.dli_sname != NULL) {\n"
+    "            fprintf(out, \"site %zu %zu %lx=%s\\n\", site->count, site->bytes, (unsigned long)pc, dl.dli_sname);\n"
+    "        } else if (dladdr((void*)pc, &dl) && dl.dli_fname != NULL) {\n"
+    "            const char* slash = strrchr(dl.dli_fname, '/');\n"
+    "            fprintf(out, \"site %zu %zu %lx=[%s]\\n\", site->count, site->bytes, (unsigned long)pc, slash != NULL ? slash + 1 : dl.dli_fname);\n"
+    "        } else {\n"
+    "            fprintf(out, \"site %zu %zu %lx=[unknown]\\n\", site->count, site->bytes, (unsigned long)pc);\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    // Scripts built with awn.h export their arena counters (run --mem links with -rdynamic).\n"
+    "    aguilar_arena_stats* arenas = dlsym(RTLD_DEFAULT, \"AWN_ArenaGlobalStats\");\n"
+    "    if (arenas != NULL) {\n"
+    "        fprintf(out, \"arena %zu %zu %zu %zu %zu %zu %zu\\n\", arenas->arena_count, arenas->push_count, arenas->grow_count,\n"
+    "                arenas->bytes_pushed, arenas->bytes_reserved, arenas->peak_reserved, arenas->peak_used);\n"
+    "    }\n"
+    "\n"
+    "    fclose(out);\n"
+    "}\n";
+
+// NOTE(Alex): The shim is a shared library, so it does not go through the run cache. It is
+//              rebuilt whenever its source is newer, and renamed into place like everything else.
+function char* Aguilar_BuildRuntimeLibrary(arena_t *arena, const char* source)
+{
+    char* library = Aguilar_Format(arena, "%.*s.so", (int)(strrchr(source, '.') - source), source);
+
+    struct stat source_sb;
+    struct stat library_sb;
+    if (Aguilar_FileExists(library, &library_sb) and Aguilar_FileExists(source, &source_sb) and
+        Aguilar_ModTime(&library_sb) >= Aguilar_ModTime(&source_sb)) {
+        return library;
+    }
+
+    char tmp_path[PATH_MAX];
+    if (!Aguilar_FormatTempPath(tmp_path, sizeof(tmp_path), library)) {
+        Aguilar_SetError("Runtime path is too long!");
+        return NULL;
+    }
+
+    char* command = Aguilar_Format(arena, "%s -shared -fPIC -O2 -o %s %s -ldl", Aguilar_GetCompilerEnv(), tmp_path, source);
+    printf("%s\n", command);
+    fflush(stdout);
+
+    if (system(command) != 0 or rename(tmp_path, library) != 0) {
+        unlink(tmp_path);
+        Aguilar_SetError("Failed to build the memory runtime!");
+        return NULL;
+    }
+
+    return library;
+}
+
+function void Aguilar_PrintBytes(u64 bytes)
+{
+    if (bytes >= MB(1)) {
+        printf("%.1f MB", bytes / (1024.0 * 1024.0));
+    } else if (bytes >= KB(1)) {
+        printf("%.1f KB", bytes / 1024.0);
+    } else {
+        printf("%lu B", bytes);
+    }
+}
+
+STRUCT(mem_site_t)
+{
+    u64 count;
+    u64 bytes;
+    char* name;
+};
+
+function int Aguilar_CompareMemSites(const void* a, const void* b)
+{
+    const mem_site_t* sa = a;
+    const mem_site_t* sb = b;
+    return (sa->bytes < sb->bytes) - (sa->bytes > sb->bytes);
+}
+
+function int Aguilar_ReportMemory(arena_t *arena, const char* program, const char* report_path)
+{
+    FILE* input = fopen(report_path, "r");
+    if (input == NULL) {
+        printf("No allocation report (the program called _exit or crashed).\n");
+        return 0;
+    }
+
+    symbol_table_t table;
+    if (Aguilar_ReadSymbols(arena, program, &table) != 0) {
+        fclose(input);
+        return -1;
+    }
+
+    u64 base = 0;
+    u64 totals[7] = {0};
+    u64 arenas[7] = {0};
+    bool has_arenas = false;
+    u64 class_count[64] = {0};
+    u64 class_bytes[64] = {0};
+
+    mem_site_t* sites = NULL;
+    int site_count = 0;
+
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+
+    while ((length = getline(&line, &line_capacity, input)) > 0) {
+        if (line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+
+        int size_class;
+        u64 count;
+        u64 bytes;
+        int consumed = 0;
+
+        if (sscanf(line, "base %lx", &base) == 1) {
+            continue;
+        } else if (sscanf(line, "totals %lu %lu %lu %lu %lu %lu %lu", &totals[0], &totals[1], &totals[2], &totals[3], &totals[4], &totals[5], &totals[6]) == 7) {
+            continue;
+        } else if (sscanf(line, "arena %lu %lu %lu %lu %lu %lu %lu", &arenas[0], &arenas[1], &arenas[2], &arenas[3], &arenas[4], &arenas[5], &arenas[6]) == 7) {
+            has_arenas = true;
+        } else if (sscanf(line, "class %d %lu %lu", &size_class, &count, &bytes) == 3 and size_class >= 0 and size_class < 64) {
+            class_count[size_class] = count;
+            class_bytes[size_class] = bytes;
+        } else if (sscanf(line, "site %lu %lu %n", &count, &bytes, &consumed) == 2 and consumed > 0) {
+            char* pc = line + consumed;
+            char* name = strchr(pc, '=');
+            char* symbol;
+
+            if (name != NULL) {
+                symbol = Aguilar_Format(arena, "%s", name + 1);
+            } else {
+                u64 address = strtoull(pc, NULL, 16) - base;
+                const char* function_name = Aguilar_LookupSymbol(&table, address);
+                symbol = function_name != NULL ? (char*)function_name : Aguilar_Format(arena, "0x%lx", address);
+            }
+
+            sites = Aguilar_ArrayReserve(arena, sites, site_count, sizeof(mem_site_t));
+            sites[site_count++] = (mem_site_t){ count, bytes, symbol };
+        }
+    }
+
+    free(line);
+    fclose(input);
+
+    printf("Allocations: %lu, frees: %lu, reallocs: %lu, requested: ", totals[0], totals[1], totals[2]);
+    Aguilar_PrintBytes(totals[3]);
+    printf("\nPeak heap: ");
+    Aguilar_PrintBytes(totals[5]);
+    printf(", still allocated at exit: ");
+    Aguilar_PrintBytes(totals[4]);
+    printf(" (%ld blocks)\n", (i64)(totals[0] - totals[1]));
+
+    printf("\n%12s %10s %12s\n", "size", "count", "bytes");
+    for (int i = 0; i < 64; i++) {
+        if (class_count[i] == 0) {
+            continue;
+        }
+        char label[32];
+        snprintf(label, sizeof(label), "<= %lu", 1ul << i);
+        printf("%12s %10lu %12lu\n", label, class_count[i], class_bytes[i]);
+    }
+
+    // NOTE(Alex): The same function can show up from several call instructions, merge them.
+    qsort(sites, site_count, sizeof(mem_site_t), Aguilar_CompareMemSites);
+    for (int i = 0; i < site_count; i++) {
+        for (int j = i + 1; j < site_count; j++) {
+            if (sites[j].count != 0 and strcmp(sites[i].name, sites[j].name) == 0) {
+                sites[i].count += sites[j].count;
+                sites[i].bytes += sites[j].bytes;
+                sites[j].count = 0;
+                sites[j].bytes = 0;
+            }
+        }
+    }
+    qsort(sites, site_count, sizeof(mem_site_t), Aguilar_CompareMemSites);
+
+    printf("\n%10s %12s  %s\n", "count", "bytes", "call site");
+    for (int i = 0; i < site_count and i < MEM_TOP_COUNT and sites[i].count != 0; i++) {
+        printf("%10lu %12lu  %s\n", sites[i].count, sites[i].bytes, sites[i].name);
+    }
+
+    if (totals[6] > 0) {
+        printf("(%lu allocations from untracked call sites)\n", totals[6]);
+    }
+
+    if (has_arenas) {
+        printf("\nArenas: %lu created, %lu pushes, %lu grows, ", arenas[0], arenas[1], arenas[2]);
+        Aguilar_PrintBytes(arenas[3]);
+        printf(" pushed, peak reserved ");
+        Aguilar_PrintBytes(arenas[5]);
+        printf(", largest arena used ");
+        Aguilar_PrintBytes(arenas[6]);
+        printf("\n");
+    }
+
+    return 0;
+}
+
+function int Aguilar_MemoryProgram(arena_t *arena, const char* program, u64 key)
+{
+    char* source = Aguilar_WriteRuntime(arena, "aguilar_mem.c", mem_runtime);
+    if (source == NULL) {
+        return -1;
+    }
+
+    char* library = Aguilar_BuildRuntimeLibrary(arena, source);
+    if (library == NULL) {
+        return -1;
+    }
+
+    char* report_path = Aguilar_FormatRunCachePath(arena, key, Aguilar_Format(arena, ".%d.mem", (int)getpid()));
+    if (report_path == NULL) {
+        return -1;
+    }
+
+    struct rusage usage;
+    if (Aguilar_RunChild(program, ENV_MEM_OUT, report_path, library, &usage) < 0) {
+        return -1;
+    }
+
+    printf("\nPeak RSS: ");
+    Aguilar_PrintBytes((u64)usage.ru_maxrss * 1024);
+    printf(", page faults: %ld minor, %ld major\n", usage.ru_minflt, usage.ru_majflt);
+
+    int ret = Aguilar_ReportMemory(arena, program, report_path);
+    unlink(report_path);
+
+    return ret;
+}
+
+function int Aguilar_LaunchProgram(arena_t *arena, const char* program, const char* file, u64 key, run_mode_t mode)
+{
+    switch (mode) {
+        case RUN_PROFILE: return Aguilar_ProfileProgram(arena, program, file, key);
+        case RUN_MEM: return Aguilar_MemoryProgram(arena, program, key);
+        default: return Aguilar_ExecProgram(program);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): In process TinyCC backend for `run` (AGUILAR_COMPILER=tcc).
+//              libtcc is loaded with dlopen, so Aguilar neither needs it to build nor to start.
+//              The script is compiled into memory and its main is called from Aguilar itself,
+//              there is no compiler process and no binary on disk. When libtcc is missing, or
+//              TCC cannot compile the script (it lacks a lot of GNU C and C11, stdatomic.h for
+//              one), the cached gcc run takes over.
+#define TCC_OUTPUT_MEMORY 1
+#define TCC_RELOCATE_AUTO ((void*)1)
+
+// NOTE(Alex): The subset of libtcc.h we use. tcc_relocate lost its second argument after
+//              0.9.27, passing it anyway is harmless.
+STRUCT(libtcc_t)
+{
+    void* (*new_state)(void);
+    void (*set_error_func)(void* state, void* opaque, void (*error_func)(void* opaque, const char* message));
+    void (*set_options)(void* state, const char* options);
+    int (*set_output_type)(void* state, int type);
+    int (*add_file)(void* state, const char* path);
+    int (*relocate)(void* state, void* ptr);
+    void* (*get_symbol)(void* state, const char* name);
+};
+
+function bool Aguilar_LoadLibTcc(libtcc_t *tcc)
+{
+    const char* names[] = { "libtcc.so", "libtcc.so.1", "/usr/local/lib/libtcc.so", "/usr/local/lib/tcc/libtcc.so" };
+    void* library = NULL;
+
+    for (int i = 0; i < (int)AWN_ArrayCount(names) and library == NULL; i++) {
+        library = dlopen(names[i], RTLD_NOW | RTLD_LOCAL);
+    }
+
+    if (library == NULL) {
+        return false;
+    }
+
+    *(void**)&tcc->new_state = dlsym(library, "tcc_new");
+    *(void**)&tcc->set_error_func = dlsym(library, "tcc_set_error_func");
+    *(void**)&tcc->set_options = dlsym(library, "tcc_set_options");
+    *(void**)&tcc->set_output_type = dlsym(library, "tcc_set_output_type");
+    *(void**)&tcc->add_file = dlsym(library, "tcc_add_file");
+    *(void**)&tcc->relocate = dlsym(library, "tcc_relocate");
+    *(void**)&tcc->get_symbol = dlsym(library, "tcc_get_symbol");
+
+    return tcc->new_state != NULL and tcc->set_error_func != NULL and tcc->set_options != NULL and
+           tcc->set_output_type != NULL and tcc->add_file != NULL and tcc->relocate != NULL and tcc->get_symbol != NULL;
+}
+
+// NOTE(Alex): Errors are kept quiet, gcc reports them properly if it cannot compile the script either.
+function void Aguilar_TccError(void* opaque, const char* message)
+{
+    (void)opaque;
+    (void)message;
+}
+
+// NOTE(Alex): Only returns when TCC could not run the script.
+function void Aguilar_RunTcc(char* file, const char* args)
+{
+    libtcc_t tcc = { 0 };
+    if (!Aguilar_LoadLibTcc(&tcc)) {
+        printf("libtcc not found, compiling with %s.\n", Aguilar_GetCompilerEnv());
+        return;
+    }
+
+    void* state = tcc.new_state();
+    if (state == NULL) {
+        return;
+    }
+
+    tcc.set_error_func(state, NULL, Aguilar_TccError);
+    tcc.set_options(state, args);
+
+    int (*entry)(int, char**) = NULL;
+
+    if (tcc.set_output_type(state, TCC_OUTPUT_MEMORY) == 0 and tcc.add_file(state, file) == 0 and
+        tcc.relocate(state, TCC_RELOCATE_AUTO) >= 0) {
+        *(void**)&entry = tcc.get_symbol(state, "main");
+    }
+
+    if (entry == NULL) {
+        // NOTE(Alex): The state is leaked on purpose, TCC may be half way through anything.
+        printf("TCC could not compile %s, compiling with %s.\n", file, Aguilar_GetCompilerEnv());
+        return;
+    }
+
+    char* argv[] = { file, NULL };
+
+    fflush(stdout);
+    fflush(stderr);
+
+    exit(entry(1, argv));
+}
+
+function int Aguilar_Run(arena_t *arena, char* file, char* arg, run_mode_t mode)
+{
+    struct stat sb;
+    if (!Aguilar_FileExists(file, &sb)) {
+        Aguilar_SetError("File does not exist!");
+        return -1;
+    }
+
+    if (mode == RUN_NORMAL and Aguilar_CompilerIsTcc()) {
+        Aguilar_RunTcc(file, arg != 0 ? arg : DEFAULT_FLAGS);
+    }
+
+    char abs_file[PATH_MAX];
+    if (realpath(file, abs_file) == NULL) {
+        Aguilar_SetError("Failed to resolve file path!");
+        return -1;
+    }
+
+    char* sources = file;
+    char* user_args = arg != 0 ? arg : DEFAULT_FLAGS;
+
+    u64 key = Aguilar_RunCacheKey(arena, abs_file, arg);
+
+    // NOTE(Alex): Profiled builds are their own cache entry, so switching back and forth
+    //              does not recompile every time.
+    if (mode == RUN_PROFILE) {
+        char* runtime = Aguilar_WriteRuntime(arena, "aguilar_profile.c", profile_runtime);
+        if (runtime == NULL) {
+            return -1;
+        }
+
+        sources = Aguilar_Format(arena, "%s %s", file, runtime);
+        user_args = Aguilar_Format(arena, "%s%s", user_args, PROFILE_FLAGS);
+        key = Aguilar_HashString(key, profile_runtime);
+    } else if (mode == RUN_MEM) {
+        user_args = Aguilar_Format(arena, "%s%s", user_args, MEM_FLAGS);
+        key = Aguilar_HashString(key, MEM_FLAGS);
+    }
+
+    bool warm = false;
+    char* out_path = Aguilar_RunCacheCompile(arena, abs_file, Aguilar_ModTime(&sb), sources, user_args, key, &warm);
+    if (out_path == NULL) {
+        return -1;
+    }
+
+    if (warm) {
+        printf("No changes, not recompiling!\n");
+    }
+
+    return Aguilar_LaunchProgram(arena, out_path, file, key, mode);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Resident daemon (`aguilar serve`).
+//              A per-user process listening on a Unix socket that remembers which run cache
+//              entries and project builds are up to date, and uses inotify to find out when
+//              they stop being so. A warm run or a no-op build is then one round trip instead
+//              of hashing, stat'ing and re-reading settings. Everything else still happens in
+//              the client, or in a child forked with the client's stdio, and when no daemon is
+//              listening (or AGUILAR_NO_DAEMON is set) the client just does the work itself.
+//
+//              Requests are a u32 length followed by NUL separated strings (command, cwd, args,
+//              then the client's environment), with the client's stdin, stdout and stderr
+//              attached as SCM_RIGHTS. Replies are a single line: "exec <path>", "done <code>"
+//              or "fallback". A build the daemon takes on is first answered with "building",
+//              so the client only waits without a timeout once the daemon is known to be alive.
+#define ENV_NO_DAEMON "AGUILAR_NO_DAEMON"
+#define DAEMON_MAX_REQUEST KB(256)
+#define DAEMON_MAX_CLIENTS 64
+#define DAEMON_TIMEOUT_S 5
+
+// NOTE(Alex): The socket lives in a directory only we can enter, so nobody else can put a socket
+//              where we look for one, or connect to ours. The client hands the daemon its
+//              environment and stdio and execs whatever path it gets back, so both ends also
+//              check who is on the other side.
+function bool Aguilar_FormatSocketPath(char* buffer, usize buffer_size, bool create)
+{
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir == NULL or runtime_dir[0] == '\0') {
+        runtime_dir = "/tmp";
+    }
+
+    char dir[PATH_MAX];
+    int written = snprintf(dir, sizeof(dir), "%s/aguilar-%d", runtime_dir, (int)getuid());
+    if (written <= 0 or (usize)written >= sizeof(dir)) {
+        return false;
+    }
+
+    if (create and mkdir(dir, S_IRWXU) != 0 and errno != EEXIST) {
+        return false;
+    }
+
+    struct stat sb;
+    if (lstat(dir, &sb) != 0 or !S_ISDIR(sb.st_mode) or sb.st_uid != getuid() or (sb.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+        return false;
+    }
+
+    written = snprintf(buffer, buffer_size, "%s/aguilar.sock", dir);
+    return written > 0 and (usize)written < buffer_size and (usize)written < sizeof(((struct sockaddr_un*)0)->sun_path);
+}
+
+function bool Aguilar_PeerIsUser(int fd)
+{
+    struct ucred credentials;
+    socklen_t size = sizeof(credentials);
+
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0 and credentials.uid == getuid();
+}
+
+function int Aguilar_DaemonConnect()
+{
+    const char* disabled = getenv(ENV_NO_DAEMON);
+    if (disabled != NULL and disabled[0] != '\0' and strcmp(disabled, "0") != 0) {
+        return -1;
+    }
+
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    if (!Aguilar_FormatSocketPath(address.sun_path, sizeof(address.sun_path), false)) {
+        return -1;
+    }
+
+    struct stat sb;
+    if (lstat(address.sun_path, &sb) != 0 or !S_ISSOCK(sb.st_mode) or sb.st_uid != getuid()) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0 or !Aguilar_PeerIsUser(fd)) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+function int Aguilar_DaemonSendRequest(int fd, const char** strings, int count)
+{
+    extern char** environ;
+
+    usize size = 0;
+    for (int i = 0; i < count; i++) {
+        size += strlen(strings[i]) + 1;
+    }
+    for (char** env = environ; *env != NULL; env++) {
+        size += strlen(*env) + 1;
+    }
+
+    if (size > DAEMON_MAX_REQUEST) {
+        return -1;
+    }
+
+    char* payload = malloc(size + sizeof(u32));
+    if (payload == NULL) {
+        return -1;
+    }
+
+    u32 length = (u32)size;
+    memcpy(payload, &length, sizeof(u32));
+
+    char* cursor = payload + sizeof(u32);
+    for (int i = 0; i < count; i++) {
+        usize string_size = strlen(strings[i]) + 1;
+        memcpy(cursor, strings[i], string_size);
+        cursor += string_size;
+    }
+    for (char** env = environ; *env != NULL; env++) {
+        usize string_size = strlen(*env) + 1;
+        memcpy(cursor, *env, string_size);
+        cursor += string_size;
+    }
+
+    int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    char control[CMSG_SPACE(sizeof(fds))] = {0};
+
+    struct iovec iov = { payload, size + sizeof(u32) };
+    struct msghdr message = {0};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    // NOTE(Alex): The descriptors ride along with the first chunk, the rest is a plain write.
+    ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+    usize total = sent > 0 ? (usize)sent : 0;
+    while (sent > 0 and total < size + sizeof(u32)) {
+        sent = send(fd, payload + total, size + sizeof(u32) - total, MSG_NOSIGNAL);
+        total += sent > 0 ? (usize)sent : 0;
+    }
+
+    free(payload);
+
+    return total == size + sizeof(u32) ? 0 : -1;
+}
+
+// NOTE(Alex): A daemon that stopped answering looks like no daemon at all, after the timeout
+//              the caller does the work itself.
+function int Aguilar_DaemonReadReply(int fd, char* reply, usize reply_size)
+{
+    struct timeval timeout = { DAEMON_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    usize length = 0;
+
+    while (length + 1 < reply_size) {
+        ssize_t count = read(fd, reply + length, 1);
+        if (count < 0 and errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return -1;
+        }
+        if (reply[length] == '\n') {
+            // NOTE(Alex): The build runs as long as it runs, the real reply comes when it is done.
+            if (length == strlen("building") and memcmp(reply, "building", length) == 0) {
+                timeout = (struct timeval){ 0, 0 };
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                length = 0;
+                continue;
+            }
+            break;
+        }
+        length++;
+    }
+
+    reply[length] = '\0';
+    return 0;
+}
+
+// NOTE(Alex): Returns 1 when the daemon handled the request (exit code in *code), 0 when the
+//              caller should do the work itself. Exec replies never return on success.
+function int Aguilar_DaemonRequest(const char** strings, int count, int* code)
+{
+    int fd = Aguilar_DaemonConnect();
+    if (fd < 0) {
+        return 0;
+    }
+
+    char reply[PATH_MAX + 16];
+    if (Aguilar_DaemonSendRequest(fd, strings, count) != 0 or Aguilar_DaemonReadReply(fd, reply, sizeof(reply)) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    close(fd);
+
+    if (strncmp(reply, "exec ", 5) == 0) {
+        printf("No changes, not recompiling!\n");
+        Aguilar_ExecProgram(reply + 5);
+        return 0;
+    }
+
+    if (strncmp(reply, "done ", 5) == 0) {
+        *code = atoi(reply + 5);
+        return 1;
+    }
+
+    return 0;
+}
+
+// NOTE(Alex): The key is worked out here, the compiler it names comes from our environment and
+//              not the daemon's.
+function int Aguilar_DaemonRun(arena_t *arena, char* file, char* arg)
+{
+    char abs_file[PATH_MAX];
+    if (realpath(file, abs_file) == NULL) {
+        return 0;
+    }
+
+    char* key = Aguilar_Format(arena, "%016lx", Aguilar_RunCacheKey(arena, abs_file, arg));
+    const char* strings[] = { "run", "", abs_file, key };
+    int code = 0;
+    return Aguilar_DaemonRequest(strings, 4, &code);
+}
+
+function int Aguilar_DaemonBuild(int* code)
+{
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        return 0;
+    }
+
+    const char* strings[] = { "build", cwd };
+    return Aguilar_DaemonRequest(strings, 2, code);
+}
+
+STRUCT(daemon_run_t)
+{
+    u64 key;
+    char* out_path;
+    char* settings_path;
+    int wd;
+    bool dirty;
+};
+
+STRUCT(daemon_project_t)
+{
+    char* dir;
+    u64 env_stamp;
+    bool clean;
+    bool dirty;
+    int building;
+};
+
+STRUCT(daemon_watch_t)
+{
+    int wd;
+    int index;
+    bool is_project;
+};
+
+// NOTE(Alex): A job with no pid is a client waiting on a build of the same project that
+//              was already running, rather than racing it over the same object files.
+STRUCT(daemon_job_t)
+{
+    pid_t pid;
+    int client;
+    int project;
+    int out_fd;
+};
+
+STRUCT(daemon_state_t)
+{
+    arena_t *arena;
+    int inotify_fd;
+
+    daemon_run_t* runs;
+    int run_count;
+
+    daemon_project_t* projects;
+    int project_count;
+
+    daemon_watch_t* watches;
+    int watch_count;
+
+    daemon_job_t jobs[DAEMON_MAX_CLIENTS];
+    int job_count;
+};
+
+function void Aguilar_DaemonAddWatch(daemon_state_t *state, const char* path, u32 mask, int index, bool is_project, int* out_wd)
+{
+    int wd = inotify_add_watch(state->inotify_fd, path, mask);
+    if (out_wd != NULL) {
+        *out_wd = wd;
+    }
+    if (wd < 0) {
+        return;
+    }
+
+    for (int i = 0; i < state->watch_count; i++) {
+        if (state->watches[i].wd == wd and state->watches[i].index == index and state->watches[i].is_project == is_project) {
+            return;
+        }
+    }
+
+    state->watches = Aguilar_ArrayReserve(state->arena, state->watches, state->watch_count, sizeof(daemon_watch_t));
+    state->watches[state->watch_count++] = (daemon_watch_t){ wd, index, is_project };
+}
+
+// NOTE(Alex): The project's own outputs land next to its sources, so only names that can
+//              change what gets built count as a modification.
+function bool Aguilar_DaemonRelevantName(const char* name, u32 mask)
+{
+    if (name == NULL or name[0] == '\0') {
+        return true;
+    }
+    if (mask & IN_ISDIR) {
+        return name[0] != '.';
+    }
+
+    usize length = strlen(name);
+    return (length > 2 and (strcmp(name + length - 2, ".c") == 0 or strcmp(name + length - 2, ".h") == 0)) or
+           strcmp(name, ".aguilar") == 0;
+}
+
+function void Aguilar_DaemonWatchTree(daemon_state_t *state, const char* dir, int project, int depth)
+{
+    const u32 mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+    Aguilar_DaemonAddWatch(state, dir, mask | IN_ONLYDIR, project, true, NULL);
+
+    if (depth > 8) {
+        return;
+    }
+
+    DIR* handle = opendir(dir);
+    if (handle == NULL) {
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != NULL) {
+        if (entry->d_name[0] == '.' or entry->d_type != DT_DIR) {
+            continue;
+        }
+
+        char path[PATH_MAX];
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) < (int)sizeof(path)) {
+            Aguilar_DaemonWatchTree(state, path, project, depth + 1);
+        }
+    }
+
+    closedir(handle);
+}
+
+function void Aguilar_DaemonReadEvents(daemon_state_t *state)
+{
+    char buffer[KB(16)] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        ssize_t length = read(state->inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            struct inotify_event* event = (struct inotify_event*)cursor;
+            cursor += sizeof(struct inotify_event) + event->len;
+
+            for (int i = 0; i < state->watch_count; i++) {
+                daemon_watch_t* watch = &state->watches[i];
+                if (watch->wd != event->wd) {
+                    continue;
+                }
+
+                if (watch->is_project) {
+                    daemon_project_t* project = &state->projects[watch->index];
+
+                    // NOTE(Alex): Deleting an output has to rebuild it, but builds replace their own outputs.
+                    bool removed = (event->mask & (IN_DELETE | IN_MOVED_FROM)) and project->building == 0;
+                    if (removed or (event->mask & IN_IGNORED) or Aguilar_DaemonRelevantName(event->len > 0 ? event->name : NULL, event->mask)) {
+                        project->dirty = true;
+                        project->clean = false;
+                    }
+                } else {
+                    state->runs[watch->index].dirty = true;
+                }
+
+                // NOTE(Alex): The kernel dropped the watch (file replaced or deleted), the next
+                //              request re-checks the disk and watches the new inode.
+                if (event->mask & IN_IGNORED) {
+                    if (!watch->is_project) {
+                        state->runs[watch->index].wd = -1;
+                    }
+                    watch->wd = -1;
+                }
+            }
+        }
+    }
+}
+
+function void Aguilar_DaemonReply(int client, const char* format, ...)
+{
+    char reply[PATH_MAX + 16];
+
+    va_list list;
+    va_start(list, format);
+    int length = vsnprintf(reply, sizeof(reply), format, list);
+    va_end(list);
+
+    if (length > 0 and length < (int)sizeof(reply)) {
+        send(client, reply, length, MSG_NOSIGNAL);
+    }
+}
+
+function void Aguilar_DaemonHandleRun(daemon_state_t *state, int client, char* abs_file, char* key_hex)
+{
+    u64 key = strtoull(key_hex, NULL, 16);
+
+    daemon_run_t* run = NULL;
+    int index = 0;
+    for (; index < state->run_count; index++) {
+        if (state->runs[index].key == key) {
+            run = &state->runs[index];
+            break;
+        }
+    }
+
+    if (run != NULL and run->wd >= 0 and !run->dirty) {
+        Aguilar_DaemonReply(client, "exec %s\n", run->out_path);
+        return;
+    }
+
+    if (run == NULL) {
+        char* out_path = Aguilar_FormatRunCachePath(state->arena, key, ".out");
+        char* settings_path = Aguilar_FormatRunCachePath(state->arena, key, ".cache");
+        if (out_path == NULL or settings_path == NULL) {
+            Aguilar_DaemonReply(client, "fallback\n");
+            return;
+        }
+
+        state->runs = Aguilar_ArrayReserve(state->arena, state->runs, state->run_count, sizeof(daemon_run_t));
+        index = state->run_count++;
+        run = &state->runs[index];
+        *run = (daemon_run_t){ key, out_path, settings_path, -1, true };
+    }
+
+    // NOTE(Alex): Watch first, then check, so an edit in between is never missed.
+    run->dirty = false;
+    if (run->wd < 0) {
+        Aguilar_DaemonAddWatch(state, abs_file, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF, index, false, &run->wd);
+    }
+
+    struct stat sb;
+    if (run->wd >= 0 and Aguilar_FileExists(abs_file, &sb) and
+        Aguilar_CacheSettingsMatch(run->settings_path, abs_file, Aguilar_ModTime(&sb)) and Aguilar_FileExists(run->out_path, 0)) {
+        Aguilar_DaemonReply(client, "exec %s\n", run->out_path);
+        return;
+    }
+
+    run->dirty = true;
+    Aguilar_DaemonReply(client, "fallback\n");
+}
+
+// NOTE(Alex): The client's environment picks the compiler, the caches and the workers, so a
+//              project is only clean for the environment it was last built with.
+function u64 Aguilar_DaemonEnvStamp(char** env)
+{
+    const char* names[] = { ENV_COMPILER, ENV_CACHE_DIR, ENV_WORKERS, "PATH", "HOME" };
+    u64 stamp = HASH_SEED;
+
+    for (usize i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        usize name_length = strlen(names[i]);
+        const char* value = "";
+        for (char** var = env; *var != NULL; var++) {
+            if (strncmp(*var, names[i], name_length) == 0 and (*var)[name_length] == '=') {
+                value = *var + name_length + 1;
+                break;
+            }
+        }
+        stamp = Aguilar_HashString(Aguilar_HashString(stamp, names[i]), value);
+    }
+
+    return stamp;
+}
+
+function bool Aguilar_DaemonHandleBuild(daemon_state_t *state, int client, char* dir, char** env, int* fds)
+{
+    int index = 0;
+    for (; index < state->project_count; index++) {
+        if (strcmp(state->projects[index].dir, dir) == 0) {
+            break;
+        }
+    }
+
+    if (index == state->project_count) {
+        state->projects = Aguilar_ArrayReserve(state->arena, state->projects, state->project_count, sizeof(daemon_project_t));
+        state->projects[state->project_count++] = (daemon_project_t){ Aguilar_Format(state->arena, "%s", dir), 0, false, true, 0 };
+    }
+
+    daemon_project_t* project = &state->projects[index];
+    u64 env_stamp = Aguilar_DaemonEnvStamp(env);
+
+    if (project->clean and project->building == 0 and project->env_stamp == env_stamp) {
+        dprintf(fds[1], "No changes, not rebuilding!\n");
+        Aguilar_DaemonReply(client, "done 0\n");
+        return false;
+    }
+
+    // NOTE(Alex): A build that is already running with another environment answers nothing
+    //              about this one.
+    if (state->job_count == DAEMON_MAX_CLIENTS or (project->building > 0 and project->env_stamp != env_stamp)) {
+        Aguilar_DaemonReply(client, "fallback\n");
+        return false;
+    }
+
+    if (project->building > 0) {
+        state->jobs[state->job_count++] = (daemon_job_t){ 0, client, index, dup(fds[1]) };
+        Aguilar_DaemonReply(client, "building\n");
+        return true;
+    }
+
+    Aguilar_DaemonWatchTree(state, dir, index, 0);
+    project->dirty = false;
+    project->env_stamp = env_stamp;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        Aguilar_DaemonReply(client, "fallback\n");
+        return false;
+    }
+
+    if (pid == 0) {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigprocmask(SIG_SETMASK, &signals, NULL);
+
+        dup2(fds[0], STDIN_FILENO);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[2], STDERR_FILENO);
+
+        clearenv();
+        for (char** var = env; *var != NULL; var++) {
+            putenv(*var);
+        }
+
+        if (chdir(dir) != 0) {
+            printf("Failed to build: Project directory is gone!\n");
+            exit(1);
+        }
+
+        // NOTE(Alex): build.sh and Makefile builds can depend on anything, never skip them,
+        //              and neither can builds that read files nobody watches.
+        bool scripted = Aguilar_FileExists("build.sh", 0) or Aguilar_FileExists("Makefile", 0) or Aguilar_ProjectHasUnwatchedInputs();
+
+        arena_t build_arena = AWN_ArenaCreate(KB(8));
+        int result = Aguilar_Build(&build_arena);
+        if (result < 0) {
+            printf("Failed to build: %s\n", Aguilar_GetError());
+        }
+
+        fflush(stdout);
+        exit(result < 0 ? 1 : (scripted ? 2 : 0));
+    }
+
+    project->building++;
+    state->jobs[state->job_count++] = (daemon_job_t){ pid, client, index, -1 };
+    Aguilar_DaemonReply(client, "building\n");
+    return true;
+}
+
+function void Aguilar_DaemonReapJobs(daemon_state_t *state)
+{
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < state->job_count; i++) {
+            daemon_job_t job = state->jobs[i];
+            if (job.pid != pid) {
+                continue;
+            }
+
+            int code = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+            daemon_project_t* project = &state->projects[job.project];
+            project->building--;
+            project->clean = code == 0 and !project->dirty and project->building == 0;
+
+            Aguilar_DaemonReply(job.client, "done %d\n", code == 2 ? 0 : code);
+            close(job.client);
+
+            state->jobs[i] = state->jobs[--state->job_count];
+
+            // NOTE(Alex): Waiters asked after the build started, so only a clean result answers
+            //              them, otherwise they build for themselves.
+            for (int w = state->job_count - 1; w >= 0; w--) {
+                daemon_job_t waiter = state->jobs[w];
+                if (waiter.pid != 0 or waiter.project != job.project) {
+                    continue;
+                }
+
+                if (project->clean) {
+                    dprintf(waiter.out_fd, "No changes, not rebuilding!\n");
+                    Aguilar_DaemonReply(waiter.client, "done 0\n");
+                } else {
+                    Aguilar_DaemonReply(waiter.client, "fallback\n");
+                }
+
+                close(waiter.out_fd);
+                close(waiter.client);
+                state->jobs[w] = state->jobs[--state->job_count];
+            }
+            break;
+        }
+    }
+}
+
+function void Aguilar_DaemonHandleClient(daemon_state_t *state, int client)
+{
+    // NOTE(Alex): Clients are served one at a time, one that connects and never sends its
+    //              request must not stall everybody else.
+    struct timeval timeout = { DAEMON_TIMEOUT_S, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    u32 length = 0;
+    int fds[3] = { -1, -1, -1 };
+    char control[CMSG_SPACE(sizeof(fds))];
+
+    struct iovec iov = { &length, sizeof(length) };
+    struct msghdr message = {0};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received = recvmsg(client, &message, MSG_CMSG_CLOEXEC);
+
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    if (header != NULL and header->cmsg_level == SOL_SOCKET and header->cmsg_type == SCM_RIGHTS and header->cmsg_len == CMSG_LEN(sizeof(fds))) {
+        memcpy(fds, CMSG_DATA(header), sizeof(fds));
+    }
+
+    bool keep_client = false;
+    char* payload = NULL;
+
+    if (received != sizeof(length) or length == 0 or length > DAEMON_MAX_REQUEST or fds[0] < 0) {
+        goto done;
+    }
+
+    payload = malloc(length + 1);
+    usize total = 0;
+    while (payload != NULL and total < length) {
+        ssize_t count = recv(client, payload + total, length - total, 0);
+        if (count <= 0) {
+            goto done;
+        }
+        total += count;
+    }
+    payload[length] = '\0';
+
+    // NOTE(Alex): Split the NUL separated strings, the environment is whatever follows the args.
+    char* strings[DAEMON_MAX_REQUEST / 64];
+    int string_count = 0;
+    for (char* cursor = payload; cursor < payload + length and string_count < (int)(sizeof(strings) / sizeof(strings[0])) - 1; cursor += strlen(cursor) + 1) {
+        strings[string_count++] = cursor;
+    }
+    strings[string_count] = NULL;
+
+    if (string_count >= 4 and strcmp(strings[0], "run") == 0) {
+        Aguilar_DaemonHandleRun(state, client, strings[2], strings[3]);
+    } else if (string_count >= 2 and strcmp(strings[0], "build") == 0) {
+        keep_client = Aguilar_DaemonHandleBuild(state, client, strings[1], &strings[2], fds);
+    } else {
+        Aguilar_DaemonReply(client, "fallback\n");
+    }
+
+done:
+    free(payload);
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    if (!keep_client) {
+        close(client);
+    }
+}
+
+function int Aguilar_Serve()
+{
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    if (!Aguilar_FormatSocketPath(address.sun_path, sizeof(address.sun_path), true)) {
+        Aguilar_SetError("Failed to create a private directory for the daemon socket!");
+        return -1;
+    }
+
+    // NOTE(Alex): A socket file nobody answers on is left over from a daemon that died.
+    unsetenv(ENV_NO_DAEMON);
+    int existing = Aguilar_DaemonConnect();
+    if (existing >= 0) {
+        close(existing);
+        Aguilar_SetError("A daemon is already running!");
+        return -1;
+    }
+    unlink(address.sun_path);
+
+    // NOTE(Alex): The socket file is created by bind, so it never exists with looser permissions.
+    mode_t old_mask = umask(S_IRWXG | S_IRWXO);
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool listening = listen_fd >= 0 and bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) == 0;
+    umask(old_mask);
+
+    if (!listening or listen(listen_fd, DAEMON_MAX_CLIENTS) != 0) {
+        Aguilar_SetError("Failed to listen on the daemon socket!");
+        return -1;
+    }
+
+    // NOTE(Alex): The daemon keeps pointers into its arena for as long as it runs, which is
+    //              fine since growing only ever adds blocks.
+    arena_t arena = AWN_ArenaCreate(MB(1));
+
+    daemon_state_t state = {0};
+    state.arena = &arena;
+    state.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (state.inotify_fd < 0) {
+        Aguilar_SetError("Failed to start watching files!");
+        return -1;
+    }
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    printf("Listening on %s\n", address.sun_path);
+    fflush(stdout);
+
+    bool running = true;
+    while (running) {
+        struct pollfd polls[3] = {
+            { listen_fd, POLLIN, 0 },
+            { state.inotify_fd, POLLIN, 0 },
+            { signal_fd, POLLIN, 0 },
+        };
+
+        if (poll(polls, 3, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // NOTE(Alex): Events first, so a request never sees state older than the edit before it.
+        if (polls[1].revents & POLLIN) {
+            Aguilar_DaemonReadEvents(&state);
+        }
+
+        if (polls[2].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                if (info.ssi_signo != SIGCHLD) {
+                    running = false;
+                }
+            }
+            Aguilar_DaemonReapJobs(&state);
+        }
+
+        if (polls[0].revents & POLLIN) {
+            int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client >= 0 and !Aguilar_PeerIsUser(client)) {
+                close(client);
+            } else if (client >= 0) {
+                Aguilar_DaemonReadEvents(&state);
+                Aguilar_DaemonHandleClient(&state, client);
+            }
+        }
+    }
+
+    unlink(address.sun_path);
+    close(listen_fd);
+    printf("Daemon stopped.\n");
+
+    return 0;
+}
+
+function int Aguilar_WriteBasicMainFile(const char* path)
+{
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) {
+        printf("At: %s, ", path);
+        Aguilar_SetError("System failed to create new file!");
+        return -1;
+    }
+
+    const char* basic_program = "int main(int argc, char** argv)\n{\n   return 0;\n}\n";
+    fwrite(basic_program, sizeof(char), strlen(basic_program), file);
+
+    fclose(file);
+
+    return 1;
+}
+
+function int Aguilar_Install(arena_t *arena)
+{
+    char cwd[128] = { 0 };
+    getcwd(cwd, 128);
+
+    char* command = AWN_ArenaPush(arena, sizeof(char) * 1024);
+
+    sprintf(command, "cp %s/Aguilar ~/.local/bin/", cwd);
+
+    int success = system(command);
+
+    if (success != 0) {
+        Aguilar_SetError("Failed to run system call!");
+        return -1;
+    }
+
+    const char* home_dir = getenv("HOME");   
+    
+    if (home_dir == NULL) {
+        Aguilar_SetError("Failed to get home directory!");
+        return -1;
+    }
+
+    char* path = AWN_ArenaPush(arena, sizeof(char) * (strlen(home_dir) + 512));
+
+    sprintf(path, "%s/.local/bin/Aguilar_data/", home_dir);
+
+    const char* fname = "main.c";
+    if (!Aguilar_FileExists(path, 0)) {
+        if (mkdir(path, S_IRWXG | S_IRWXO | S_IRWXU) != 0) {
+            Aguilar_SetError("System failed to create new directory!");
+            return -1;
+        }
+    }
+
+    strncat(path, fname, strlen(fname) + 1);
+
+    if (Aguilar_WriteBasicMainFile(path) == -1) {
+        return -1;
+    }
+
+    AWN_ArenaClear(arena);
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Benchmarks for Aguilar itself.
+//              `aguilar bench` generates projects with 1, 10, 100 and 1000 source files in a
+//              scratch directory and times this very binary on them (cold, no-op and one edit
+//              builds), plus cached runs, new/sync and concurrent runs, followed by in-process
+//              microbenchmarks of awn.h. HOME points into the scratch directory for the whole
+//              run, so every cache starts cold and the user's caches and templates are not
+//              touched. The daemon, workers and the shared cache are switched off, the numbers
+//              are for the driver alone. Results go to a JSON file for comparing between builds.
+#define BENCH_DEFAULT_SIZES "1,10,100,1000"
+#define BENCH_DEFAULT_RUNS 5
+#define BENCH_DEFAULT_OUTPUT "aguilar_bench.json"
+#define BENCH_MAX_SIZES 16
+#define BENCH_MAX_MICRO 32
+#define BENCH_CONCURRENT_CLIENTS 8
+#define BENCH_CONCURRENT_RUNS 64
+// NOTE(Alex): The benchmark script exits with this, so a run that never reached it shows up.
+#define BENCH_RUN_EXIT_CODE 7
+
+STRUCT(bench_project_t)
+{
+    int files;
+    f64 cold_ms;
+    f64 noop_ms;
+    f64 edit_ms;
+};
+
+STRUCT(bench_micro_t)
+{
+    char* name;
+    f64 ns_per_op;
+    f64 gb_per_s;
+};
+
+STRUCT(bench_t)
+{
+    char* root;
+    char self[PATH_MAX];
+    int log_fd;
+    int runs;
+
+    bench_project_t projects[BENCH_MAX_SIZES];
+    int project_count;
+
+    f64 run_cold_ms;
+    f64 run_cached_ms;
+    f64 new_ms;
+    f64 sync_ms;
+    f64 concurrent_ms;
+    int concurrent_failed;
+
+    bool profile;
+    f64 profile_cold_ms;
+    f64 profile_cached_ms;
+
+    bench_micro_t micro[BENCH_MAX_MICRO];
+    int micro_count;
+};
+
+function int Aguilar_CompareF64(const void* a, const void* b)
+{
+    f64 x = *(const f64*)a;
+    f64 y = *(const f64*)b;
+    return (x > y) - (x < y);
+}
+
+function f64 Aguilar_Median(f64* values, int count)
+{
+    qsort(values, count, sizeof(f64), Aguilar_CompareF64);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+// NOTE(Alex): option goes between the command and its argument, either may be NULL.
+function pid_t Aguilar_BenchSpawn(bench_t *bench, const char* dir, const char* command, const char* option, const char* arg)
+{
+    char* argv[5] = { "aguilar", (char*)command };
+    int argc = 2;
+    if (option != NULL) {
+        argv[argc++] = (char*)option;
     }
+    argv[argc++] = (char*)arg;
 
-    fclose(project_file);
+    fflush(stdout);
+    fflush(stderr);
 
-#undef CHECK_END
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(dir) != 0) {
+            _exit(127);
+        }
+        dup2(bench->log_fd, STDOUT_FILENO);
+        dup2(bench->log_fd, STDERR_FILENO);
+        execv(bench->self, argv);
+        _exit(127);
+    }
 
-    return args_result;
+    return pid;
 }
 
-function int Aguilar_RunBuildInstruction(arena_t *arena, char* source, char* args, char* output)
+function int Aguilar_BenchWait(pid_t pid)
 {
-    const char* compiler = Aguilar_GetCompilerEnv();
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
 
-    size_t command_length = strlen(source) + strlen(compiler) + strlen(ARG_OUTPUT);
+// NOTE(Alex): Wall time of one `aguilar command option arg` in dir, or -1 when it did not exit with expected.
+function f64 Aguilar_BenchCommand(bench_t *bench, const char* dir, const char* command, const char* option, const char* arg, int expected)
+{
+    f64 start = Aguilar_TimeMs();
+    pid_t pid = Aguilar_BenchSpawn(bench, dir, command, option, arg);
+    if (pid < 0 or Aguilar_BenchWait(pid) != expected) {
+        return -1;
+    }
+    return Aguilar_TimeMs() - start;
+}
 
-    // NOTE(Alex): Run with default options.
-    if (args == 0) {
-        args = "-Wall -g -O3";
+function int Aguilar_BenchWriteFile(const char* path, const char* contents)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        Aguilar_SetError("Failed to write a benchmark file!");
+        return -1;
     }
 
-    command_length += strlen(args);
+    fputs(contents, file);
+    fclose(file);
+    return 0;
+}
 
-    const char* output_file = "app.out";
+function char* Aguilar_BenchSource(arena_t *arena, int index, int salt)
+{
+    return Aguilar_Format(arena,
+        "#include \"bench.h\"\n"
+        "\n"
+        "int bench_%d(int x)\n"
+        "{\n"
+        "    for (int i = 0; i < 64; i++) {\n"
+        "        x = x * 31 + i + %d;\n"
+        "    }\n"
+        "    return x;\n"
+        "}\n", index, index + salt);
+}
 
-    if (output != 0) {
-        output_file = output;
+// NOTE(Alex): files - 1 function files plus a main that calls all of them through one header.
+function char* Aguilar_BenchMakeProject(bench_t *bench, arena_t *arena, int files)
+{
+    char* dir = Aguilar_Format(arena, "%s/project_%d", bench->root, files);
+    if (Aguilar_MakeDirs(Aguilar_Format(arena, "%s/src", dir)) != 0) {
+        Aguilar_SetError("Failed to create a benchmark project!");
+        return NULL;
     }
 
-    char* command = AWN_ArenaPush(arena, sizeof(char) * (command_length + 6 + strlen(output_file)));
+    char* header = NULL;
+    usize header_length = 0;
+    FILE* header_stream = open_memstream(&header, &header_length);
+    char* main_file = NULL;
+    usize main_length = 0;
+    FILE* main_stream = open_memstream(&main_file, &main_length);
 
-    sprintf(command, "%s %s -o %s %s", compiler, args, output_file, source);
+    fprintf(main_stream, "#include <stdio.h>\n#include \"bench.h\"\n\nint main(void)\n{\n    int x = 1;\n");
 
-    printf("%s\n", command);
+    int result = 0;
+    for (int i = 0; i < files - 1 and result == 0; i++) {
+        fprintf(header_stream, "int bench_%d(int x);\n", i);
+        fprintf(main_stream, "    x = bench_%d(x);\n", i);
+        result = Aguilar_BenchWriteFile(Aguilar_Format(arena, "%s/src/bench_%d.c", dir, i), Aguilar_BenchSource(arena, i, 0));
+    }
 
-    int res = system(command);
+    fprintf(main_stream, "    printf(\"%%d\\n\", x);\n    return 0;\n}\n");
+    fclose(header_stream);
+    fclose(main_stream);
 
-    return res;
+    if (result == 0) {
+        result = Aguilar_BenchWriteFile(Aguilar_Format(arena, "%s/src/bench.h", dir), header);
+    }
+    if (result == 0) {
+        result = Aguilar_BenchWriteFile(Aguilar_Format(arena, "%s/src/main.c", dir), main_file);
+    }
+    if (result == 0) {
+        result = Aguilar_BenchWriteFile(Aguilar_Format(arena, "%s/.aguilar", dir), "flags: -O1\nexe: bench; src\n");
+    }
+
+    free(header);
+    free(main_file);
+    return result == 0 ? dir : NULL;
 }
 
-function int Aguilar_Build(arena_t *arena)
+function int Aguilar_BenchProject(bench_t *bench, arena_t *arena, int files, bench_project_t *out)
 {
-    if (Aguilar_FileExists("build.sh", 0)) {
-        system("./build.sh");
-        return 1;
-    }
-
-    if (Aguilar_FileExists("Makefile", 0)) {
-        system("make");
-        return 1;
-    }
+    out->files = files;
 
-    if (!Aguilar_FileExists("src", 0)) {
-        Aguilar_SetError("No src directory found, cannot run!");
+    char* dir = Aguilar_BenchMakeProject(bench, arena, files);
+    if (dir == NULL) {
         return -1;
     }
 
-    DIR *src_dir = opendir("src");
-
-    if (src_dir == NULL) {
-        Aguilar_SetError("Could not open the source directory!");
+    out->cold_ms = Aguilar_BenchCommand(bench, dir, "build", NULL, NULL, 0);
+    if (out->cold_ms < 0 or !Aguilar_FileExists(Aguilar_Format(arena, "%s/bench", dir), 0)) {
+        Aguilar_SetError("Benchmark project failed to build, see the log in the benchmark directory!");
         return -1;
     }
 
-    struct dirent *entry;
+    f64* samples = AWN_ArenaPush(arena, sizeof(f64) * bench->runs);
+    for (int r = 0; r < bench->runs; r++) {
+        samples[r] = Aguilar_BenchCommand(bench, dir, "build", NULL, NULL, 0);
+    }
+    out->noop_ms = Aguilar_Median(samples, bench->runs);
 
-    char* path = AWN_ArenaPush(arena, 1);
+    // NOTE(Alex): A real edit every time, the content changes and so does the mtime.
+    for (int r = 0; r < bench->runs; r++) {
+        char* path = files > 1 ? Aguilar_Format(arena, "%s/src/bench_0.c", dir) : Aguilar_Format(arena, "%s/src/main.c", dir);
+        char* source = files > 1
+            ? Aguilar_BenchSource(arena, 0, r + 1)
+            : Aguilar_Format(arena, "#include <stdio.h>\n\nint main(void)\n{\n    printf(\"%d\\n\", %d);\n    return 0;\n}\n", r + 1);
 
-    bool entry_found = false;
+        if (Aguilar_BenchWriteFile(path, source) != 0) {
+            return -1;
+        }
+        samples[r] = Aguilar_BenchCommand(bench, dir, "build", NULL, NULL, 0);
+    }
+    out->edit_ms = Aguilar_Median(samples, bench->runs);
 
-    while ((entry = readdir(src_dir)) != NULL and !entry_found) {
-        path = AWN_ArenaResize(arena, path, (arena->pos - arena->pos_prev), sizeof(char) * (strlen("src/") + sizeof(entry->d_name)));
+    printf("%8d %12.1f %12.2f %12.1f\n", files, out->cold_ms, out->noop_ms, out->edit_ms);
+    return 0;
+}
 
-        sprintf(path, "src/%s", entry->d_name);
+function int Aguilar_BenchDriver(bench_t *bench, arena_t *arena)
+{
+    char* dir = Aguilar_Format(arena, "%s/scripts", bench->root);
+    if (Aguilar_MakeDirs(dir) != 0) {
+        Aguilar_SetError("Failed to create the benchmark script directory!");
+        return -1;
+    }
 
-        FILE *file = fopen(path, "r");
+    char* script = Aguilar_Format(arena, "int main(void)\n{\n    return %d;\n}\n", BENCH_RUN_EXIT_CODE);
+    if (Aguilar_BenchWriteFile(Aguilar_Format(arena, "%s/bench_run.c", dir), script) != 0) {
+        return -1;
+    }
 
-        if (file != NULL) {
-            char buff[1024];
+    bench->run_cold_ms = Aguilar_BenchCommand(bench, dir, "run", NULL, "bench_run.c", BENCH_RUN_EXIT_CODE);
 
-            // TODO(Alex): There has to be a better way to do this.
-            while (fgets(buff, sizeof(buff), file) != NULL) {
-                if (strncmp(buff, "int main(", 9) == 0) {
-                    entry_found = true;
-                }
+    f64* samples = AWN_ArenaPush(arena, sizeof(f64) * bench->runs);
+    for (int r = 0; r < bench->runs; r++) {
+        samples[r] = Aguilar_BenchCommand(bench, dir, "run", NULL, "bench_run.c", BENCH_RUN_EXIT_CODE);
+    }
+    bench->run_cached_ms = Aguilar_Median(samples, bench->runs);
+
+    // NOTE(Alex): A fixed number of runs with a fixed number in flight, started as others finish.
+    f64 start = Aguilar_TimeMs();
+    int started = 0;
+    int running = 0;
+    bench->concurrent_failed = 0;
+
+    while (started < BENCH_CONCURRENT_RUNS or running > 0) {
+        while (started < BENCH_CONCURRENT_RUNS and running < BENCH_CONCURRENT_CLIENTS) {
+            if (Aguilar_BenchSpawn(bench, dir, "run", NULL, "bench_run.c") < 0) {
+                bench->concurrent_failed++;
+            } else {
+                running++;
             }
+            started++;
         }
-        
-        fclose(file);
-    }
 
-    char cwd[128];
-    getcwd(cwd, 128);
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
 
-    int offset = 0;
-    for (int i = 0; i < strlen(cwd); i++) {
-        if (cwd[i] == '/') {
-            offset = i + 1;
+        running--;
+        if (!WIFEXITED(status) or WEXITSTATUS(status) != BENCH_RUN_EXIT_CODE) {
+            bench->concurrent_failed++;
         }
     }
+    bench->concurrent_ms = Aguilar_TimeMs() - start;
 
-    char* out = AWN_ArenaPush(arena, sizeof(char) * (strlen(cwd) - offset + 1));
-
-    memcpy(out, (cwd + offset), (strlen(cwd) - offset) );
-    out[strlen(cwd) - offset] = '\0';
+    bench->new_ms = Aguilar_BenchCommand(bench, bench->root, "new", NULL, "bench_new", 0);
 
-    char* args = Aguilar_ReadProjectFile(arena);
-    if (args != 0) {
-        Aguilar_RunBuildInstruction(arena, path, args, out);
-    } else {
-        Aguilar_RunBuildInstruction(arena, path, 0, out);
+    char* new_dir = Aguilar_Format(arena, "%s/bench_new", bench->root);
+    for (int r = 0; r < bench->runs; r++) {
+        samples[r] = Aguilar_BenchCommand(bench, new_dir, "sync", NULL, NULL, 0);
     }
+    bench->sync_ms = Aguilar_Median(samples, bench->runs);
 
-    closedir(src_dir);
-
-    AWN_ArenaClear(arena);
-
-    return 1;
-}
+    printf("run: %.1f ms cold, %.2f ms cached\n", bench->run_cold_ms, bench->run_cached_ms);
+    printf("concurrent run: %d runs, %d at a time, %.1f runs/s (%d failed)\n", BENCH_CONCURRENT_RUNS, BENCH_CONCURRENT_CLIENTS,
+            BENCH_CONCURRENT_RUNS * 1000.0 / bench->concurrent_ms, bench->concurrent_failed);
+    printf("new: %.2f ms, sync: %.2f ms\n", bench->new_ms, bench->sync_ms);
 
-function char* Aguilar_FormatCacheSettingsPath(arena_t *arena)
-{
-    const char* home = getenv("HOME");
-    if (home == NULL) {
-        Aguilar_SetError("Failed to get home directory!");
-        return NULL;
+    if (bench->run_cold_ms < 0 or bench->run_cached_ms < 0) {
+        Aguilar_SetError("Benchmark script failed to run, see the log in the benchmark directory!");
+        return -1;
     }
 
-    char* config_path = AWN_ArenaPush(arena, sizeof(char) * (strlen(CACHE_CONFIG_PATH) + strlen(home)));
-    sprintf(config_path, "%s%s", home, CACHE_CONFIG_PATH);
-
-    return config_path;
+    return 0;
 }
 
-function int Aguilar_WriteCacheSettings(arena_t *arena, const char* file, u64 mod_time)
+// NOTE(Alex): `run --profile` on a script that keeps the CPU busy, so the cost of building with
+//              the runtime and sampling shows up next to a plain run. The folded stacks are left
+//              next to the script (see --keep).
+function int Aguilar_BenchProfile(bench_t *bench, arena_t *arena)
 {
-    const char* config_path = Aguilar_FormatCacheSettingsPath(arena);
-    if (config_path == NULL) {
-        return -1;
-    }
-
-    FILE* settings_file = fopen(config_path, "w+");
-    if (settings_file == NULL) {
-        Aguilar_SetError("Failed to write cache settings file!");
+    char* dir = Aguilar_Format(arena, "%s/scripts", bench->root);
+    const char* script =
+        "static volatile unsigned long sink;\n"
+        "\n"
+        "static unsigned long work(unsigned long n)\n"
+        "{\n"
+        "    unsigned long x = n;\n"
+        "    for (unsigned long i = 0; i < n; i++) {\n"
+        "        x = x * 6364136223846793005UL + i;\n"
+        "    }\n"
+        "    return x;\n"
+        "}\n"
+        "\n"
+        "int main(void)\n"
+        "{\n"
+        "    for (int i = 0; i < 20; i++) {\n"
+        "        sink += work(5000000);\n"
+        "    }\n"
+        "    return 0;\n"
+        "}\n";
+
+    if (Aguilar_BenchWriteFile(Aguilar_Format(arena, "%s/bench_profile.c", dir), script) != 0) {
         return -1;
     }
 
-    fwrite(file, sizeof(char), strlen(file), settings_file);
-    fwrite("\n", sizeof(char), 1, settings_file);
+    bench->profile_cold_ms = Aguilar_BenchCommand(bench, dir, "run", "--profile", "bench_profile.c", 0);
 
-    char* mod_str = AWN_ArenaPush(arena, sizeof(char) * 512);
-
-    snprintf(mod_str, sizeof(char) * 512, "%lu", mod_time);
+    f64* samples = AWN_ArenaPush(arena, sizeof(f64) * bench->runs);
+    for (int r = 0; r < bench->runs; r++) {
+        samples[r] = Aguilar_BenchCommand(bench, dir, "run", "--profile", "bench_profile.c", 0);
+    }
+    bench->profile_cached_ms = Aguilar_Median(samples, bench->runs);
 
-    fwrite(mod_str, sizeof(char), strlen(mod_str), settings_file);
+    printf("run --profile: %.1f ms cold, %.2f ms cached\n", bench->profile_cold_ms, bench->profile_cached_ms);
 
-    fclose(settings_file);
+    if (bench->profile_cold_ms < 0 or bench->profile_cached_ms < 0) {
+        Aguilar_SetError("Profiled benchmark script failed to run, see the log in the benchmark directory!");
+        return -1;
+    }
 
     return 0;
 }
 
-function int Aguilar_ReadCacheSettings(arena_t *arena, char** file, u64* mod_time, size_t string_max)
+function void Aguilar_BenchRecord(bench_t *bench, arena_t *arena, const char* name, f64 total_ms, u64 ops, u64 bytes)
 {
-    const char* config_path = Aguilar_FormatCacheSettingsPath(arena);
-    if (config_path == NULL) {
-        *file = "";
-        *mod_time = 0;
-        return -1;
+    if (bench->micro_count >= BENCH_MAX_MICRO) {
+        return;
     }
 
-    FILE* settings_file = fopen(config_path, "r");
-    if (settings_file == NULL) {
-        *file = "";
-        *mod_time = 0;
-        return 0;
+    bench_micro_t* micro = &bench->micro[bench->micro_count++];
+    micro->name = Aguilar_Format(arena, "%s", name);
+    micro->ns_per_op = total_ms * 1000000.0 / (f64)ops;
+    micro->gb_per_s = bytes > 0 ? (f64)bytes / (total_ms * 1000000.0) : 0;
+
+    if (micro->gb_per_s > 0) {
+        printf("%-28s %10.2f ns/op %8.2f GB/s\n", name, micro->ns_per_op, micro->gb_per_s);
+    } else {
+        printf("%-28s %10.2f ns/op\n", name, micro->ns_per_op);
     }
+}
 
-    const int file_buffer_size = sizeof(char) * string_max;
+global volatile usize bench_sink;
 
-    if (*file == 0) {
-        *file = AWN_ArenaPush(arena, file_buffer_size);
-    }
+#define BENCH_QUEUE_THREADS 4
 
-    // TODO(Alex): At the moment we are assuming that the settings file 
-    //              has been written in a specific order defined 
-    //              in the write function.
-    char line[string_max];
-    fgets(line, string_max, settings_file);
+STRUCT(bench_queue_thread_t)
+{
+    pthread_t thread;
+    void* queue;
+    bool mpmc;
+    bool producer;
+    u64 count;
+    u64 sum;
+};
+
+// NOTE(Alex): A full or empty queue yields rather than spins, so the numbers stay meaningful on
+//              machines with fewer cores than threads.
+function void* Aguilar_BenchQueueThread(void* data)
+{
+    bench_queue_thread_t* thread = data;
 
-    if (line[strlen(line) - 1] == '\n') {
-        line[strlen(line) - 1] = '\0';
-        strncpy(*file, line, file_buffer_size - strlen(*file) - 1);
-    } else {
-        strncpy(*file, line, file_buffer_size - strlen(*file) - 1);
+    for (u64 i = 0; i < thread->count; i++) {
+        u64 value = i;
+        if (thread->producer) {
+            while (!(thread->mpmc ? AWN_MpmcPush(thread->queue, &value) : AWN_SpscPush(thread->queue, &value))) {
+                sched_yield();
+            }
+        } else {
+            while (!(thread->mpmc ? AWN_MpmcPop(thread->queue, &value) : AWN_SpscPop(thread->queue, &value))) {
+                sched_yield();
+            }
+            thread->sum += value;
+        }
     }
 
-    fgets(line, string_max, settings_file);
+    return NULL;
+}
+
+// NOTE(Alex): Moves ops elements from producers to consumers, each on its own thread, and
+//              returns the wall time in milliseconds.
+function f64 Aguilar_BenchQueueThreaded(void* queue, bool mpmc, int producers, int consumers, u64 ops)
+{
+    bench_queue_thread_t threads[BENCH_QUEUE_THREADS * 2] = {0};
+    int count = producers + consumers;
+
+    f64 start = Aguilar_TimeMs();
+    for (int i = 0; i < count; i++) {
+        threads[i].queue = queue;
+        threads[i].mpmc = mpmc;
+        threads[i].producer = i < producers;
+        threads[i].count = ops / (u64)(threads[i].producer ? producers : consumers);
+        pthread_create(&threads[i].thread, NULL, Aguilar_BenchQueueThread, &threads[i]);
+    }
 
-    *mod_time = strtoul(line, 0, 0);
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i].thread, NULL);
+        bench_sink += threads[i].sum;
+    }
 
-    return 0;
+    return Aguilar_TimeMs() - start;
 }
 
-function int Aguilar_Run(arena_t *arena, char* file, char* arg)
+function void Aguilar_BenchMicro(bench_t *bench, arena_t *arena)
 {
-    struct stat sb;
-    if (!Aguilar_FileExists(file, &sb)) {
-        Aguilar_SetError("File does not exist!");
-        return -1;
+    arena_t scratch = AWN_ArenaCreate(MB(64));
+    scratch.auto_grow = false;
+
+    const usize push_sizes[] = { 16, 64, 256 };
+    for (int s = 0; s < (int)AWN_ArrayCount(push_sizes); s++) {
+        u64 ops = 0;
+        f64 start = Aguilar_TimeMs();
+        for (int round = 0; round < 8; round++) {
+            AWN_ArenaClear(&scratch);
+            while (scratch.pos + push_sizes[s] + AWN_ARENA_DEFAULT_ALIGNMENT <= scratch.cap) {
+                bench_sink += (usize)AWN_ArenaPush(&scratch, push_sizes[s]);
+                ops++;
+            }
+        }
+        char* name = Aguilar_Format(arena, "arena_push_%zu", push_sizes[s]);
+        Aguilar_BenchRecord(bench, arena, name, Aguilar_TimeMs() - start, ops, ops * push_sizes[s]);
     }
 
-    char* f = AWN_ArenaPush(arena, sizeof(char) * 1024);
-    u64 m = 0;
-    if (Aguilar_ReadCacheSettings(arena, &f, &m, 1024) != 0) {
-        return -1;
+    // NOTE(Alex): Growing the last allocation in place, the common case for arena arrays.
+    {
+        u64 ops = 0;
+        f64 start = Aguilar_TimeMs();
+        for (int round = 0; round < 20000; round++) {
+            AWN_ArenaClear(&scratch);
+            usize size = 16;
+            void* data = AWN_ArenaPush(&scratch, size);
+            for (; size < KB(4); size += 16, ops++) {
+                data = AWN_ArenaResize(&scratch, data, size, size + 16);
+            }
+            bench_sink += (usize)data;
+        }
+        Aguilar_BenchRecord(bench, arena, "arena_resize_last", Aguilar_TimeMs() - start, ops, 0);
     }
 
-    if (strcmp(f, file) != 0 or m != sb.st_mtime) {
-        int ret = Aguilar_RunBuildInstruction(arena, file, arg, CACHE_OUT_PATH);
+    {
+        u64 ops = 0;
+        f64 start = Aguilar_TimeMs();
+        for (int round = 0; round < 4; round++) {
+            arena_t growing = AWN_ArenaCreate(KB(4));
+            for (usize pushed = 0; pushed < MB(64); pushed += 64) {
+                bench_sink += (usize)AWN_ArenaPush(&growing, 64);
+                ops++;
+            }
+            AWN_ArenaFree(growing);
+        }
+        Aguilar_BenchRecord(bench, arena, "arena_push_growing_64", Aguilar_TimeMs() - start, ops, ops * 64);
+    }
 
-        if (ret != 0) {
-            Aguilar_SetError("Compiler encountered an error!");
-            return -1;
+    {
+        AWN_ArenaClear(&scratch);
+        spsc_queue_t spsc;
+        mpmc_queue_t mpmc;
+        AWN_SpscInitFromArena(&spsc, &scratch, sizeof(u64), 1024);
+        AWN_MpmcInitFromArena(&mpmc, &scratch, sizeof(u64), 1024);
+
+        const u64 ops = 4000000;
+        u64 value = 0;
+        f64 start = Aguilar_TimeMs();
+        for (u64 i = 0; i < ops; i++) {
+            AWN_SpscPush(&spsc, &i);
+            AWN_SpscPop(&spsc, &value);
         }
+        Aguilar_BenchRecord(bench, arena, "spsc_push_pop", Aguilar_TimeMs() - start, ops, 0);
 
-        if (Aguilar_WriteCacheSettings(arena, file, sb.st_mtime) != 0) {
-            return -1;
+        start = Aguilar_TimeMs();
+        for (u64 i = 0; i < ops; i++) {
+            AWN_MpmcPush(&mpmc, &i);
+            AWN_MpmcPop(&mpmc, &value);
         }
-    } else {
-        printf("No changes, not recompiling!\n");
+        Aguilar_BenchRecord(bench, arena, "mpmc_push_pop", Aguilar_TimeMs() - start, ops, 0);
+        bench_sink += value;
+
+        // NOTE(Alex): The same queues across threads, where the cache line traffic shows up.
+        f64 total_ms = Aguilar_BenchQueueThreaded(&spsc, false, 1, 1, ops);
+        Aguilar_BenchRecord(bench, arena, "spsc_threaded_1x1", total_ms, ops, 0);
+
+        total_ms = Aguilar_BenchQueueThreaded(&mpmc, true, BENCH_QUEUE_THREADS, BENCH_QUEUE_THREADS, ops);
+        char* name = Aguilar_Format(arena, "mpmc_threaded_%dx%d", BENCH_QUEUE_THREADS, BENCH_QUEUE_THREADS);
+        Aguilar_BenchRecord(bench, arena, name, total_ms, ops, 0);
     }
 
-    system(CACHE_OUT_PATH);
+    // NOTE(Alex): Every SIMD level this machine has, so the scalar baseline is in the same file.
+    {
+        AWN_ArenaClear(&scratch);
+        const usize float_count = 1 << 20;
+        const usize byte_count = MB(16);
+        f32* floats = AWN_ArenaPush(&scratch, float_count * sizeof(f32));
+        u8* bytes = AWN_ArenaPush(&scratch, byte_count);
+        for (usize i = 0; i < float_count; i++) {
+            floats[i] = (f32)(i & 255);
+        }
+        for (usize i = 0; i < byte_count; i++) {
+            bytes[i] = (u8)(i * 7);
+        }
+
+        simd_level_t best = AWN_SimdLevel();
+        for (int level = AWN_SIMD_SCALAR; level <= (int)best; level++) {
+            AWN_SimdSetLevel((simd_level_t)level);
+            const int rounds = 32;
 
-    AWN_ArenaClear(arena);
+            f64 start = Aguilar_TimeMs();
+            f32 sum = 0;
+            for (int r = 0; r < rounds; r++) {
+                sum += AWN_SumF32(floats, float_count);
+            }
+            char* name = Aguilar_Format(arena, "simd_sum_f32_%s", AWN_SimdLevelName((simd_level_t)level));
+            Aguilar_BenchRecord(bench, arena, name, Aguilar_TimeMs() - start, rounds, (u64)rounds * float_count * sizeof(f32));
 
-    return 1;
+            start = Aguilar_TimeMs();
+            usize count = 0;
+            for (int r = 0; r < rounds; r++) {
+                count += AWN_CountByte(bytes, byte_count, (u8)r);
+            }
+            name = Aguilar_Format(arena, "simd_count_byte_%s", AWN_SimdLevelName((simd_level_t)level));
+            Aguilar_BenchRecord(bench, arena, name, Aguilar_TimeMs() - start, rounds, (u64)rounds * byte_count);
+
+            bench_sink += (usize)sum + count;
+        }
+        AWN_SimdSetLevel(best);
+    }
+
+    AWN_ArenaFree(scratch);
 }
 
-function int Aguilar_WriteBasicMainFile(const char* path)
+function int Aguilar_BenchWriteJson(bench_t *bench, const char* path)
 {
-    FILE *file = fopen(path, "w");
-
+    FILE* file = fopen(path, "w");
     if (file == NULL) {
-        printf("At: %s, ", path);
-        Aguilar_SetError("System failed to create new file!");
+        Aguilar_SetError("Failed to write the benchmark results!");
         return -1;
     }
 
-    const char* basic_program = "int main(int argc, char** argv)\n{\n   return 0;\n}\n";
-    fwrite(basic_program, sizeof(char), strlen(basic_program), file);
+    fprintf(file, "{\n");
+    fprintf(file, "  \"version\": \"%s\",\n", AGUILAR_VERSION);
+    fprintf(file, "  \"compiler\": \"%s\",\n", Aguilar_GetCompilerEnv());
+    fprintf(file, "  \"jobs\": %d,\n", Aguilar_GetJobCount());
+    fprintf(file, "  \"runs\": %d,\n", bench->runs);
+    fprintf(file, "  \"simd\": \"%s\",\n", AWN_SimdLevelName(AWN_SimdLevel()));
+
+    fprintf(file, "  \"projects\": [");
+    for (int i = 0; i < bench->project_count; i++) {
+        bench_project_t* project = &bench->projects[i];
+        fprintf(file, "%s\n    { \"files\": %d, \"cold_build_ms\": %.3f, \"noop_build_ms\": %.3f, \"edit_build_ms\": %.3f }",
+                i > 0 ? "," : "", project->files, project->cold_ms, project->noop_ms, project->edit_ms);
+    }
+    fprintf(file, "%s],\n", bench->project_count > 0 ? "\n  " : "");
+
+    if (bench->concurrent_ms > 0) {
+        fprintf(file, "  \"run\": { \"cold_ms\": %.3f, \"cached_ms\": %.3f },\n", bench->run_cold_ms, bench->run_cached_ms);
+        fprintf(file, "  \"new_ms\": %.3f,\n", bench->new_ms);
+        fprintf(file, "  \"sync_ms\": %.3f,\n", bench->sync_ms);
+        fprintf(file, "  \"concurrent_run\": { \"clients\": %d, \"runs\": %d, \"failed\": %d, \"total_ms\": %.3f, \"runs_per_s\": %.3f },\n",
+                BENCH_CONCURRENT_CLIENTS, BENCH_CONCURRENT_RUNS, bench->concurrent_failed, bench->concurrent_ms,
+                BENCH_CONCURRENT_RUNS * 1000.0 / bench->concurrent_ms);
+    }
 
-    fclose(file);
+    if (bench->profile) {
+        fprintf(file, "  \"run_profile\": { \"cold_ms\": %.3f, \"cached_ms\": %.3f },\n", bench->profile_cold_ms, bench->profile_cached_ms);
+    }
 
-    return 1;
+    fprintf(file, "  \"micro\": [");
+    for (int i = 0; i < bench->micro_count; i++) {
+        bench_micro_t* micro = &bench->micro[i];
+        fprintf(file, "%s\n    { \"name\": \"%s\", \"ns_per_op\": %.4f", i > 0 ? "," : "", micro->name, micro->ns_per_op);
+        if (micro->gb_per_s > 0) {
+            fprintf(file, ", \"gb_per_s\": %.4f", micro->gb_per_s);
+        }
+        fprintf(file, " }");
+    }
+    fprintf(file, "%s]\n}\n", bench->micro_count > 0 ? "\n  " : "");
+
+    fclose(file);
+    return 0;
 }
 
-function int Aguilar_Install(arena_t *arena)
+function int Aguilar_Bench(arena_t *arena, int argc, char** argv)
 {
-    char cwd[128] = { 0 };
-    getcwd(cwd, 128);
-
-    char* command = AWN_ArenaPush(arena, sizeof(char) * 1024);
+    const char* sizes = BENCH_DEFAULT_SIZES;
+    const char* output = BENCH_DEFAULT_OUTPUT;
+    bool micro_only = false;
+    bool keep = false;
+
+    bench_t* bench = AWN_ArenaPush(arena, sizeof(bench_t));
+    bench->runs = BENCH_DEFAULT_RUNS;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--sizes") == 0 and i + 1 < argc) {
+            sizes = argv[++i];
+        } else if (strcmp(argv[i], "--runs") == 0 and i + 1 < argc) {
+            bench->runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 and i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--micro") == 0) {
+            micro_only = true;
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            bench->profile = true;
+        } else {
+            Aguilar_SetError("Unknown bench option, see help!");
+            return -1;
+        }
+    }
 
-    sprintf(command, "cp %s/Aguilar ~/.local/bin/", cwd);
+    if (bench->runs <= 0) {
+        bench->runs = 1;
+    }
 
-    int success = system(command);
+    int result = 0;
 
-    if (success != 0) {
-        Aguilar_SetError("Failed to run system call!");
-        return -1;
-    }
+    if (!micro_only) {
+        ssize_t length = readlink("/proc/self/exe", bench->self, sizeof(bench->self) - 1);
+        if (length <= 0) {
+            Aguilar_SetError("Failed to find the aguilar binary!");
+            return -1;
+        }
+        bench->self[length] = '\0';
 
-    const char* home_dir = getenv("HOME");   
-    
-    if (home_dir == NULL) {
-        Aguilar_SetError("Failed to get home directory!");
-        return -1;
-    }
+        const char* tmp = getenv("TMPDIR");
+        bench->root = Aguilar_Format(arena, "%s/aguilar-bench-XXXXXX", tmp != NULL ? tmp : "/tmp");
+        if (mkdtemp(bench->root) == NULL) {
+            Aguilar_SetError("Failed to create the benchmark directory!");
+            return -1;
+        }
 
-    char* path = AWN_ArenaPush(arena, sizeof(char) * (strlen(home_dir) + 512));
+        // NOTE(Alex): A template for new/sync, everything else under this HOME starts out empty.
+        char* home = Aguilar_Format(arena, "%s/home", bench->root);
+        char* data_path = Aguilar_Format(arena, "%s%s", home, TEMPLATE_DATA_PATH);
+        if (Aguilar_MakeDirs(data_path) != 0
+                or Aguilar_WriteBasicMainFile(Aguilar_Format(arena, "%s/%s", data_path, TEMPLATE_MAIN_FILE)) < 0
+                or Aguilar_BenchWriteFile(Aguilar_Format(arena, "%s/bench_template.h", data_path), "#pragma once\n") != 0) {
+            Aguilar_SetError("Failed to create the benchmark templates!");
+            return -1;
+        }
 
-    sprintf(path, "%s/.local/bin/Aguilar_data/", home_dir);
+        setenv("HOME", home, 1);
+        setenv(ENV_NO_DAEMON, "1", 1);
+        unsetenv(ENV_WORKERS);
+        unsetenv(ENV_CACHE_DIR);
 
-    const char* fname = "main.c";
-    if (!Aguilar_FileExists(path, 0)) {
-        if (mkdir(path, S_IRWXG | S_IRWXO | S_IRWXU) != 0) {
-            Aguilar_SetError("System failed to create new directory!");
+        char* log_path = Aguilar_Format(arena, "%s/bench.log", bench->root);
+        bench->log_fd = open(log_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (bench->log_fd < 0) {
+            Aguilar_SetError("Failed to create the benchmark log!");
             return -1;
         }
+
+        printf("Benchmarking %s in %s (%d runs each).\n\n", bench->self, bench->root, bench->runs);
+        printf("%8s %12s %12s %12s\n", "files", "cold ms", "no-op ms", "edit ms");
+
+        char* list = Aguilar_Format(arena, "%s", sizes);
+        char* saveptr = NULL;
+        for (char* token = strtok_r(list, ",", &saveptr); token != NULL and result == 0; token = strtok_r(NULL, ",", &saveptr)) {
+            int files = atoi(token);
+            if (files <= 0 or bench->project_count >= BENCH_MAX_SIZES) {
+                continue;
+            }
+            result = Aguilar_BenchProject(bench, arena, files, &bench->projects[bench->project_count++]);
+        }
+
+        printf("\n");
+        if (result == 0) {
+            result = Aguilar_BenchDriver(bench, arena);
+        }
+        if (result == 0 and bench->profile) {
+            result = Aguilar_BenchProfile(bench, arena);
+        }
+        printf("\n");
+
+        close(bench->log_fd);
     }
 
-    strncat(path, fname, strlen(fname) + 1);
+    if (result == 0) {
+        Aguilar_BenchMicro(bench, arena);
+        result = Aguilar_BenchWriteJson(bench, output);
+    }
 
-    if (Aguilar_WriteBasicMainFile(path) == -1) {
-        return -1;
+    if (result == 0) {
+        printf("\nResults written to %s.\n", output);
     }
 
-    AWN_ArenaClear(arena);
+    // NOTE(Alex): A failed run keeps its directory for the log.
+    if (bench->root != NULL and result == 0 and !keep) {
+        Aguilar_RemoveTree(bench->root);
+    }
 
-    return 1;
+    return result;
 }
 
 function void Aguilar_Help()
@@ -585,8 +7343,13 @@ function void Aguilar_Help()
     printf("    - new [name]: Create a new project based on a predefined template.\n");
     printf("    - build (file): Build either a file or a project based on whether it can find a config file.\n");
     printf("    - sync: Update an existing repository with any changes made to template files.\n");
-    printf("    - run [file]: Build a single file (application is stored in a cache) and run it.\n");
+    printf("    - serve: Keep a per-user daemon running that answers warm runs and no-op builds over a Unix socket.\n");
+    printf("    - run (--profile|--mem) [file]: Build a single file (application is stored in a cache) and run it, optionally under a sampling profiler or memory report.\n");
     printf("    - install: Install the application in the user's bin folder.\n");
+    printf("    - test [filter] (--jobs N) (--shard I/N) (--slow MS) (--timeout MS) (--list): Build and run every test_ function in parallel.\n");
+    printf("    - cache [stats|gc|clear]: Inspect or trim the shared compile cache (" ENV_CACHE_DIR ").\n");
+    printf("    - worker (port) (address): Compile preprocessed sources sent by builds with " ENV_WORKERS " set.\n");
+    printf("    - bench (--sizes 1,10,100,1000) (--runs N) (--out FILE) (--micro) (--keep) (--profile): Benchmark Aguilar on generated projects and write the results as JSON.\n");
     printf("    - help: Print everything you need to know.\n");
     printf("    - zen: Print a zen of code.\n");
 }
@@ -630,39 +7393,104 @@ int main(int argc, char** argv)
 
     arena_t arena = AWN_ArenaCreate(KB(8));
 
+    // NOTE(Alex): Scripts and CI only see the exit code, so every failed command sets it.
+    int result = 0;
+
     switch (argv[1][0])
     {
         case 'n': {
             if (argc > 2 and strlen(argv[2]) > 0) {
                 if (Aguilar_NewProject(&arena, argv[2]) < 0) {
                     printf("Failed to create new project: %s\n", Aguilar_GetError());
+                    result = 1;
                 }
             }
         } break;
         case 'b': {
+            if (strcmp(argv[1], "bench") == 0) {
+                if (Aguilar_Bench(&arena, argc - 2, argv + 2) < 0) {
+                    printf("Failed to benchmark: %s\n", Aguilar_GetError());
+                    result = 1;
+                }
+                break;
+            }
+
+            int code = 0;
+            if (Aguilar_DaemonBuild(&code)) {
+                return code;
+            }
+
             if (Aguilar_Build(&arena) < 0) {
                 printf("Failed to build: %s\n", Aguilar_GetError());
+                result = 1;
             }
         } break;
         case 's': {
-            if (Aguilar_SyncProject(&arena) < 0) {
+            if (strcmp(argv[1], "serve") == 0) {
+                if (Aguilar_Serve() < 0) {
+                    printf("Failed to serve: %s\n", Aguilar_GetError());
+                    result = 1;
+                }
+            } else if (Aguilar_SyncProject(&arena) < 0) {
                 printf("Failed to sync: %s\n", Aguilar_GetError());
+                result = 1;
             }
         } break;
         case 'r': {
-            if (argc > 2 and strlen(argv[2]) > 0) {
-                char* arg = Aguilar_MergeArgs(&arena, argv, 3, argc);
+            run_mode_t mode = RUN_NORMAL;
+            int file_index = 2;
+
+            if (argc > 2 and strcmp(argv[2], "--profile") == 0) {
+                mode = RUN_PROFILE;
+                file_index++;
+            } else if (argc > 2 and strcmp(argv[2], "--mem") == 0) {
+                mode = RUN_MEM;
+                file_index++;
+            }
+
+            if (argc > file_index and strlen(argv[file_index]) > 0) {
+                char* arg = Aguilar_MergeArgs(&arena, argv, file_index + 1, argc);
+
+                // NOTE(Alex): Only returns when the daemon is absent or the entry is not warm.
+                //              With TCC there is no cache entry to ask about.
+                if (mode == RUN_NORMAL and !Aguilar_CompilerIsTcc()) {
+                    Aguilar_DaemonRun(&arena, argv[file_index], arg);
+                }
 
-                if (Aguilar_Run(&arena, argv[2], arg) < 0) {
+                if (Aguilar_Run(&arena, argv[file_index], arg, mode) < 0) {
                     printf("Failed to run: %s\n", Aguilar_GetError());
+                    result = 1;
                 }
             } else {
                 printf("Need to specify file to run!\n");
+                result = 1;
             }
         } break;
         case 'i': { 
             if (Aguilar_Install(&arena) < 0) {
                 printf("Failed to install: %s\n", Aguilar_GetError());
+                result = 1;
+            }
+        } break;
+        case 'c': {
+            if (Aguilar_Cache(&arena, argc > 2 ? argv[2] : NULL) < 0) {
+                printf("Failed to run cache command: %s\n", Aguilar_GetError());
+                result = 1;
+            }
+        } break;
+        case 't': {
+            if (Aguilar_Test(&arena, argc - 2, argv + 2) < 0) {
+                printf("Failed to test: %s\n", Aguilar_GetError());
+                result = 1;
+            }
+        } break;
+        case 'w': {
+            const char* port = argc > 2 ? argv[2] : WORKER_DEFAULT_PORT;
+            const char* bind_address = argc > 3 ? argv[3] : WORKER_DEFAULT_BIND;
+
+            if (Aguilar_Worker(&arena, port, bind_address) < 0) {
+                printf("Failed to start worker: %s\n", Aguilar_GetError());
+                result = 1;
             }
         } break;
         case 'z': Aguilar_Zen(); break;
@@ -670,4 +7498,5 @@ int main(int argc, char** argv)
     }
 
     AWN_ArenaFree(arena);
+    return result;
 }
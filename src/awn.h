@@ -55,6 +55,9 @@ typedef union _##name name
 typedef union _##name name;\
 union _##name
 
+// NOTE(Alex): C++ only forward declares enums with a fixed underlying type.
+#ifndef __cplusplus
+
 #define NEED_ENUM(name)\
 typedef enum _##name name
 
@@ -62,6 +65,19 @@ typedef enum _##name name
 typedef enum _##name name;\
 enum _##name
 
+#else
+
+#define NEED_ENUM(name)\
+enum _##name : int;\
+typedef _##name name
+
+#define ENUM(name)\
+enum _##name : int;\
+typedef _##name name;\
+enum _##name : int
+
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // NOTE(Alex): Macros that make grepping easier.
 
@@ -229,6 +245,20 @@ DefineOptional(f64);
 // NOTE(Alex): Arena type (https://www.gingerbill.org/article/2019/02/08/memory-allocation-strategies-002)
 // TODO(Alex): Should Arena work with Optionals?
 
+// NOTE(Alex): Growing never moves memory. A full arena starts a new, larger block, and the
+//              start of that block remembers the one before it. Every pointer the arena handed
+//              out stays valid until the arena is cleared, restored to before it, or freed.
+NEED_STRUCT(arena_block_t);
+
+struct _arena_block_t
+{
+    u8 *buffer;
+    usize pos;
+    usize pos_prev;
+    usize cap;
+    arena_block_t *prev;
+};
+
 STRUCT(arena_t)
 {
     u8 *buffer;
@@ -236,6 +266,7 @@ STRUCT(arena_t)
     usize pos_prev;
     usize cap;
     bool auto_grow;
+    arena_block_t *prev;
 };
 
 #define AWN_ARENA_AUTOGROW_ENABLED 1
@@ -247,9 +278,14 @@ arena_t AWN_ArenaCreate(usize mem_size);
 arena_t AWN_ArenaCreateEmpty();
 void* AWN_ArenaPush(arena_t *arena, usize push_size);
 void* AWN_ArenaResize(arena_t *arena, void* old_memory, usize old_size, usize new_size);
+// NOTE(Alex): Keeps only the newest (largest) block.
 void AWN_ArenaClear(arena_t *arena);
+void AWN_ArenaFree(arena_t arena);
+// NOTE(Alex): Starts a new block with room for new_size more bytes. GrowFromBuffer uses the
+//              given buffer (of new_size bytes) as that block, and frees it with the arena.
 void AWN_ArenaGrow(arena_t *arena, usize new_size);
 void AWN_ArenaGrowFromBuffer(arena_t *arena, void* new_buffer, usize new_size);
+// NOTE(Alex): The exception to the rule, shrinking copies the newest block to a smaller buffer.
 void AWN_ArenaShrink(arena_t *arena, usize new_size);
 void AWN_ArenaShrinkFromBuffer(arena_t *arena, void* new_buffer, usize new_size);
 
@@ -258,6 +294,7 @@ void AWN_ArenaShrinkFromBuffer(arena_t *arena, void* new_buffer, usize new_size)
 STRUCT(arena_state_t)
 {
     arena_t *arena;
+    u8 *buffer;
     usize pos_prev;
     usize pos_cur;
 };
@@ -267,6 +304,435 @@ DefineOptional(arena_state_t);
 arena_state_t AWN_ArenaStateRecord(arena_t *a);
 void AWN_ArenaStateRestore(arena_state_t);
 
+// NOTE(Alex): Define AWN_ARENA_STATS before including awn.h to count arena usage across the
+//              whole program. `aguilar run --mem` defines it and reports these numbers.
+//              Counters are relaxed atomics, peaks are exact per update but not a snapshot.
+#ifdef AWN_ARENA_STATS
+STRUCT(arena_stats_t)
+{
+    usize arena_count;
+    usize push_count;
+    usize grow_count;
+    usize bytes_pushed;
+    usize bytes_reserved;
+    usize peak_reserved;
+    usize peak_used;
+};
+
+extern arena_stats_t AWN_ArenaGlobalStats;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Atomics and memory ordering (thin wrappers over C11 stdatomic).
+//              C++ code should use <atomic> instead, so this and the queues and seqlock built
+//              on it are C only. Everything after the seqlock works in C++ as well.
+
+#ifndef __cplusplus
+
+#include <stdatomic.h>
+
+#define AWN_CACHE_LINE_SIZE 64
+#define AWN_CACHE_ALIGNED _Alignas(AWN_CACHE_LINE_SIZE)
+
+#define AWN_AtomicLoad(p) atomic_load_explicit((p), memory_order_relaxed)
+#define AWN_AtomicLoadAcquire(p) atomic_load_explicit((p), memory_order_acquire)
+#define AWN_AtomicStore(p, v) atomic_store_explicit((p), (v), memory_order_relaxed)
+#define AWN_AtomicStoreRelease(p, v) atomic_store_explicit((p), (v), memory_order_release)
+#define AWN_AtomicAdd(p, v) atomic_fetch_add_explicit((p), (v), memory_order_acq_rel)
+#define AWN_AtomicSub(p, v) atomic_fetch_sub_explicit((p), (v), memory_order_acq_rel)
+#define AWN_AtomicExchange(p, v) atomic_exchange_explicit((p), (v), memory_order_acq_rel)
+#define AWN_AtomicCompareExchange(p, expected, desired) \
+        atomic_compare_exchange_weak_explicit((p), (expected), (desired), memory_order_acq_rel, memory_order_relaxed)
+
+#define AWN_FenceAcquire() atomic_thread_fence(memory_order_acquire)
+#define AWN_FenceRelease() atomic_thread_fence(memory_order_release)
+#define AWN_FenceSeqCst() atomic_thread_fence(memory_order_seq_cst)
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define AWN_CpuRelax() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+    #define AWN_CpuRelax() __asm__ __volatile__("yield")
+#else
+    #define AWN_CpuRelax() ((void)0)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Single producer, single consumer ring buffer.
+//              Each side keeps a cached copy of the other side's index so the
+//              shared cache line is only touched when the cached view runs out.
+//              Capacity is rounded up to a power of two.
+
+STRUCT(spsc_queue_t)
+{
+    // NOTE(Alex): Producer side.
+    AWN_CACHE_ALIGNED _Atomic usize tail;
+    usize cached_head;
+
+    // NOTE(Alex): Consumer side.
+    AWN_CACHE_ALIGNED _Atomic usize head;
+    usize cached_tail;
+
+    // NOTE(Alex): Read-only after init.
+    AWN_CACHE_ALIGNED u8 *buffer;
+    usize elem_size;
+    usize mask;
+};
+
+usize AWN_SpscBufferSize(usize elem_size, usize capacity);
+void AWN_SpscInit(spsc_queue_t *queue, void* buffer, usize elem_size, usize capacity);
+void AWN_SpscInitFromArena(spsc_queue_t *queue, arena_t *arena, usize elem_size, usize capacity);
+bool AWN_SpscPush(spsc_queue_t *queue, const void* elem);
+bool AWN_SpscPop(spsc_queue_t *queue, void* out);
+usize AWN_SpscCount(spsc_queue_t *queue);
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Bounded multi producer, multi consumer queue (Dmitry Vyukov's design,
+//              https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue).
+//              Every cell carries a sequence number, so producers and consumers only
+//              contend on their own position counter.
+
+STRUCT(mpmc_queue_t)
+{
+    AWN_CACHE_ALIGNED _Atomic usize enqueue_pos;
+    AWN_CACHE_ALIGNED _Atomic usize dequeue_pos;
+
+    AWN_CACHE_ALIGNED u8 *buffer;
+    usize elem_size;
+    usize cell_size;
+    usize mask;
+};
+
+usize AWN_MpmcBufferSize(usize elem_size, usize capacity);
+void AWN_MpmcInit(mpmc_queue_t *queue, void* buffer, usize elem_size, usize capacity);
+void AWN_MpmcInitFromArena(mpmc_queue_t *queue, arena_t *arena, usize elem_size, usize capacity);
+bool AWN_MpmcPush(mpmc_queue_t *queue, const void* elem);
+bool AWN_MpmcPop(mpmc_queue_t *queue, void* out);
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Sequence lock. Readers never block writers, they retry instead.
+//              Writers are serialized against each other by spinning on the odd count.
+
+STRUCT(seqlock_t)
+{
+    _Atomic u32 seq;
+};
+
+u32 AWN_SeqlockReadBegin(seqlock_t *lock);
+bool AWN_SeqlockReadRetry(seqlock_t *lock, u32 start);
+void AWN_SeqlockWriteBegin(seqlock_t *lock);
+void AWN_SeqlockWriteEnd(seqlock_t *lock);
+void AWN_SeqlockLoad(seqlock_t *lock, void* out, const void* data, usize size);
+void AWN_SeqlockStore(seqlock_t *lock, void* data, const void* in, usize size);
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): SIMD.
+//              Two layers. The 128-bit vector types below are GCC/Clang vector extensions, so
+//              they compile to SSE2 or NEON (or plain scalar code) with no intrinsics in sight.
+//              The kernels after them have SSE2, AVX2 and AVX-512 versions, and the best one
+//              this CPU supports is picked on first use, so one binary is fast on new hosts
+//              and still runs on old ones. Everything else gets the scalar version.
+
+#if COMPILER_GCC || COMPILER_CLANG
+
+typedef f32 f32x4 __attribute__((vector_size(16)));
+typedef i32 i32x4 __attribute__((vector_size(16)));
+typedef u8 u8x16 __attribute__((vector_size(16)));
+typedef i8 i8x16 __attribute__((vector_size(16)));
+
+// NOTE(Alex): Loads and stores are unaligned, comparisons give all-ones lanes where true.
+static inline f32x4 AWN_F32x4Load(const f32* p) { f32x4 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline void AWN_F32x4Store(f32* p, f32x4 v) { memcpy(p, &v, sizeof(v)); }
+static inline f32x4 AWN_F32x4Splat(f32 x) { return (f32x4){ x, x, x, x }; }
+static inline i32x4 AWN_F32x4Lt(f32x4 a, f32x4 b) { return a < b; }
+static inline i32x4 AWN_F32x4Eq(f32x4 a, f32x4 b) { return a == b; }
+static inline f32x4 AWN_F32x4Select(i32x4 mask, f32x4 a, f32x4 b) { return (f32x4)((mask & (i32x4)a) | (~mask & (i32x4)b)); }
+static inline f32x4 AWN_F32x4Min(f32x4 a, f32x4 b) { return AWN_F32x4Select(a < b, a, b); }
+static inline f32x4 AWN_F32x4Max(f32x4 a, f32x4 b) { return AWN_F32x4Select(a > b, a, b); }
+static inline f32 AWN_F32x4ReduceAdd(f32x4 v) { return (v[0] + v[1]) + (v[2] + v[3]); }
+static inline f32 AWN_F32x4ReduceMin(f32x4 v) { f32 a = v[0] < v[1] ? v[0] : v[1]; f32 b = v[2] < v[3] ? v[2] : v[3]; return a < b ? a : b; }
+static inline f32 AWN_F32x4ReduceMax(f32x4 v) { f32 a = v[0] > v[1] ? v[0] : v[1]; f32 b = v[2] > v[3] ? v[2] : v[3]; return a > b ? a : b; }
+
+static inline i32x4 AWN_I32x4Load(const i32* p) { i32x4 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline void AWN_I32x4Store(i32* p, i32x4 v) { memcpy(p, &v, sizeof(v)); }
+static inline i32x4 AWN_I32x4Splat(i32 x) { return (i32x4){ x, x, x, x }; }
+static inline i32 AWN_I32x4ReduceAdd(i32x4 v) { return v[0] + v[1] + v[2] + v[3]; }
+
+static inline u8x16 AWN_U8x16Load(const void* p) { u8x16 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline void AWN_U8x16Store(void* p, u8x16 v) { memcpy(p, &v, sizeof(v)); }
+static inline u8x16 AWN_U8x16Splat(u8 x) { return (u8x16){ x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x }; }
+static inline i8x16 AWN_U8x16Eq(u8x16 a, u8x16 b) { return a == b; }
+
+// NOTE(Alex): One bit per lane, lane 0 in the lowest bit.
+static inline u32 AWN_I32x4MaskBits(i32x4 mask) { u32 bits = 0; for (int i = 0; i < 4; i++) bits |= (u32)(mask[i] < 0) << i; return bits; }
+static inline u32 AWN_I8x16MaskBits(i8x16 mask) { u32 bits = 0; for (int i = 0; i < 16; i++) bits |= (u32)(mask[i] < 0) << i; return bits; }
+#define AWN_MaskAny(bits) ((bits) != 0)
+
+#endif
+
+ENUM(simd_level_t)
+{
+    AWN_SIMD_SCALAR,
+    AWN_SIMD_SSE2,
+    AWN_SIMD_AVX2,
+    AWN_SIMD_AVX512,
+};
+
+// NOTE(Alex): The best level this CPU (and the OS) supports. SetLevel picks a lower one,
+//              for comparing against the scalar code, and is clamped to what is supported.
+simd_level_t AWN_SimdLevel(void);
+simd_level_t AWN_SimdSetLevel(simd_level_t level);
+const char* AWN_SimdLevelName(simd_level_t level);
+
+// NOTE(Alex): Sums are reassociated across lanes, so they can differ from a sequential
+//              loop in the last few bits.
+f32 AWN_SumF32(const f32* data, usize count);
+f32 AWN_DotF32(const f32* a, const f32* b, usize count);
+// NOTE(Alex): Index of the first matching byte, or size when there is none (like memchr).
+usize AWN_FindByte(const void* data, usize size, u8 byte);
+usize AWN_CountByte(const void* data, usize size, u8 byte);
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Strings and file I/O.
+//              A str_t is a view, it does not own its bytes and is not NUL terminated unless
+//              the function that made it says so.
+
+STRUCT(str_t)
+{
+    const char* data;
+    usize size;
+};
+
+#define AWN_StrLit(s) ((str_t){ (s), sizeof(s) - 1 })
+#define AWN_StrFmt(s) (int)(s).size, (s).data
+
+str_t AWN_Str(const char* cstr);
+bool AWN_StrEq(str_t a, str_t b);
+bool AWN_StrStartsWith(str_t s, str_t prefix);
+str_t AWN_StrTrim(str_t s);
+char* AWN_StrDup(arena_t *arena, str_t s);
+// NOTE(Alex): Splits off everything before the first delim (or all of rest) and skips the delim.
+str_t AWN_StrChop(str_t *rest, char delim);
+// NOTE(Alex): Like StrChop on '\n', but also drops a trailing '\r' and returns false once rest is empty.
+bool AWN_StrNextLine(str_t *rest, str_t *line);
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// NOTE(Alex): Reads the whole file into the arena with a NUL after the last byte.
+//              Works for pipes and /proc files too. data is NULL on failure (see errno).
+str_t AWN_FileReadAll(arena_t *arena, const char* path);
+
+// NOTE(Alex): Read-only private mapping, nothing is copied until a page is touched.
+//              Empty files map to an empty view. The view is not NUL terminated.
+STRUCT(file_view_t)
+{
+    str_t data;
+    void* mapping;
+};
+
+bool AWN_FileMap(file_view_t *view, const char* path);
+void AWN_FileUnmap(file_view_t *view);
+
+// NOTE(Alex): Buffered line reader over a file descriptor. Lines are views into the reader's
+//              buffer (without the newline) and are only valid until the next call. The buffer
+//              doubles when a single line does not fit, so long lines are never split.
+STRUCT(line_reader_t)
+{
+    int fd;
+    char* buffer;
+    usize capacity;
+    usize start;
+    usize end;
+    usize scanned;
+    bool eof;
+    int error;
+};
+
+#define AWN_LINE_READER_DEFAULT_CAPACITY KB(256)
+
+bool AWN_LineReaderOpen(line_reader_t *reader, const char* path, usize capacity);
+void AWN_LineReaderInit(line_reader_t *reader, int fd, usize capacity);
+bool AWN_LineReaderNext(line_reader_t *reader, str_t *line);
+void AWN_LineReaderClose(line_reader_t *reader);
+
+// NOTE(Alex): Reads many (small) files at once. On Linux the reads go through one io_uring,
+//              so the whole batch costs a handful of syscalls. Where io_uring is missing or
+//              blocked (old kernels, seccomp) it falls back to pread. Contents land in the
+//              arena NUL terminated, error is 0 or an errno value. Returns how many succeeded.
+STRUCT(file_read_t)
+{
+    const char* path;
+    str_t data;
+    int error;
+};
+
+usize AWN_FileReadBatch(arena_t *arena, file_read_t *reads, usize count);
+bool AWN_FileReadBatchUsesUring(void);
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Event loop and stackless coroutines.
+//              One thread, one epoll. A task is a function that the loop calls again every time
+//              what it waits for is ready. The AWN_TASK_* macros turn it into a coroutine with a
+//              switch on the line it stopped at (Duff's device), so a waiting task costs only its
+//              task_t and its arena, and thousands of them fit in one process.
+//
+//              Locals do not survive a wait, anything that must lives in task->locals (allocated
+//              with the task, and freed with it and its arena when the task finishes). Only one
+//              AWN_TASK_* wait per source line, and no waits inside a switch of the task's own.
+//
+//              static int Fetch(loop_t *loop, task_t *task)
+//              {
+//                  fetch_t* f = task->locals;
+//                  AWN_TASK_BEGIN(task);
+//                  f->fd = AWN_TcpConnectStart("127.0.0.1", 80);
+//                  AWN_TASK_CONNECT(loop, task, f->fd, 1000);
+//                  AWN_TASK_WRITE(loop, task, f->fd, "GET / HTTP/1.0\r\n\r\n", 18, 1000);
+//                  AWN_TASK_READ(loop, task, f->fd, f->buffer, sizeof(f->buffer), 1000);
+//                  AWN_TaskClose(loop, task, f->fd);
+//                  AWN_TASK_END(task);
+//              }
+
+#if defined(__linux__)
+
+#define AWN_TASK_DONE 0
+#define AWN_TASK_WAIT 1
+#define AWN_TASK_READY 2
+
+#define AWN_TASK_NO_TIMEOUT -1
+#define AWN_TASK_DEFAULT_ARENA_SIZE KB(16)
+
+NEED_STRUCT(loop_t);
+NEED_STRUCT(task_t);
+
+typedef int (*task_fn_t)(loop_t *loop, task_t *task);
+
+ENUM(task_status_t)
+{
+    TASK_RUNNING,
+    TASK_READY,
+    TASK_WAITING,
+    TASK_SUSPENDED,
+};
+
+ENUM(task_io_t)
+{
+    AWN_IO_READ,
+    AWN_IO_WRITE,
+    AWN_IO_ACCEPT,
+    AWN_IO_CONNECT,
+};
+
+STRUCT(task_t)
+{
+    int line;
+    task_fn_t run;
+    void* locals;
+    arena_t arena;
+
+    // NOTE(Alex): Byte count, fd or 0 for the last operation, or a negative errno.
+    i64 result;
+
+    task_status_t status;
+    int wait_fd;
+    bool armed;
+    bool timed_out;
+    u64 deadline;
+    usize timer_index;
+    task_t* next;
+};
+
+STRUCT(loop_t)
+{
+    int epoll_fd;
+    u64 now;
+    usize task_count;
+    usize armed_count;
+    task_t* ready_first;
+    task_t* ready_last;
+    task_t** timers;
+    usize timer_count;
+    usize timer_capacity;
+};
+
+#define AWN_TASK_BEGIN(task) switch ((task)->line) { case 0:
+#define AWN_TASK_END(task) } (task)->line = -1; return AWN_TASK_DONE
+
+// NOTE(Alex): Lets every other ready task run once before continuing.
+#define AWN_TASK_YIELD(task) \
+    do { (task)->line = __LINE__; return AWN_TASK_READY; case __LINE__:; } while (0)
+
+#define AWN_TASK_SLEEP(loop, task, ms) \
+    do { AWN_TaskSleep((loop), (task), (ms)); (task)->line = __LINE__; return AWN_TASK_WAIT; case __LINE__:; } while (0)
+
+// NOTE(Alex): Waits until another task calls AWN_TaskWake on this one.
+#define AWN_TASK_SUSPEND(task) \
+    do { (task)->status = TASK_SUSPENDED; (task)->line = __LINE__; return AWN_TASK_WAIT; case __LINE__:; } while (0)
+
+// NOTE(Alex): Tries the operation, and if it would block waits for the fd and tries again.
+//              The arguments are evaluated again on every try, so keep them in task->locals.
+//              Regular files never block, so reads and writes on them finish inline.
+#define AWN_TASK_IO(loop, task, op, fd, buffer, size, timeout_ms) \
+    do { \
+        AWN_TaskIoBegin((loop), (task), (timeout_ms)); \
+        (task)->line = __LINE__; \
+        if (0) { case __LINE__:; } \
+        if (!AWN_TaskIo((loop), (task), (op), (fd), (buffer), (size))) return AWN_TASK_WAIT; \
+    } while (0)
+
+#define AWN_TASK_READ(loop, task, fd, buffer, size, timeout_ms) AWN_TASK_IO(loop, task, AWN_IO_READ, fd, buffer, size, timeout_ms)
+#define AWN_TASK_WRITE(loop, task, fd, buffer, size, timeout_ms) AWN_TASK_IO(loop, task, AWN_IO_WRITE, fd, (void*)(buffer), size, timeout_ms)
+#define AWN_TASK_ACCEPT(loop, task, fd, timeout_ms) AWN_TASK_IO(loop, task, AWN_IO_ACCEPT, fd, NULL, 0, timeout_ms)
+#define AWN_TASK_CONNECT(loop, task, fd, timeout_ms) AWN_TASK_IO(loop, task, AWN_IO_CONNECT, fd, NULL, 0, timeout_ms)
+
+bool AWN_LoopInit(loop_t *loop);
+void AWN_LoopFree(loop_t *loop);
+// NOTE(Alex): Runs until every task has finished. Returns false if epoll itself failed.
+bool AWN_LoopRun(loop_t *loop);
+// NOTE(Alex): Milliseconds on the monotonic clock, as of the last wakeup.
+u64 AWN_LoopNow(loop_t *loop);
+
+// NOTE(Alex): The returned task has zeroed locals of locals_size bytes to fill in. It first runs
+//              on the next turn of the loop. arena_size 0 means AWN_TASK_DEFAULT_ARENA_SIZE.
+task_t* AWN_LoopSpawn(loop_t *loop, task_fn_t run, usize locals_size, usize arena_size);
+void AWN_TaskWake(loop_t *loop, task_t *task);
+void AWN_TaskSleep(loop_t *loop, task_t *task, i64 ms);
+void AWN_TaskIoBegin(loop_t *loop, task_t *task, i64 timeout_ms);
+bool AWN_TaskIo(loop_t *loop, task_t *task, task_io_t op, int fd, void* buffer, usize size);
+// NOTE(Alex): Removes the fd from the loop before closing it, so a reused fd number is not
+//              confused with the old one.
+void AWN_TaskClose(loop_t *loop, task_t *task, int fd);
+
+// NOTE(Alex): Non-blocking sockets. Host names go through getaddrinfo, which blocks, so prefer
+//              numeric addresses inside tasks. Both return -1 with errno set on failure.
+bool AWN_SocketNonBlocking(int fd);
+int AWN_TcpListen(const char* host, u16 port, int backlog);
+int AWN_TcpConnectStart(const char* host, u16 port);
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Embedded assets.
+//              Files named on asset lines in .aguilar are linked into the program by Aguilar,
+//              and looked up here by the path they were given there. The data is read-only
+//              and followed by a NUL that size does not count, so text assets work as C strings.
+//              A program built without assets just finds nothing.
+
+STRUCT(asset_t)
+{
+    const char* name;
+    const u8* data;
+    usize size;
+};
+
+// NOTE(Alex): NULL when there is no asset with that name.
+const asset_t* AWN_AssetGet(const char* name);
+// NOTE(Alex): Same, as a view. Empty (with NULL data) when there is no asset with that name.
+str_t AWN_AssetStr(const char* name);
+const asset_t* AWN_AssetList(usize* count);
+
 #endif // End of header.
 
 #ifdef AWN_IMPLEMENTATION
@@ -276,11 +742,36 @@ void AWN_ArenaStateRestore(arena_state_t);
 
 #include <stdlib.h>
 
+#ifdef AWN_ARENA_STATS
+arena_stats_t AWN_ArenaGlobalStats;
+
+#define AWN_ARENA_STAT_ADD(field, value) __atomic_fetch_add(&AWN_ArenaGlobalStats.field, (usize)(value), __ATOMIC_RELAXED)
+#define AWN_ARENA_STAT_SUB(field, value) __atomic_fetch_sub(&AWN_ArenaGlobalStats.field, (usize)(value), __ATOMIC_RELAXED)
+
+static inline void AWN_ArenaStatMax(usize* peak, usize value)
+{
+    usize current = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while (value > current and !__atomic_compare_exchange_n(peak, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+#define AWN_ARENA_STAT_RESERVE(value) AWN_ArenaStatMax(&AWN_ArenaGlobalStats.peak_reserved, AWN_ARENA_STAT_ADD(bytes_reserved, value) + (usize)(value))
+#define AWN_ARENA_STAT_USED(value) AWN_ArenaStatMax(&AWN_ArenaGlobalStats.peak_used, value)
+#else
+#define AWN_ARENA_STAT_ADD(field, value)
+#define AWN_ARENA_STAT_SUB(field, value)
+#define AWN_ARENA_STAT_RESERVE(value)
+#define AWN_ARENA_STAT_USED(value)
+#endif
+
 arena_t AWN_ArenaCreateFromBuffer(void* mem_buffer, usize mem_size)
 {
+    AWN_ARENA_STAT_ADD(arena_count, 1);
+    AWN_ARENA_STAT_RESERVE(mem_size);
+
     arena_t arena;
     arena.buffer = (u8 *)mem_buffer;
     arena.cap = mem_size;
+    arena.prev = NULL;
 
     arena.pos = 0;
     arena.pos_prev = 0;
@@ -296,7 +787,7 @@ arena_t AWN_ArenaCreate(usize mem_size)
 {
     void* buffer = malloc(mem_size);
     assertln(buffer != NULL, "Arena: Failed to allocate memory.");
-    return AWN_ArenaCreateFromBuffer(malloc(mem_size), mem_size);
+    return AWN_ArenaCreateFromBuffer(buffer, mem_size);
 }
 
 arena_t AWN_ArenaCreateEmpty()
@@ -304,10 +795,34 @@ arena_t AWN_ArenaCreateEmpty()
     return AWN_ArenaCreate(2);
 }
 
+// NOTE(Alex): Block headers are padded so the first push in a block keeps its alignment.
+#define AWN_ARENA_BLOCK_HEADER AWN_ARENA_ALIGN_UP_POW_2(sizeof(arena_block_t), AWN_ARENA_DEFAULT_ALIGNMENT)
+
+// NOTE(Alex): Frees the newest block and makes the one before it current again.
+//              The header lives inside the block being freed, so it is copied out first.
+static void AWN_ArenaPopBlock(arena_t *arena)
+{
+    arena_block_t block = *arena->prev;
+
+    AWN_ARENA_STAT_SUB(bytes_reserved, arena->cap);
+    free(arena->buffer);
+
+    arena->buffer = block.buffer;
+    arena->pos = block.pos;
+    arena->pos_prev = block.pos_prev;
+    arena->cap = block.cap;
+    arena->prev = block.prev;
+}
+
 // NOTE(Alex): We would prefer it if the user never manually frees an arena buffer.
 void AWN_ArenaFree(arena_t arena)
 {
+    while (arena.prev != NULL) {
+        AWN_ArenaPopBlock(&arena);
+    }
+
     if (arena.buffer != NULL) {
+        AWN_ARENA_STAT_SUB(bytes_reserved, arena.cap);
         free(arena.buffer);
     }
 }
@@ -323,7 +838,8 @@ void* AWN_ArenaPush(arena_t *arena, usize push_size)
     offset -= (usize)arena->buffer;
 
     if (offset + push_size > arena->cap and arena->auto_grow) {
-        AWN_ArenaGrow(arena, offset + push_size);
+        AWN_ArenaGrow(arena, push_size);
+        offset = arena->pos;
     }
 
     if (offset + push_size <= arena->cap) {
@@ -331,12 +847,31 @@ void* AWN_ArenaPush(arena_t *arena, usize push_size)
         arena->pos_prev = arena->pos;
         arena->pos = offset + push_size;
         memset(result, 0, push_size);
+
+        AWN_ARENA_STAT_ADD(push_count, 1);
+        AWN_ARENA_STAT_ADD(bytes_pushed, push_size);
+        AWN_ARENA_STAT_USED(arena->pos);
     }
 
     assertln(result != 0, "Arena push: Memory out of bounds.");
     return result;
 }
 
+static bool AWN_ArenaOwns(arena_t *arena, u8* memory)
+{
+    if (arena->buffer <= memory and memory < arena->buffer + arena->cap) {
+        return true;
+    }
+
+    for (arena_block_t *block = arena->prev; block != NULL; block = block->prev) {
+        if (block->buffer <= memory and memory < block->buffer + block->cap) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void* AWN_ArenaResize(arena_t *arena, void* old_memory, usize old_size, usize new_size)
 {
     assertln(arena != NULL and arena->buffer != NULL, "Arena points to null.");
@@ -346,22 +881,23 @@ void* AWN_ArenaResize(arena_t *arena, void* old_memory, usize old_size, usize ne
     // NOTE(Alex): If neither of these is true, memory is out of bounds.
     if (old_mem == 0 || old_size == 0) {
         return AWN_ArenaPush(arena, new_size);
-    } else if (arena->buffer <= old_mem && old_mem < arena->buffer + arena->cap) {
-        // NOTE(Alex): This checks whether the old memory could actually be inside the arena's buffer.
+    } else if (AWN_ArenaOwns(arena, old_mem)) {
+        // NOTE(Alex): This checks whether the old memory could actually be inside one of the arena's blocks.
         //
-        // NOTE(Alex): Checks if the old memory was our last allocation.
-        if (arena->buffer + arena->pos_prev == old_mem) {
+        // NOTE(Alex): Checks if the old memory was our last allocation, and still fits in its block.
+        if (arena->buffer + arena->pos_prev == old_mem and arena->pos_prev + new_size <= arena->cap) {
             arena->pos = arena->pos_prev + new_size;
+            AWN_ARENA_STAT_USED(arena->pos);
             // NOTE(Alex): If we're making the allocation larger, make sure we reset the data to zero.
             if (new_size > old_size) {
-                memset(&arena->buffer[arena->pos], 0, new_size - old_size);
+                memset(&arena->buffer[arena->pos_prev + old_size], 0, new_size - old_size);
             }
             result = old_memory;
         } else {
-            // NOTE(Alex): Because pos_prev does not align, that means that this was an even earlier allocation.
+            // NOTE(Alex): Either an even earlier allocation, or the last one outgrew its block.
             //              Therefore we will just allocate new memory and copy old data in new buffer.
             //              This does mean that we lost the buffer we had already allocated, but that is just
-            //              how arena allocators work.
+            //              how arena allocators work. The old memory stays valid, nothing moved.
             void *new_memory = AWN_ArenaPush(arena, new_size);
             usize copy_size = old_size < new_size ? old_size : new_size;
             memcpy(new_memory, old_memory, copy_size);
@@ -376,6 +912,30 @@ void* AWN_ArenaResize(arena_t *arena, void* old_memory, usize old_size, usize ne
 void AWN_ArenaClear(arena_t *arena)
 {
     assertln(arena != NULL and arena->buffer != NULL, "Arena points to null.");
+
+    // NOTE(Alex): The newest block is the largest one, the older ones go. Once it is the
+    //              only block its header is not needed anymore and gets reused. Every header
+    //              lives in the block after the one it describes, so it is copied out first.
+    arena_block_t block = { 0 };
+    bool more = arena->prev != NULL;
+
+    if (more) {
+        block = *arena->prev;
+    }
+
+    while (more) {
+        u8* buffer = block.buffer;
+        AWN_ARENA_STAT_SUB(bytes_reserved, block.cap);
+
+        more = block.prev != NULL;
+        if (more) {
+            block = *block.prev;
+        }
+
+        free(buffer);
+    }
+
+    arena->prev = NULL;
     arena->pos = 0;
     arena->pos_prev = 0;
 }
@@ -383,27 +943,38 @@ void AWN_ArenaClear(arena_t *arena)
 void AWN_ArenaGrow(arena_t *arena, usize new_size)
 {
     assertln(arena != NULL and arena->buffer != NULL, "Arena points to null.");
-    if (new_size < arena->cap) {
-        return;
+
+    // NOTE(Alex): Grow geometrically, otherwise every push past the end starts a block.
+    usize block_size = new_size + AWN_ARENA_BLOCK_HEADER + AWN_ARENA_DEFAULT_ALIGNMENT;
+    if (block_size < arena->cap * 2) {
+        block_size = arena->cap * 2;
     }
 
-    void* new_buffer = realloc(arena->buffer, new_size);
-    assertln(new_buffer != NULL, "Arena: Failed to reallocate memory for the arena.");
-    AWN_ArenaGrowFromBuffer(arena, new_buffer, new_size);
+    void* new_buffer = malloc(block_size);
+    assertln(new_buffer != NULL, "Arena: Failed to allocate a new block for the arena.");
+    AWN_ArenaGrowFromBuffer(arena, new_buffer, block_size);
 }
 
 void AWN_ArenaGrowFromBuffer(arena_t *arena, void* new_buffer, usize new_size)
 {
     assertln(arena != NULL and arena->buffer != NULL, "Arena points to null.");
-    if (new_size < arena->cap) {
-        return;
-    }
+    assertln(new_size > AWN_ARENA_BLOCK_HEADER, "Arena: New block is too small.");
 
-    memset(new_buffer, 0, new_size);
-    memcpy(new_buffer, arena->buffer, arena->cap);
+    AWN_ARENA_STAT_ADD(grow_count, 1);
+    AWN_ARENA_STAT_RESERVE(new_size);
+
+    arena_block_t *block = (arena_block_t *)new_buffer;
+    block->buffer = arena->buffer;
+    block->pos = arena->pos;
+    block->pos_prev = arena->pos_prev;
+    block->cap = arena->cap;
+    block->prev = arena->prev;
 
     arena->buffer = (u8 *)new_buffer;
     arena->cap = new_size;
+    arena->prev = block;
+    arena->pos = AWN_ARENA_BLOCK_HEADER;
+    arena->pos_prev = AWN_ARENA_BLOCK_HEADER;
 }
 
 void AWN_ArenaShrink(arena_t *arena, usize new_size)
@@ -413,9 +984,11 @@ void AWN_ArenaShrink(arena_t *arena, usize new_size)
         new_size = arena->pos;
     }
 
-    void* new_buffer = realloc(arena->buffer, new_size);
+    u8* old_buffer = arena->buffer;
+    void* new_buffer = malloc(new_size);
     assertln(new_buffer != NULL, "Arena: Failed to reallocate memory for the arena.");
     AWN_ArenaShrinkFromBuffer(arena, new_buffer, new_size);
+    free(old_buffer);
 }
 
 void AWN_ArenaShrinkFromBuffer(arena_t *arena, void* new_buffer, usize new_size)
@@ -425,11 +998,22 @@ void AWN_ArenaShrinkFromBuffer(arena_t *arena, void* new_buffer, usize new_size)
         new_size = arena->pos;
     }
 
+    if (new_size < arena->cap) {
+        AWN_ARENA_STAT_SUB(bytes_reserved, arena->cap - new_size);
+    } else {
+        AWN_ARENA_STAT_RESERVE(new_size - arena->cap);
+    }
+
     memset(new_buffer, 0, new_size);
-    memcpy(new_buffer, arena->buffer, arena->cap);
+    memcpy(new_buffer, arena->buffer, arena->pos);
 
     arena->buffer = (u8 *)new_buffer;
     arena->cap = new_size;
+
+    // NOTE(Alex): The header describing the previous block moved along with everything else.
+    if (arena->prev != NULL) {
+        arena->prev = (arena_block_t *)new_buffer;
+    }
 }
 
 arena_state_t AWN_ArenaStateRecord(arena_t *arena)
@@ -437,15 +1021,1821 @@ arena_state_t AWN_ArenaStateRecord(arena_t *arena)
     assertln(arena != NULL, "Arena points to null.");
     arena_state_t state;
     state.arena = arena;
+    state.buffer = arena->buffer;
     state.pos_prev = arena->pos_prev;
     state.pos_cur = arena->pos;
     return state;
 }
 
+// NOTE(Alex): Blocks started after the state was recorded are freed.
 void AWN_ArenaStateRestore(arena_state_t state)
 {
+    while (state.arena->buffer != state.buffer and state.arena->prev != NULL) {
+        AWN_ArenaPopBlock(state.arena);
+    }
+
     state.arena->pos_prev = state.pos_prev;
     state.arena->pos = state.pos_cur;
 }
 
+#ifndef __cplusplus
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): SPSC queue implementation
+
+function usize AWN_QueueRoundCapacity(usize capacity)
+{
+    usize result = 2;
+    while (result < capacity) {
+        result <<= 1;
+    }
+    return result;
+}
+
+usize AWN_SpscBufferSize(usize elem_size, usize capacity)
+{
+    return elem_size * AWN_QueueRoundCapacity(capacity);
+}
+
+void AWN_SpscInit(spsc_queue_t *queue, void* buffer, usize elem_size, usize capacity)
+{
+    assertln(queue != NULL and buffer != NULL, "SPSC: Queue or buffer points to null.");
+    assertln(elem_size > 0, "SPSC: Element size is zero.");
+
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->head, 0);
+    queue->cached_head = 0;
+    queue->cached_tail = 0;
+    queue->buffer = (u8 *)buffer;
+    queue->elem_size = elem_size;
+    queue->mask = AWN_QueueRoundCapacity(capacity) - 1;
+}
+
+// NOTE(Alex): The arena must not be cleared (or restored past the buffer) while the queue is alive.
+void AWN_SpscInitFromArena(spsc_queue_t *queue, arena_t *arena, usize elem_size, usize capacity)
+{
+    void* buffer = AWN_ArenaPush(arena, AWN_SpscBufferSize(elem_size, capacity));
+    AWN_SpscInit(queue, buffer, elem_size, capacity);
+}
+
+bool AWN_SpscPush(spsc_queue_t *queue, const void* elem)
+{
+    usize tail = AWN_AtomicLoad(&queue->tail);
+
+    if (tail - queue->cached_head > queue->mask) {
+        queue->cached_head = AWN_AtomicLoadAcquire(&queue->head);
+        if (tail - queue->cached_head > queue->mask) {
+            return false;
+        }
+    }
+
+    memcpy(&queue->buffer[(tail & queue->mask) * queue->elem_size], elem, queue->elem_size);
+    AWN_AtomicStoreRelease(&queue->tail, tail + 1);
+
+    return true;
+}
+
+bool AWN_SpscPop(spsc_queue_t *queue, void* out)
+{
+    usize head = AWN_AtomicLoad(&queue->head);
+
+    if (head == queue->cached_tail) {
+        queue->cached_tail = AWN_AtomicLoadAcquire(&queue->tail);
+        if (head == queue->cached_tail) {
+            return false;
+        }
+    }
+
+    memcpy(out, &queue->buffer[(head & queue->mask) * queue->elem_size], queue->elem_size);
+    AWN_AtomicStoreRelease(&queue->head, head + 1);
+
+    return true;
+}
+
+usize AWN_SpscCount(spsc_queue_t *queue)
+{
+    return AWN_AtomicLoadAcquire(&queue->tail) - AWN_AtomicLoadAcquire(&queue->head);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): MPMC queue implementation
+
+// NOTE(Alex): A cell is the sequence number followed by the element, padded so the
+//              next sequence number stays aligned.
+function usize AWN_MpmcCellSize(usize elem_size)
+{
+    return AWN_ARENA_ALIGN_UP_POW_2(sizeof(_Atomic usize) + elem_size, sizeof(_Atomic usize));
+}
+
+#define AWN_MPMC_CELL_SEQ(queue, pos) ((_Atomic usize *)&(queue)->buffer[((pos) & (queue)->mask) * (queue)->cell_size])
+#define AWN_MPMC_CELL_DATA(queue, pos) (&(queue)->buffer[((pos) & (queue)->mask) * (queue)->cell_size + sizeof(_Atomic usize)])
+
+usize AWN_MpmcBufferSize(usize elem_size, usize capacity)
+{
+    return AWN_MpmcCellSize(elem_size) * AWN_QueueRoundCapacity(capacity);
+}
+
+void AWN_MpmcInit(mpmc_queue_t *queue, void* buffer, usize elem_size, usize capacity)
+{
+    assertln(queue != NULL and buffer != NULL, "MPMC: Queue or buffer points to null.");
+    assertln(elem_size > 0, "MPMC: Element size is zero.");
+    assertln(((usize)buffer % sizeof(_Atomic usize)) == 0, "MPMC: Buffer is not aligned.");
+
+    queue->buffer = (u8 *)buffer;
+    queue->elem_size = elem_size;
+    queue->cell_size = AWN_MpmcCellSize(elem_size);
+    queue->mask = AWN_QueueRoundCapacity(capacity) - 1;
+
+    for (usize i = 0; i <= queue->mask; i++) {
+        atomic_init(AWN_MPMC_CELL_SEQ(queue, i), i);
+    }
+
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+}
+
+// NOTE(Alex): The arena must not be cleared (or restored past the buffer) while the queue is alive.
+void AWN_MpmcInitFromArena(mpmc_queue_t *queue, arena_t *arena, usize elem_size, usize capacity)
+{
+    void* buffer = AWN_ArenaPush(arena, AWN_MpmcBufferSize(elem_size, capacity));
+    AWN_MpmcInit(queue, buffer, elem_size, capacity);
+}
+
+bool AWN_MpmcPush(mpmc_queue_t *queue, const void* elem)
+{
+    usize pos = AWN_AtomicLoad(&queue->enqueue_pos);
+
+    for (;;) {
+        usize seq = AWN_AtomicLoadAcquire(AWN_MPMC_CELL_SEQ(queue, pos));
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            // NOTE(Alex): Cell is free, try to claim it. On failure pos is reloaded.
+            if (AWN_AtomicCompareExchange(&queue->enqueue_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // NOTE(Alex): Consumers have not caught up, queue is full.
+            return false;
+        } else {
+            pos = AWN_AtomicLoad(&queue->enqueue_pos);
+        }
+    }
+
+    memcpy(AWN_MPMC_CELL_DATA(queue, pos), elem, queue->elem_size);
+    AWN_AtomicStoreRelease(AWN_MPMC_CELL_SEQ(queue, pos), pos + 1);
+
+    return true;
+}
+
+bool AWN_MpmcPop(mpmc_queue_t *queue, void* out)
+{
+    usize pos = AWN_AtomicLoad(&queue->dequeue_pos);
+
+    for (;;) {
+        usize seq = AWN_AtomicLoadAcquire(AWN_MPMC_CELL_SEQ(queue, pos));
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            if (AWN_AtomicCompareExchange(&queue->dequeue_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // NOTE(Alex): Producers have not filled this cell yet, queue is empty.
+            return false;
+        } else {
+            pos = AWN_AtomicLoad(&queue->dequeue_pos);
+        }
+    }
+
+    memcpy(out, AWN_MPMC_CELL_DATA(queue, pos), queue->elem_size);
+    AWN_AtomicStoreRelease(AWN_MPMC_CELL_SEQ(queue, pos), pos + queue->mask + 1);
+
+    return true;
+}
+
+#undef AWN_MPMC_CELL_SEQ
+#undef AWN_MPMC_CELL_DATA
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Seqlock implementation
+
+u32 AWN_SeqlockReadBegin(seqlock_t *lock)
+{
+    u32 seq;
+    while ((seq = AWN_AtomicLoadAcquire(&lock->seq)) & 1) {
+        AWN_CpuRelax();
+    }
+    return seq;
+}
+
+bool AWN_SeqlockReadRetry(seqlock_t *lock, u32 start)
+{
+    AWN_FenceAcquire();
+    return AWN_AtomicLoad(&lock->seq) != start;
+}
+
+void AWN_SeqlockWriteBegin(seqlock_t *lock)
+{
+    u32 seq = AWN_AtomicLoad(&lock->seq);
+    for (;;) {
+        if ((seq & 1) == 0 and AWN_AtomicCompareExchange(&lock->seq, &seq, seq + 1)) {
+            break;
+        }
+        AWN_CpuRelax();
+        seq = AWN_AtomicLoad(&lock->seq);
+    }
+    AWN_FenceRelease();
+}
+
+void AWN_SeqlockWriteEnd(seqlock_t *lock)
+{
+    AWN_AtomicAdd(&lock->seq, 1);
+}
+
+// NOTE(Alex): Readers copy while a writer may be storing, so both sides copy through relaxed
+//              atomics, a word at a time when both pointers allow it, to keep that race defined.
+//              A torn copy is still possible and is what the sequence check throws away.
+function void AWN_SeqlockCopy(void* out, const void* in, usize size)
+{
+    u8* dst = (u8*)out;
+    const u8* src = (const u8*)in;
+
+    if (((uintptr_t)dst | (uintptr_t)src) % sizeof(usize) == 0) {
+        for (; size >= sizeof(usize); size -= sizeof(usize), dst += sizeof(usize), src += sizeof(usize)) {
+            __atomic_store_n((usize*)dst, __atomic_load_n((const usize*)src, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+        }
+    }
+
+    for (; size > 0; size--, dst++, src++) {
+        __atomic_store_n(dst, __atomic_load_n(src, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+}
+
+void AWN_SeqlockLoad(seqlock_t *lock, void* out, const void* data, usize size)
+{
+    u32 start;
+    do {
+        start = AWN_SeqlockReadBegin(lock);
+        AWN_SeqlockCopy(out, data, size);
+    } while (AWN_SeqlockReadRetry(lock, start));
+}
+
+void AWN_SeqlockStore(seqlock_t *lock, void* data, const void* in, usize size)
+{
+    AWN_SeqlockWriteBegin(lock);
+    AWN_SeqlockCopy(data, in, size);
+    AWN_SeqlockWriteEnd(lock);
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): SIMD implementation.
+//              Every kernel has a scalar version, and on x86 SSE2/AVX2/AVX-512 versions built
+//              with target attributes, so the rest of the file keeps the caller's flags.
+
+function f32 AWN_SumF32Scalar(const f32* data, usize count)
+{
+    f32 sum = 0;
+    for (usize i = 0; i < count; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+function f32 AWN_DotF32Scalar(const f32* a, const f32* b, usize count)
+{
+    f32 sum = 0;
+    for (usize i = 0; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+function usize AWN_FindByteScalar(const void* data, usize size, u8 byte)
+{
+    const u8* bytes = (const u8*)data;
+    for (usize i = 0; i < size; i++) {
+        if (bytes[i] == byte) {
+            return i;
+        }
+    }
+    return size;
+}
+
+function usize AWN_CountByteScalar(const void* data, usize size, u8 byte)
+{
+    const u8* bytes = (const u8*)data;
+    usize count = 0;
+    for (usize i = 0; i < size; i++) {
+        count += bytes[i] == byte;
+    }
+    return count;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && (COMPILER_GCC || COMPILER_CLANG)
+
+#include <immintrin.h>
+
+#define AWN_SIMD_X86 1
+
+__attribute__((target("sse2")))
+function f32 AWN_SumF32Sse2(const f32* data, usize count)
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+    usize i = 0;
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm_add_ps(acc0, _mm_loadu_ps(data + i));
+        acc1 = _mm_add_ps(acc1, _mm_loadu_ps(data + i + 4));
+        acc2 = _mm_add_ps(acc2, _mm_loadu_ps(data + i + 8));
+        acc3 = _mm_add_ps(acc3, _mm_loadu_ps(data + i + 12));
+    }
+    for (; i + 4 <= count; i += 4) {
+        acc0 = _mm_add_ps(acc0, _mm_loadu_ps(data + i));
+    }
+
+    f32 lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3)));
+    f32 sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    for (; i < count; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+__attribute__((target("sse2")))
+function f32 AWN_DotF32Sse2(const f32* a, const f32* b, usize count)
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    usize i = 0;
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+
+    f32 lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+    f32 sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("sse2")))
+function usize AWN_FindByteSse2(const void* data, usize size, u8 byte)
+{
+    const u8* bytes = (const u8*)data;
+    __m128i needle = _mm_set1_epi8((char)byte);
+    usize i = 0;
+    for (; i + 16 <= size; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(bytes + i)), needle));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (; i < size; i++) {
+        if (bytes[i] == byte) {
+            return i;
+        }
+    }
+    return size;
+}
+
+// NOTE(Alex): Matches are counted in byte lanes (cmpeq gives -1, so subtract) and folded
+//              into 64-bit sums with sad before the lanes can overflow at 255.
+__attribute__((target("sse2")))
+function usize AWN_CountByteSse2(const void* data, usize size, u8 byte)
+{
+    const u8* bytes = (const u8*)data;
+    __m128i needle = _mm_set1_epi8((char)byte);
+    __m128i total = _mm_setzero_si128();
+    usize i = 0;
+
+    while (i + 16 <= size) {
+        __m128i lanes = _mm_setzero_si128();
+        for (int block = 0; block < 255 and i + 16 <= size; block++, i += 16) {
+            lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(bytes + i)), needle));
+        }
+        total = _mm_add_epi64(total, _mm_sad_epu8(lanes, _mm_setzero_si128()));
+    }
+
+    u64 halves[2];
+    _mm_storeu_si128((__m128i*)halves, total);
+    usize count = halves[0] + halves[1];
+
+    for (; i < size; i++) {
+        count += bytes[i] == byte;
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+function f32 AWN_SumF32Avx2(const f32* data, usize count)
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    usize i = 0;
+    for (; i + 32 <= count; i += 32) {
+        acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(data + i));
+        acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(data + i + 8));
+        acc2 = _mm256_add_ps(acc2, _mm256_loadu_ps(data + i + 16));
+        acc3 = _mm256_add_ps(acc3, _mm256_loadu_ps(data + i + 24));
+    }
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(data + i));
+    }
+
+    __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+
+    f32 lanes[4];
+    _mm_storeu_ps(lanes, half);
+    f32 sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    for (; i < count; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+function f32 AWN_DotF32Avx2(const f32* a, const f32* b, usize count)
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    usize i = 0;
+    for (; i + 32 <= count; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+
+    __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+
+    f32 lanes[4];
+    _mm_storeu_ps(lanes, half);
+    f32 sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2")))
+function usize AWN_FindByteAvx2(const void* data, usize size, u8 byte)
+{
+    const u8* bytes = (const u8*)data;
+    __m256i needle = _mm256_set1_epi8((char)byte);
+    usize i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(bytes + i)), needle);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(bytes + i + 32)), needle);
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))) {
+            u64 mask = (u32)_mm256_movemask_epi8(a) | ((u64)(u32)_mm256_movemask_epi8(b) << 32);
+            return i + __builtin_ctzll(mask);
+        }
+    }
+    for (; i + 32 <= size; i += 32) {
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(bytes + i)), needle));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (; i < size; i++) {
+        if (bytes[i] == byte) {
+            return i;
+        }
+    }
+    return size;
+}
+
+__attribute__((target("avx2")))
+function usize AWN_CountByteAvx2(const void* data, usize size, u8 byte)
+{
+    const u8* bytes = (const u8*)data;
+    __m256i needle = _mm256_set1_epi8((char)byte);
+    __m256i total = _mm256_setzero_si256();
+    usize i = 0;
+
+    while (i + 32 <= size) {
+        __m256i lanes = _mm256_setzero_si256();
+        for (int block = 0; block < 255 and i + 32 <= size; block++, i += 32) {
+            lanes = _mm256_sub_epi8(lanes, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(bytes + i)), needle));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(lanes, _mm256_setzero_si256()));
+    }
+
+    u64 quarters[4];
+    _mm256_storeu_si256((__m256i*)quarters, total);
+    usize count = quarters[0] + quarters[1] + quarters[2] + quarters[3];
+
+    for (; i < size; i++) {
+        count += bytes[i] == byte;
+    }
+    return count;
+}
+
+// NOTE(Alex): AVX-512 handles the tail with a masked load instead of a scalar loop.
+__attribute__((target("avx512f")))
+function f32 AWN_SumF32Avx512(const f32* data, usize count)
+{
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    usize i = 0;
+    for (; i + 32 <= count; i += 32) {
+        acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(data + i));
+        acc1 = _mm512_add_ps(acc1, _mm512_loadu_ps(data + i + 16));
+    }
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(data + i));
+    }
+    if (i < count) {
+        __mmask16 tail = (__mmask16)((1u << (count - i)) - 1);
+        acc1 = _mm512_add_ps(acc1, _mm512_maskz_loadu_ps(tail, data + i));
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+function f32 AWN_DotF32Avx512(const f32* a, const f32* b, usize count)
+{
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    usize i = 0;
+    for (; i + 32 <= count; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < count) {
+        __mmask16 tail = (__mmask16)((1u << (count - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, a + i), _mm512_maskz_loadu_ps(tail, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+function usize AWN_FindByteAvx512(const void* data, usize size, u8 byte)
+{
+    const u8* bytes = (const u8*)data;
+    __m512i needle = _mm512_set1_epi8((char)byte);
+    usize i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)(bytes + i)), needle);
+        if (mask != 0) {
+            return i + __builtin_ctzll(mask);
+        }
+    }
+    if (i < size) {
+        __mmask64 tail = (((__mmask64)1) << (size - i)) - 1;
+        __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(tail, _mm512_maskz_loadu_epi8(tail, bytes + i), needle);
+        if (mask != 0) {
+            return i + __builtin_ctzll(mask);
+        }
+    }
+    return size;
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+function usize AWN_CountByteAvx512(const void* data, usize size, u8 byte)
+{
+    const u8* bytes = (const u8*)data;
+    __m512i needle = _mm512_set1_epi8((char)byte);
+    usize count = 0;
+    usize i = 0;
+    for (; i + 64 <= size; i += 64) {
+        count += __builtin_popcountll(_mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)(bytes + i)), needle));
+    }
+    if (i < size) {
+        __mmask64 tail = (((__mmask64)1) << (size - i)) - 1;
+        count += __builtin_popcountll(_mm512_mask_cmpeq_epi8_mask(tail, _mm512_maskz_loadu_epi8(tail, bytes + i), needle));
+    }
+    return count;
+}
+
+#endif
+
+STRUCT(simd_kernels_t)
+{
+    simd_level_t level;
+    f32 (*sum_f32)(const f32*, usize);
+    f32 (*dot_f32)(const f32*, const f32*, usize);
+    usize (*find_byte)(const void*, usize, u8);
+    usize (*count_byte)(const void*, usize, u8);
+};
+
+global const simd_kernels_t awn_simd_tables[] = {
+    { AWN_SIMD_SCALAR, AWN_SumF32Scalar, AWN_DotF32Scalar, AWN_FindByteScalar, AWN_CountByteScalar },
+#if AWN_SIMD_X86
+    { AWN_SIMD_SSE2, AWN_SumF32Sse2, AWN_DotF32Sse2, AWN_FindByteSse2, AWN_CountByteSse2 },
+    { AWN_SIMD_AVX2, AWN_SumF32Avx2, AWN_DotF32Avx2, AWN_FindByteAvx2, AWN_CountByteAvx2 },
+    { AWN_SIMD_AVX512, AWN_SumF32Avx512, AWN_DotF32Avx512, AWN_FindByteAvx512, AWN_CountByteAvx512 },
+#endif
+};
+
+// NOTE(Alex): Null until the first call resolves it. Racing first calls pick the same table.
+//              Accessed through the __atomic builtins, which C++ has as well.
+global const simd_kernels_t* awn_simd_kernels;
+
+simd_level_t AWN_SimdLevel(void)
+{
+#if AWN_SIMD_X86
+    __builtin_cpu_init();
+    // NOTE(Alex): __builtin_cpu_supports also checks that the OS saves the wider registers.
+    if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw")) {
+        return AWN_SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma")) {
+        return AWN_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return AWN_SIMD_SSE2;
+    }
+#endif
+    return AWN_SIMD_SCALAR;
+}
+
+simd_level_t AWN_SimdSetLevel(simd_level_t level)
+{
+    simd_level_t supported = AWN_SimdLevel();
+    if (level > supported) {
+        level = supported;
+    }
+    __atomic_store_n(&awn_simd_kernels, &awn_simd_tables[level], __ATOMIC_RELEASE);
+    return level;
+}
+
+const char* AWN_SimdLevelName(simd_level_t level)
+{
+    switch (level) {
+        case AWN_SIMD_AVX512: return "avx512";
+        case AWN_SIMD_AVX2: return "avx2";
+        case AWN_SIMD_SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+function inline const simd_kernels_t* AWN_SimdKernels(void)
+{
+    const simd_kernels_t* kernels = __atomic_load_n(&awn_simd_kernels, __ATOMIC_ACQUIRE);
+    if (kernels == NULL) {
+        AWN_SimdSetLevel(AWN_SimdLevel());
+        kernels = __atomic_load_n(&awn_simd_kernels, __ATOMIC_ACQUIRE);
+    }
+    return kernels;
+}
+
+f32 AWN_SumF32(const f32* data, usize count)
+{
+    return AWN_SimdKernels()->sum_f32(data, count);
+}
+
+f32 AWN_DotF32(const f32* a, const f32* b, usize count)
+{
+    return AWN_SimdKernels()->dot_f32(a, b, count);
+}
+
+usize AWN_FindByte(const void* data, usize size, u8 byte)
+{
+    return AWN_SimdKernels()->find_byte(data, size, byte);
+}
+
+usize AWN_CountByte(const void* data, usize size, u8 byte)
+{
+    return AWN_SimdKernels()->count_byte(data, size, byte);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Strings and file I/O implementation.
+
+str_t AWN_Str(const char* cstr)
+{
+    return (str_t){ cstr, strlen(cstr) };
+}
+
+bool AWN_StrEq(str_t a, str_t b)
+{
+    return a.size == b.size and (a.size == 0 or memcmp(a.data, b.data, a.size) == 0);
+}
+
+bool AWN_StrStartsWith(str_t s, str_t prefix)
+{
+    return s.size >= prefix.size and (prefix.size == 0 or memcmp(s.data, prefix.data, prefix.size) == 0);
+}
+
+function bool AWN_StrIsSpace(char c)
+{
+    return c == ' ' or c == '\t' or c == '\r' or c == '\n';
+}
+
+str_t AWN_StrTrim(str_t s)
+{
+    while (s.size > 0 and AWN_StrIsSpace(s.data[0])) {
+        s.data++;
+        s.size--;
+    }
+    while (s.size > 0 and AWN_StrIsSpace(s.data[s.size - 1])) {
+        s.size--;
+    }
+    return s;
+}
+
+char* AWN_StrDup(arena_t *arena, str_t s)
+{
+    char* result = (char*)AWN_ArenaPush(arena, s.size + 1);
+    if (s.size > 0) {
+        memcpy(result, s.data, s.size);
+    }
+    result[s.size] = '\0';
+    return result;
+}
+
+str_t AWN_StrChop(str_t *rest, char delim)
+{
+    usize index = rest->size > 0 ? AWN_FindByte(rest->data, rest->size, (u8)delim) : 0;
+    str_t result = { rest->data, index };
+
+    if (index < rest->size) {
+        rest->data += index + 1;
+        rest->size -= index + 1;
+    } else {
+        rest->data += rest->size;
+        rest->size = 0;
+    }
+
+    return result;
+}
+
+bool AWN_StrNextLine(str_t *rest, str_t *line)
+{
+    if (rest->size == 0) {
+        return false;
+    }
+
+    *line = AWN_StrChop(rest, '\n');
+    if (line->size > 0 and line->data[line->size - 1] == '\r') {
+        line->size--;
+    }
+    return true;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+str_t AWN_FileReadAll(arena_t *arena, const char* path)
+{
+    str_t result = { 0 };
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return result;
+    }
+
+    // NOTE(Alex): Regular files are read at their current size in one go. Anything else
+    //              (pipes, /proc) reports no useful size, so the buffer doubles until EOF.
+    struct stat sb;
+    bool sized = fstat(fd, &sb) == 0 and S_ISREG(sb.st_mode) and sb.st_size > 0;
+    usize capacity = sized ? (usize)sb.st_size + 1 : KB(4);
+    char* data = (char*)AWN_ArenaPush(arena, capacity);
+    usize size = 0;
+    int error = 0;
+
+    while (true) {
+        if (size + 1 == capacity) {
+            if (sized) {
+                break;
+            }
+            data = (char*)AWN_ArenaResize(arena, data, capacity, capacity * 2);
+            capacity *= 2;
+        }
+
+        ssize_t count = read(fd, data + size, capacity - size - 1);
+        if (count < 0 and errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            error = count < 0 ? errno : 0;
+            break;
+        }
+        size += count;
+    }
+
+    close(fd);
+
+    if (error != 0) {
+        errno = error;
+        return result;
+    }
+
+    data[size] = '\0';
+    result.data = data;
+    result.size = size;
+    return result;
+}
+
+bool AWN_FileMap(file_view_t *view, const char* path)
+{
+    memset(view, 0, sizeof(*view));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 or !S_ISREG(sb.st_mode)) {
+        int error = S_ISDIR(sb.st_mode) ? EISDIR : EINVAL;
+        close(fd);
+        errno = error;
+        return false;
+    }
+
+    // NOTE(Alex): mmap refuses zero lengths, so empty files get a static empty view.
+    if (sb.st_size == 0) {
+        view->data = AWN_StrLit("");
+        close(fd);
+        return true;
+    }
+
+    void* mapping = mmap(NULL, (usize)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        errno = error;
+        return false;
+    }
+
+    view->mapping = mapping;
+    view->data = (str_t){ (const char*)mapping, (usize)sb.st_size };
+    return true;
+}
+
+void AWN_FileUnmap(file_view_t *view)
+{
+    if (view->mapping != NULL) {
+        munmap(view->mapping, view->data.size);
+    }
+    memset(view, 0, sizeof(*view));
+}
+
+void AWN_LineReaderInit(line_reader_t *reader, int fd, usize capacity)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = fd;
+    reader->capacity = capacity > 0 ? capacity : AWN_LINE_READER_DEFAULT_CAPACITY;
+    reader->buffer = (char*)malloc(reader->capacity);
+
+    if (reader->buffer == NULL) {
+        reader->capacity = 0;
+        reader->error = ENOMEM;
+        reader->eof = true;
+    }
+}
+
+bool AWN_LineReaderOpen(line_reader_t *reader, const char* path, usize capacity)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        memset(reader, 0, sizeof(*reader));
+        reader->fd = -1;
+        reader->error = errno;
+        reader->eof = true;
+        return false;
+    }
+
+    AWN_LineReaderInit(reader, fd, capacity);
+    return reader->buffer != NULL;
+}
+
+bool AWN_LineReaderNext(line_reader_t *reader, str_t *line)
+{
+    while (true) {
+        char* begin = reader->buffer + reader->start;
+        usize pending = reader->end - reader->start;
+
+        // NOTE(Alex): scanned remembers how far the last refill already searched, so a long
+        //              line is not searched again from its start after every read.
+        if (reader->scanned < pending) {
+            usize found = reader->scanned + AWN_FindByte(begin + reader->scanned, pending - reader->scanned, '\n');
+            if (found < pending) {
+                *line = (str_t){ begin, found };
+                if (found > 0 and begin[found - 1] == '\r') {
+                    line->size--;
+                }
+                reader->start += found + 1;
+                reader->scanned = 0;
+                return true;
+            }
+        }
+        reader->scanned = pending;
+
+        if (reader->eof) {
+            if (pending == 0) {
+                return false;
+            }
+
+            *line = (str_t){ begin, pending };
+            if (begin[pending - 1] == '\r') {
+                line->size--;
+            }
+            reader->start = reader->end;
+            reader->scanned = 0;
+            return true;
+        }
+
+        // NOTE(Alex): Only the unfinished line moves to the front, then the buffer doubles if
+        //              that line alone fills it.
+        if (reader->start > 0) {
+            memmove(reader->buffer, begin, pending);
+            reader->start = 0;
+            reader->end = pending;
+        }
+
+        if (reader->end == reader->capacity) {
+            char* buffer = (char*)realloc(reader->buffer, reader->capacity * 2);
+            if (buffer == NULL) {
+                reader->error = ENOMEM;
+                reader->eof = true;
+                continue;
+            }
+            reader->buffer = buffer;
+            reader->capacity *= 2;
+        }
+
+        ssize_t count = read(reader->fd, reader->buffer + reader->end, reader->capacity - reader->end);
+        if (count < 0 and errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            reader->error = count < 0 ? errno : 0;
+            reader->eof = true;
+            continue;
+        }
+        reader->end += count;
+    }
+}
+
+void AWN_LineReaderClose(line_reader_t *reader)
+{
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    free(reader->buffer);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
+
+#define AWN_READ_BATCH_MAX 64
+
+// NOTE(Alex): Reads until size bytes or EOF (the file may have shrunk since it was sized).
+function i64 AWN_PreadFully(int fd, char* buffer, usize size, usize offset)
+{
+    while (offset < size) {
+        ssize_t count = pread(fd, buffer + offset, size - offset, (off_t)offset);
+        if (count < 0 and errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            return -1;
+        }
+        if (count == 0) {
+            break;
+        }
+        offset += count;
+    }
+    return (i64)offset;
+}
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define AWN_IO_URING 1
+#endif
+#endif
+
+#if AWN_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+// NOTE(Alex): A minimal io_uring over the raw syscalls (no liburing). The kernel and this
+//              process share the rings, so tails are published with release stores and the
+//              other side's indices are read with acquire loads.
+STRUCT(uring_t)
+{
+    int fd;
+    u8* sq_ring;
+    usize sq_ring_size;
+    u8* cq_ring;
+    usize cq_ring_size;
+    struct io_uring_sqe* sqes;
+    usize sqes_size;
+    u32* sq_tail;
+    u32* sq_mask;
+    u32* sq_array;
+    u32* cq_head;
+    u32* cq_tail;
+    u32* cq_mask;
+    struct io_uring_cqe* cqes;
+};
+
+// NOTE(Alex): 0 until probed, then 1 when io_uring works here and -1 when it does not.
+global int awn_uring_state;
+
+function void AWN_UringTeardown(uring_t *ring)
+{
+    if (ring->sqes != NULL and (void*)ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL and ring->cq_ring != ring->sq_ring and (void*)ring->cq_ring != MAP_FAILED) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL and (void*)ring->sq_ring != MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    close(ring->fd);
+}
+
+function bool AWN_UringSetup(uring_t *ring, u32 entries)
+{
+    memset(ring, 0, sizeof(*ring));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // NOTE(Alex): Since 5.4 both rings live in one mapping.
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        // NOTE(Alex): No max() here, C++ standard headers #undef it.
+        ring->sq_ring_size = ring->cq_ring_size = ring->sq_ring_size > ring->cq_ring_size ? ring->sq_ring_size : ring->cq_ring_size;
+    }
+
+    ring->sq_ring = (u8*)mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = single_mmap ? ring->sq_ring
+        : (u8*)mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+    if ((void*)ring->sq_ring == MAP_FAILED or (void*)ring->cq_ring == MAP_FAILED or (void*)ring->sqes == MAP_FAILED) {
+        AWN_UringTeardown(ring);
+        return false;
+    }
+
+    ring->sq_tail = (u32*)(ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = (u32*)(ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (u32*)(ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (u32*)(ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (u32*)(ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (u32*)(ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(ring->cq_ring + params.cq_off.cqes);
+    return true;
+}
+
+// NOTE(Alex): Submits one read per file and waits for all of them. results[i] is the byte
+//              count or a negative errno. Returns false if the ring itself failed, in which
+//              case entries without a result are left at -EAGAIN for the pread fallback.
+function bool AWN_UringReadAll(uring_t *ring, const int* fds, char** buffers, const usize* sizes, i64* results, usize count)
+{
+    u32 tail = __atomic_load_n(ring->sq_tail, __ATOMIC_RELAXED);
+    u32 queued = 0;
+
+    for (usize i = 0; i < count; i++) {
+        results[i] = -EAGAIN;
+        if (fds[i] < 0) {
+            continue;
+        }
+
+        u32 index = tail & *ring->sq_mask;
+        struct io_uring_sqe* sqe = &ring->sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fds[i];
+        sqe->addr = (u64)(uintptr_t)buffers[i];
+        sqe->len = (u32)sizes[i];
+        sqe->off = 0;
+        sqe->user_data = i;
+        ring->sq_array[index] = index;
+        tail++;
+        queued++;
+    }
+
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    u32 to_submit = queued;
+    u32 completed = 0;
+
+    while (completed < queued) {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, to_submit, queued - completed, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR or errno == EAGAIN or errno == EBUSY) {
+                continue;
+            }
+            return false;
+        }
+        to_submit -= (u32)submitted < to_submit ? (u32)submitted : to_submit;
+
+        u32 head = *ring->cq_head;
+        u32 cq_tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != cq_tail) {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            results[cqe->user_data] = cqe->res;
+            head++;
+            completed++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
+
+#endif
+
+bool AWN_FileReadBatchUsesUring(void)
+{
+#if AWN_IO_URING
+    int state = __atomic_load_n(&awn_uring_state, __ATOMIC_RELAXED);
+    if (state == 0) {
+        // NOTE(Alex): AWN_NO_IO_URING forces the fallback, e.g. to compare the two.
+        uring_t ring;
+        state = -1;
+        if (getenv("AWN_NO_IO_URING") == NULL and AWN_UringSetup(&ring, 1)) {
+            AWN_UringTeardown(&ring);
+            state = 1;
+        }
+        __atomic_store_n(&awn_uring_state, state, __ATOMIC_RELAXED);
+    }
+    return state > 0;
+#else
+    return false;
+#endif
+}
+
+usize AWN_FileReadBatch(arena_t *arena, file_read_t *reads, usize count)
+{
+    // NOTE(Alex): Regular files are sized with stat first and share one arena block, which is
+    //              pushed before anything else so nothing else lands in the arena while reads are
+    //              in flight. Everything else (pipes, /proc, empty files) goes through ReadAll
+    //              once the block is filled.
+    usize total = 0;
+    for (usize i = 0; i < count; i++) {
+        file_read_t* read = &reads[i];
+        read->data = (str_t){ 0 };
+        read->error = 0;
+
+        struct stat sb;
+        if (stat(read->path, &sb) == 0 and S_ISREG(sb.st_mode) and sb.st_size > 0) {
+            read->data.size = (usize)sb.st_size;
+            total += read->data.size + 1;
+        }
+    }
+
+    char* block = total > 0 ? (char*)AWN_ArenaPush(arena, total) : NULL;
+    char* block_end = block + total;
+    char* cursor = block;
+    for (usize i = 0; i < count; i++) {
+        if (reads[i].data.size > 0) {
+            reads[i].data.data = cursor;
+            cursor += reads[i].data.size + 1;
+        }
+    }
+
+#if AWN_IO_URING
+    uring_t ring;
+    bool use_uring = total > 0 and AWN_FileReadBatchUsesUring() and AWN_UringSetup(&ring, (u32)(count < AWN_READ_BATCH_MAX ? count : AWN_READ_BATCH_MAX));
+#endif
+
+    int fds[AWN_READ_BATCH_MAX];
+    char* buffers[AWN_READ_BATCH_MAX];
+    usize sizes[AWN_READ_BATCH_MAX];
+    i64 results[AWN_READ_BATCH_MAX];
+    file_read_t* batch[AWN_READ_BATCH_MAX];
+
+    usize next = 0;
+    while (total > 0 and next < count) {
+        // NOTE(Alex): Files are opened a batch at a time to stay well below the fd limit.
+        usize batch_count = 0;
+        for (; next < count and batch_count < AWN_READ_BATCH_MAX; next++) {
+            file_read_t* read = &reads[next];
+            if (read->error != 0 or read->data.data < block or read->data.data >= block_end) {
+                continue;
+            }
+
+            int fd = open(read->path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                read->error = errno;
+            }
+
+            batch[batch_count] = read;
+            fds[batch_count] = fd;
+            buffers[batch_count] = (char*)read->data.data;
+            sizes[batch_count] = read->data.size;
+            results[batch_count] = -EAGAIN;
+            batch_count++;
+        }
+
+#if AWN_IO_URING
+        if (use_uring and !AWN_UringReadAll(&ring, fds, buffers, sizes, results, batch_count)) {
+            // NOTE(Alex): The ring itself broke (not expected), pread finishes what did not complete.
+            AWN_UringTeardown(&ring);
+            use_uring = false;
+        }
+#endif
+
+        // NOTE(Alex): Short and failed reads (e.g. kernels before 5.6 without IORING_OP_READ)
+        //              are finished with pread.
+        for (usize i = 0; i < batch_count; i++) {
+            file_read_t* read = batch[i];
+            if (fds[i] < 0) {
+                read->data = (str_t){ 0 };
+                continue;
+            }
+
+            i64 size = results[i];
+            if (size < 0 or (usize)size < sizes[i]) {
+                size = AWN_PreadFully(fds[i], buffers[i], sizes[i], size < 0 ? 0 : (usize)size);
+            }
+
+            if (size < 0) {
+                read->error = errno;
+                read->data = (str_t){ 0 };
+            } else {
+                buffers[i][size] = '\0';
+                read->data.size = (usize)size;
+            }
+            close(fds[i]);
+        }
+    }
+
+#if AWN_IO_URING
+    if (use_uring) {
+        AWN_UringTeardown(&ring);
+    }
+#endif
+
+    for (usize i = 0; i < count; i++) {
+        file_read_t* read = &reads[i];
+        if (read->error != 0 or read->data.data != NULL) {
+            continue;
+        }
+
+        read->data = AWN_FileReadAll(arena, read->path);
+        if (read->data.data == NULL) {
+            read->error = errno;
+        }
+    }
+
+    usize succeeded = 0;
+    for (usize i = 0; i < count; i++) {
+        succeeded += reads[i].error == 0 and reads[i].data.data != NULL;
+    }
+    return succeeded;
+}
+
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Event loop implementation.
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define AWN_TIMER_NONE ((usize)-1)
+#define AWN_LOOP_MAX_EVENTS 256
+
+function u64 AWN_LoopClock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000 + (u64)ts.tv_nsec / 1000000;
+}
+
+bool AWN_LoopInit(loop_t *loop)
+{
+    memset(loop, 0, sizeof(*loop));
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->now = AWN_LoopClock();
+    return loop->epoll_fd >= 0;
+}
+
+void AWN_LoopFree(loop_t *loop)
+{
+    // NOTE(Alex): Tasks that never finished are only reachable from the ready list and the
+    //              timers. Suspended ones have nothing pointing at them and leak.
+    while (loop->ready_first != NULL) {
+        task_t* task = loop->ready_first;
+        loop->ready_first = task->next;
+        AWN_ArenaFree(task->arena);
+        free(task);
+    }
+    for (usize i = 0; i < loop->timer_count; i++) {
+        AWN_ArenaFree(loop->timers[i]->arena);
+        free(loop->timers[i]);
+    }
+
+    free(loop->timers);
+    if (loop->epoll_fd >= 0) {
+        close(loop->epoll_fd);
+    }
+    memset(loop, 0, sizeof(*loop));
+    loop->epoll_fd = -1;
+}
+
+u64 AWN_LoopNow(loop_t *loop)
+{
+    return loop->now;
+}
+
+// NOTE(Alex): Timers are a binary min-heap on the deadline, every task knows its own slot so
+//              a wakeup by its fd can take it out early.
+function void AWN_TimerSwap(loop_t *loop, usize a, usize b)
+{
+    task_t* task = loop->timers[a];
+    loop->timers[a] = loop->timers[b];
+    loop->timers[b] = task;
+    loop->timers[a]->timer_index = a;
+    loop->timers[b]->timer_index = b;
+}
+
+function void AWN_TimerSiftUp(loop_t *loop, usize index)
+{
+    while (index > 0) {
+        usize parent = (index - 1) / 2;
+        if (loop->timers[parent]->deadline <= loop->timers[index]->deadline) {
+            break;
+        }
+        AWN_TimerSwap(loop, parent, index);
+        index = parent;
+    }
+}
+
+function void AWN_TimerSiftDown(loop_t *loop, usize index)
+{
+    while (true) {
+        usize smallest = index;
+        usize left = index * 2 + 1;
+        usize right = left + 1;
+        if (left < loop->timer_count and loop->timers[left]->deadline < loop->timers[smallest]->deadline) {
+            smallest = left;
+        }
+        if (right < loop->timer_count and loop->timers[right]->deadline < loop->timers[smallest]->deadline) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        AWN_TimerSwap(loop, index, smallest);
+        index = smallest;
+    }
+}
+
+function void AWN_TimerPush(loop_t *loop, task_t *task)
+{
+    if (loop->timer_count == loop->timer_capacity) {
+        loop->timer_capacity = loop->timer_capacity ? loop->timer_capacity * 2 : 64;
+        loop->timers = (task_t**)realloc(loop->timers, loop->timer_capacity * sizeof(task_t*));
+        assertln(loop->timers != NULL, "Loop: Failed to grow the timer heap.");
+    }
+
+    task->timer_index = loop->timer_count++;
+    loop->timers[task->timer_index] = task;
+    AWN_TimerSiftUp(loop, task->timer_index);
+}
+
+function void AWN_TimerRemove(loop_t *loop, task_t *task)
+{
+    usize index = task->timer_index;
+    if (index == AWN_TIMER_NONE) {
+        return;
+    }
+
+    task->timer_index = AWN_TIMER_NONE;
+    loop->timer_count--;
+    if (index == loop->timer_count) {
+        return;
+    }
+
+    loop->timers[index] = loop->timers[loop->timer_count];
+    loop->timers[index]->timer_index = index;
+    AWN_TimerSiftUp(loop, index);
+    AWN_TimerSiftDown(loop, loop->timers[index]->timer_index);
+}
+
+function void AWN_LoopPushReady(loop_t *loop, task_t *task)
+{
+    task->status = TASK_READY;
+    task->next = NULL;
+    if (loop->ready_last != NULL) {
+        loop->ready_last->next = task;
+    } else {
+        loop->ready_first = task;
+    }
+    loop->ready_last = task;
+}
+
+task_t* AWN_LoopSpawn(loop_t *loop, task_fn_t run, usize locals_size, usize arena_size)
+{
+    // NOTE(Alex): Locals share the task's allocation rather than its arena, so clearing or
+    //              restoring the arena inside the task can't take them away.
+    usize task_size = AWN_ARENA_ALIGN_UP_POW_2(sizeof(task_t), AWN_ARENA_DEFAULT_ALIGNMENT);
+    task_t* task = (task_t*)calloc(1, task_size + locals_size);
+    assertln(task != NULL, "Loop: Failed to allocate a task.");
+
+    task->arena = AWN_ArenaCreate(arena_size > 0 ? arena_size : AWN_TASK_DEFAULT_ARENA_SIZE);
+    task->run = run;
+    task->locals = locals_size > 0 ? (u8*)task + task_size : NULL;
+    task->wait_fd = -1;
+    task->timer_index = AWN_TIMER_NONE;
+
+    loop->task_count++;
+    AWN_LoopPushReady(loop, task);
+    return task;
+}
+
+void AWN_TaskWake(loop_t *loop, task_t *task)
+{
+    if (task->status == TASK_SUSPENDED) {
+        AWN_LoopPushReady(loop, task);
+    }
+}
+
+void AWN_TaskSleep(loop_t *loop, task_t *task, i64 ms)
+{
+    task->timed_out = false;
+    task->status = TASK_WAITING;
+    task->deadline = loop->now + (ms > 0 ? (u64)ms : 0);
+    AWN_TimerPush(loop, task);
+}
+
+void AWN_TaskIoBegin(loop_t *loop, task_t *task, i64 timeout_ms)
+{
+    task->wait_fd = -1;
+    task->timed_out = false;
+    task->deadline = timeout_ms >= 0 ? loop->now + (u64)timeout_ms : 0;
+}
+
+// NOTE(Alex): Every wait is one-shot, so an fd only reports to the task that armed it last,
+//              and at most once.
+function bool AWN_TaskArm(loop_t *loop, task_t *task, int fd, u32 events)
+{
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = task;
+
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0) {
+        if (errno != ENOENT or epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            return false;
+        }
+    }
+
+    task->wait_fd = fd;
+    task->armed = true;
+    task->status = TASK_WAITING;
+    loop->armed_count++;
+    if (task->deadline != 0) {
+        AWN_TimerPush(loop, task);
+    }
+    return true;
+}
+
+function void AWN_TaskDisarm(loop_t *loop, task_t *task)
+{
+    if (task->wait_fd >= 0) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, task->wait_fd, &event);
+    }
+}
+
+bool AWN_TaskIo(loop_t *loop, task_t *task, task_io_t op, int fd, void* buffer, usize size)
+{
+    if (task->timed_out) {
+        AWN_TaskDisarm(loop, task);
+        task->timed_out = false;
+        task->result = -ETIMEDOUT;
+        return true;
+    }
+
+    u32 events = (op == AWN_IO_WRITE or op == AWN_IO_CONNECT) ? EPOLLOUT : EPOLLIN;
+
+    while (true) {
+        i64 result = 0;
+
+        switch (op) {
+            case AWN_IO_READ: {
+                result = read(fd, buffer, size);
+            } break;
+
+            case AWN_IO_WRITE: {
+                // NOTE(Alex): send so a closed peer is an EPIPE and not a SIGPIPE.
+                result = send(fd, buffer, size, MSG_NOSIGNAL);
+                if (result < 0 and errno == ENOTSOCK) {
+                    result = write(fd, buffer, size);
+                }
+            } break;
+
+            case AWN_IO_ACCEPT: {
+                // NOTE(Alex): accept4 would need _GNU_SOURCE before every include of this header.
+                result = accept(fd, NULL, NULL);
+                if (result >= 0) {
+                    AWN_SocketNonBlocking((int)result);
+                    fcntl((int)result, F_SETFD, FD_CLOEXEC);
+                }
+            } break;
+
+            case AWN_IO_CONNECT: {
+                // NOTE(Alex): The connect was started already, the socket turns writable once it
+                //              is done and SO_ERROR says how it went.
+                if (task->wait_fd < 0) {
+                    errno = EAGAIN;
+                    result = -1;
+                    break;
+                }
+
+                int error = 0;
+                socklen_t length = sizeof(error);
+                if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0) {
+                    error = errno;
+                }
+                errno = error;
+                result = error == 0 ? 0 : -1;
+            } break;
+        }
+
+        if (result >= 0) {
+            task->result = result;
+            return true;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno == EAGAIN or errno == EWOULDBLOCK) {
+            if (AWN_TaskArm(loop, task, fd, events)) {
+                return false;
+            }
+            // NOTE(Alex): epoll takes no regular files, but those never block in the first place.
+            if (errno == EPERM and op != AWN_IO_CONNECT) {
+                continue;
+            }
+        }
+
+        task->result = -(i64)errno;
+        return true;
+    }
+}
+
+void AWN_TaskClose(loop_t *loop, task_t *task, int fd)
+{
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    if (task->wait_fd == fd) {
+        task->wait_fd = -1;
+    }
+    close(fd);
+}
+
+bool AWN_LoopRun(loop_t *loop)
+{
+    struct epoll_event events[AWN_LOOP_MAX_EVENTS];
+
+    while (loop->task_count > 0) {
+        // NOTE(Alex): Only the tasks that were ready when this turn started run, anything they
+        //              make ready (including yields) waits for the next turn, after polling.
+        task_t* last = loop->ready_last;
+        while (loop->ready_first != NULL) {
+            task_t* task = loop->ready_first;
+            bool was_last = task == last;
+            loop->ready_first = task->next;
+            if (loop->ready_first == NULL) {
+                loop->ready_last = NULL;
+            }
+
+            task->status = TASK_RUNNING;
+            int status = task->run(loop, task);
+
+            if (status == AWN_TASK_DONE) {
+                AWN_TimerRemove(loop, task);
+                AWN_ArenaFree(task->arena);
+                free(task);
+                loop->task_count--;
+            } else if (status == AWN_TASK_READY) {
+                AWN_LoopPushReady(loop, task);
+            }
+
+            if (was_last) {
+                break;
+            }
+        }
+
+        if (loop->task_count == 0) {
+            break;
+        }
+
+        int timeout = -1;
+        if (loop->ready_first != NULL) {
+            timeout = 0;
+        } else if (loop->timer_count > 0) {
+            u64 deadline = loop->timers[0]->deadline;
+            timeout = deadline > loop->now ? (int)(deadline - loop->now < (u64)INT32_MAX ? deadline - loop->now : (u64)INT32_MAX) : 0;
+        } else if (loop->armed_count == 0) {
+            // NOTE(Alex): Only suspended tasks are left and nothing can wake them anymore.
+            errno = EDEADLK;
+            return false;
+        }
+
+        int count = epoll_wait(loop->epoll_fd, events, AWN_LOOP_MAX_EVENTS, timeout);
+        if (count < 0 and errno != EINTR) {
+            return false;
+        }
+
+        loop->now = AWN_LoopClock();
+
+        for (int i = 0; i < count; i++) {
+            task_t* task = (task_t*)events[i].data.ptr;
+            if (task->status != TASK_WAITING or !task->armed) {
+                continue;
+            }
+            task->armed = false;
+            loop->armed_count--;
+            AWN_TimerRemove(loop, task);
+            AWN_LoopPushReady(loop, task);
+        }
+
+        while (loop->timer_count > 0 and loop->timers[0]->deadline <= loop->now) {
+            task_t* task = loop->timers[0];
+            AWN_TimerRemove(loop, task);
+            if (task->armed) {
+                task->armed = false;
+                task->timed_out = true;
+                loop->armed_count--;
+            }
+            AWN_LoopPushReady(loop, task);
+        }
+    }
+
+    return true;
+}
+
+bool AWN_SocketNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 and fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+function struct addrinfo* AWN_Resolve(const char* host, u16 port, bool passive)
+{
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+    struct addrinfo* list = NULL;
+    int status = getaddrinfo(host, service, &hints, &list);
+    if (status != 0) {
+        errno = status == EAI_SYSTEM ? errno : EHOSTUNREACH;
+        return NULL;
+    }
+    return list;
+}
+
+int AWN_TcpListen(const char* host, u16 port, int backlog)
+{
+    struct addrinfo* list = AWN_Resolve(host, port, true);
+    int fd = -1;
+
+    for (struct addrinfo* info = list; info != NULL and fd < 0; info = info->ai_next) {
+        fd = socket(info->ai_family, info->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, info->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, info->ai_addr, info->ai_addrlen) != 0 or listen(fd, backlog) != 0) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            fd = -1;
+        }
+    }
+
+    if (list != NULL) {
+        freeaddrinfo(list);
+    }
+    return fd;
+}
+
+int AWN_TcpConnectStart(const char* host, u16 port)
+{
+    struct addrinfo* list = AWN_Resolve(host, port, false);
+    int fd = -1;
+
+    for (struct addrinfo* info = list; info != NULL and fd < 0; info = info->ai_next) {
+        fd = socket(info->ai_family, info->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, info->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, info->ai_addr, info->ai_addrlen) != 0 and errno != EINPROGRESS) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            fd = -1;
+        }
+    }
+
+    if (list != NULL) {
+        freeaddrinfo(list);
+    }
+    return fd;
+}
+
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// NOTE(Alex): Embedded assets implementation
+//              Aguilar generates the table. Both symbols are weak references, so a program
+//              without assets still links and they are simply NULL.
+#if COMPILER_GCC || COMPILER_CLANG
+extern const asset_t awn_assets[] __attribute__((weak));
+extern const usize awn_asset_count __attribute__((weak));
+#endif
+
+const asset_t* AWN_AssetList(usize* count)
+{
+#if COMPILER_GCC || COMPILER_CLANG
+    if (&awn_asset_count != NULL and awn_assets != NULL) {
+        *count = awn_asset_count;
+        return awn_assets;
+    }
+#endif
+
+    *count = 0;
+    return NULL;
+}
+
+const asset_t* AWN_AssetGet(const char* name)
+{
+    usize count = 0;
+    const asset_t* assets = AWN_AssetList(&count);
+
+    for (usize i = 0; i < count; i++) {
+        if (strcmp(assets[i].name, name) == 0) {
+            return &assets[i];
+        }
+    }
+
+    return NULL;
+}
+
+str_t AWN_AssetStr(const char* name)
+{
+    const asset_t* asset = AWN_AssetGet(name);
+    if (asset == NULL) {
+        return (str_t){ NULL, 0 };
+    }
+
+    return (str_t){ (const char*)asset->data, asset->size };
+}
+
 #endif
@@ -0,0 +1,645 @@
+#include "../src/awn.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// NOTE(Alex): Stress tests for the queues and the seqlock. Elements carry the producer in the
+//              high bits and its own sequence number in the low ones, so consumers can check
+//              that nothing was lost, duplicated or reordered per producer. A full or empty
+//              queue yields, so these also finish on a single core.
+#define STRESS_PRODUCERS 4
+#define STRESS_CONSUMERS 4
+#define STRESS_PER_PRODUCER 200000
+#define STRESS_TOTAL (STRESS_PRODUCERS * STRESS_PER_PRODUCER)
+
+#define STRESS_ELEM(producer, seq) (((u64)(producer) << 32) | (u64)(seq))
+#define STRESS_PRODUCER(elem) ((u32)((elem) >> 32))
+#define STRESS_SEQ(elem) ((u32)(elem))
+
+STRUCT(stress_t)
+{
+    void* queue;
+    bool mpmc;
+    _Atomic u64 consumed;
+    _Atomic u8 *seen;
+};
+
+STRUCT(stress_thread_t)
+{
+    pthread_t thread;
+    stress_t *stress;
+    u32 id;
+};
+
+function bool Stress_Push(stress_t *stress, u64 elem)
+{
+    return stress->mpmc ? AWN_MpmcPush(stress->queue, &elem) : AWN_SpscPush(stress->queue, &elem);
+}
+
+function bool Stress_Pop(stress_t *stress, u64 *elem)
+{
+    return stress->mpmc ? AWN_MpmcPop(stress->queue, elem) : AWN_SpscPop(stress->queue, elem);
+}
+
+function void* Stress_Producer(void* data)
+{
+    stress_thread_t* thread = data;
+
+    for (u32 seq = 0; seq < STRESS_PER_PRODUCER; seq++) {
+        while (!Stress_Push(thread->stress, STRESS_ELEM(thread->id, seq))) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+function void* Stress_Consumer(void* data)
+{
+    stress_thread_t* thread = data;
+    stress_t* stress = thread->stress;
+
+    // NOTE(Alex): One past the last sequence number seen from each producer.
+    u32 next[STRESS_PRODUCERS] = {0};
+
+    while (AWN_AtomicLoad(&stress->consumed) < STRESS_TOTAL) {
+        u64 elem;
+        if (!Stress_Pop(stress, &elem)) {
+            sched_yield();
+            continue;
+        }
+
+        u32 producer = STRESS_PRODUCER(elem);
+        u32 seq = STRESS_SEQ(elem);
+        assert(producer < STRESS_PRODUCERS and seq < STRESS_PER_PRODUCER);
+        assert(seq >= next[producer]);
+        next[producer] = seq + 1;
+
+        u8 times_seen = AWN_AtomicAdd(&stress->seen[producer * STRESS_PER_PRODUCER + seq], 1);
+        assert(times_seen == 0);
+        AWN_AtomicAdd(&stress->consumed, 1);
+    }
+
+    return NULL;
+}
+
+function void Stress_Run(stress_t *stress, int producers, int consumers)
+{
+    stress_thread_t threads[STRESS_PRODUCERS + STRESS_CONSUMERS];
+    atomic_init(&stress->consumed, 0);
+    stress->seen = calloc(STRESS_TOTAL, sizeof(_Atomic u8));
+    assert(stress->seen != NULL);
+
+    // NOTE(Alex): Producers that are not started still count as done, so the totals add up.
+    for (int p = producers; p < STRESS_PRODUCERS; p++) {
+        for (u32 seq = 0; seq < STRESS_PER_PRODUCER; seq++) {
+            atomic_init(&stress->seen[p * STRESS_PER_PRODUCER + seq], 1);
+        }
+        AWN_AtomicAdd(&stress->consumed, STRESS_PER_PRODUCER);
+    }
+
+    for (int i = 0; i < producers + consumers; i++) {
+        threads[i].stress = stress;
+        threads[i].id = (u32)i;
+        int created = pthread_create(&threads[i].thread, NULL, i < producers ? Stress_Producer : Stress_Consumer, &threads[i]);
+        assert(created == 0);
+    }
+
+    for (int i = 0; i < producers + consumers; i++) {
+        int joined = pthread_join(threads[i].thread, NULL);
+        assert(joined == 0);
+    }
+
+    assert(AWN_AtomicLoad(&stress->consumed) == STRESS_TOTAL);
+    for (usize i = 0; i < STRESS_TOTAL; i++) {
+        assert(AWN_AtomicLoad(&stress->seen[i]) == 1);
+    }
+
+    u64 leftover;
+    bool popped = Stress_Pop(stress, &leftover);
+    assert(!popped);
+    free(stress->seen);
+}
+
+void test_spsc_stress(void)
+{
+    arena_t arena = AWN_ArenaCreate(KB(64));
+    spsc_queue_t queue;
+    AWN_SpscInitFromArena(&queue, &arena, sizeof(u64), 256);
+
+    stress_t stress = { .queue = &queue, .mpmc = false };
+    Stress_Run(&stress, 1, 1);
+
+    AWN_ArenaFree(arena);
+}
+
+void test_mpmc_stress(void)
+{
+    arena_t arena = AWN_ArenaCreate(KB(64));
+    mpmc_queue_t queue;
+    AWN_MpmcInitFromArena(&queue, &arena, sizeof(u64), 256);
+
+    stress_t stress = { .queue = &queue, .mpmc = true };
+    Stress_Run(&stress, STRESS_PRODUCERS, STRESS_CONSUMERS);
+
+    AWN_ArenaFree(arena);
+}
+
+// NOTE(Alex): The writer fills every word with the same value, so a reader that got a mix of
+//              two writes sees words that disagree. The odd size covers the byte tail.
+#define SEQLOCK_WORDS 15
+#define SEQLOCK_READERS 3
+#define SEQLOCK_WRITES 200000
+
+STRUCT(seqlock_data_t)
+{
+    u64 words[SEQLOCK_WORDS];
+    u8 tail[5];
+};
+
+// NOTE(Alex): Without the padding after the tail.
+#define SEQLOCK_SIZE (offsetof(seqlock_data_t, tail) + 5)
+
+STRUCT(seqlock_test_t)
+{
+    seqlock_t lock;
+    seqlock_data_t data;
+    _Atomic bool done;
+};
+
+function void* Seqlock_Reader(void* data)
+{
+    seqlock_test_t* test = data;
+    u64 last = 0;
+
+    while (!AWN_AtomicLoadAcquire(&test->done)) {
+        seqlock_data_t copy;
+        AWN_SeqlockLoad(&test->lock, &copy, &test->data, SEQLOCK_SIZE);
+
+        for (int i = 1; i < SEQLOCK_WORDS; i++) {
+            assert(copy.words[i] == copy.words[0]);
+        }
+        for (int i = 0; i < (int)sizeof(copy.tail); i++) {
+            assert(copy.tail[i] == (u8)copy.words[0]);
+        }
+
+        // NOTE(Alex): Writes only count up, a reader never goes back in time.
+        assert(copy.words[0] >= last);
+        last = copy.words[0];
+    }
+
+    return NULL;
+}
+
+void test_seqlock_torn_reads(void)
+{
+    seqlock_test_t test;
+    memset(&test, 0, sizeof(test));
+    atomic_init(&test.lock.seq, 0);
+    atomic_init(&test.done, false);
+
+    pthread_t readers[SEQLOCK_READERS];
+    for (int i = 0; i < SEQLOCK_READERS; i++) {
+        int created = pthread_create(&readers[i], NULL, Seqlock_Reader, &test);
+        assert(created == 0);
+    }
+
+    for (u64 write = 1; write <= SEQLOCK_WRITES; write++) {
+        seqlock_data_t next;
+        for (int i = 0; i < SEQLOCK_WORDS; i++) {
+            next.words[i] = write;
+        }
+        memset(next.tail, (u8)write, sizeof(next.tail));
+        AWN_SeqlockStore(&test.lock, &test.data, &next, SEQLOCK_SIZE);
+    }
+
+    AWN_AtomicStoreRelease(&test.done, true);
+    for (int i = 0; i < SEQLOCK_READERS; i++) {
+        int joined = pthread_join(readers[i], NULL);
+        assert(joined == 0);
+    }
+
+    assert(test.data.words[0] == SEQLOCK_WRITES);
+}
+
+// NOTE(Alex): Every SIMD level has to agree with a plain loop, for every tail length from
+//              empty to past one AVX-512 vector and at every misalignment. The floats are small
+//              integers, so sums and dot products are exact no matter how the lanes add up.
+//              The buffers go on past the range with values that would change the answer, so a
+//              kernel that reads past its tail gets caught too.
+#define SIMD_MAX_COUNT 160
+#define SIMD_MAX_OFFSET 8
+#define SIMD_BUFFER_SIZE (SIMD_MAX_COUNT + SIMD_MAX_OFFSET + 64)
+
+global u32 simd_random_state = 12345;
+
+function u32 Simd_Random(void)
+{
+    simd_random_state = simd_random_state * 1664525u + 1013904223u;
+    return simd_random_state >> 8;
+}
+
+void test_simd_f32_matches_scalar(void)
+{
+    _Alignas(64) f32 a[SIMD_BUFFER_SIZE];
+    _Alignas(64) f32 b[SIMD_BUFFER_SIZE];
+    for (int i = 0; i < SIMD_BUFFER_SIZE; i++) {
+        a[i] = (f32)((int)(Simd_Random() % 17) - 8);
+        b[i] = (f32)((int)(Simd_Random() % 17) - 8);
+    }
+
+    simd_level_t best = AWN_SimdLevel();
+    for (simd_level_t level = AWN_SIMD_SCALAR; level <= best; level++) {
+        simd_level_t set = AWN_SimdSetLevel(level);
+        assert(set == level);
+
+        for (usize offset = 0; offset < SIMD_MAX_OFFSET; offset++) {
+            for (usize count = 0; count <= SIMD_MAX_COUNT; count++) {
+                f32 sum = 0;
+                f32 dot = 0;
+                for (usize i = 0; i < count; i++) {
+                    sum += a[offset + i];
+                    dot += a[offset + i] * b[offset + i];
+                }
+
+                assert(AWN_SumF32(a + offset, count) == sum);
+                assert(AWN_DotF32(a + offset, b + offset, count) == dot);
+            }
+        }
+    }
+
+    AWN_SimdSetLevel(best);
+}
+
+void test_simd_bytes_match_scalar(void)
+{
+    _Alignas(64) u8 data[SIMD_BUFFER_SIZE];
+    for (int i = 0; i < SIMD_BUFFER_SIZE; i++) {
+        data[i] = (u8)(Simd_Random() % 4);
+    }
+
+    simd_level_t best = AWN_SimdLevel();
+    for (simd_level_t level = AWN_SIMD_SCALAR; level <= best; level++) {
+        simd_level_t set = AWN_SimdSetLevel(level);
+        assert(set == level);
+
+        for (usize offset = 0; offset < SIMD_MAX_OFFSET; offset++) {
+            u8* start = data + offset;
+
+            for (usize size = 0; size <= SIMD_MAX_COUNT; size++) {
+                // NOTE(Alex): 0 to 3 occur all over, 0xff never does.
+                for (int needle = 0; needle < 4; needle++) {
+                    usize first = size;
+                    usize count = 0;
+                    for (usize i = 0; i < size; i++) {
+                        if (start[i] == needle) {
+                            first = first == size ? i : first;
+                            count++;
+                        }
+                    }
+
+                    assert(AWN_FindByte(start, size, (u8)needle) == first);
+                    assert(AWN_CountByte(start, size, (u8)needle) == count);
+                }
+
+                assert(AWN_FindByte(start, size, 0xff) == size);
+                assert(AWN_CountByte(start, size, 0xff) == 0);
+
+                // NOTE(Alex): A needle only at the last byte, and one right past the end.
+                if (size > 0) {
+                    u8 saved = start[size - 1];
+                    start[size - 1] = 0xff;
+                    assert(AWN_FindByte(start, size, 0xff) == size - 1);
+                    assert(AWN_CountByte(start, size, 0xff) == 1);
+                    start[size - 1] = saved;
+                }
+
+                u8 saved = start[size];
+                start[size] = 0xff;
+                assert(AWN_FindByte(start, size, 0xff) == size);
+                assert(AWN_CountByte(start, size, 0xff) == 0);
+                start[size] = saved;
+            }
+        }
+    }
+
+    AWN_SimdSetLevel(best);
+}
+
+// NOTE(Alex): A line far longer than the reader's buffer comes back whole, CR before LF is
+//              dropped, and a last line without a newline still counts.
+#define LINE_LONG_SIZE KB(100)
+
+void test_line_reader_long_lines_and_crlf(void)
+{
+    char path[] = "/tmp/awn-lines-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+
+    char* long_line = malloc(LINE_LONG_SIZE);
+    assert(long_line != NULL);
+    memset(long_line, 'a', LINE_LONG_SIZE);
+
+    FILE* file = fdopen(fd, "w");
+    assert(file != NULL);
+    fputs("short\r\n", file);
+    fwrite(long_line, 1, LINE_LONG_SIZE, file);
+    fputs("\ncrlf\r\n\r\n\nlast", file);
+    int closed = fclose(file);
+    assert(closed == 0);
+
+    line_reader_t reader;
+    bool opened = AWN_LineReaderOpen(&reader, path, 16);
+    unlink(path);
+    assert(opened);
+
+    const char* expected[] = { "short", NULL, "crlf", "", "", "last" };
+    str_t line;
+
+    for (usize i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        bool read = AWN_LineReaderNext(&reader, &line);
+        assert(read);
+
+        if (expected[i] == NULL) {
+            assert(line.size == LINE_LONG_SIZE and memcmp(line.data, long_line, LINE_LONG_SIZE) == 0);
+        } else {
+            assert(AWN_StrEq(line, AWN_Str(expected[i])));
+        }
+    }
+
+    bool more = AWN_LineReaderNext(&reader, &line);
+    assert(!more);
+    assert(reader.error == 0);
+
+    AWN_LineReaderClose(&reader);
+    free(long_line);
+}
+
+// NOTE(Alex): More files than fit in one batch, in sizes from empty to larger than the usual
+//              buffer, plus one that does not exist. Each byte depends on the file and its
+//              offset, so a read landing in the wrong buffer or at the wrong offset shows up.
+#define BATCH_FILES 150
+#define BATCH_MISSING 77
+
+function usize Batch_FileSize(usize index)
+{
+    return index % 10 == 0 ? 0 : (index * 997) % KB(300);
+}
+
+function u8 Batch_Byte(usize index, usize offset)
+{
+    return (u8)(index * 31 + offset * 7);
+}
+
+function void Batch_Run(void)
+{
+    char dir[] = "/tmp/awn-batch-XXXXXX";
+    char* created = mkdtemp(dir);
+    assert(created != NULL);
+
+    arena_t arena = AWN_ArenaCreate(KB(64));
+    file_read_t reads[BATCH_FILES];
+    u8* contents = malloc(KB(300));
+    assert(contents != NULL);
+
+    for (usize i = 0; i < BATCH_FILES; i++) {
+        reads[i].path = AWN_ArenaPush(&arena, 64);
+        snprintf((char*)reads[i].path, 64, "%s/file_%zu", dir, i);
+        if (i == BATCH_MISSING) {
+            continue;
+        }
+
+        for (usize offset = 0; offset < Batch_FileSize(i); offset++) {
+            contents[offset] = Batch_Byte(i, offset);
+        }
+
+        FILE* file = fopen(reads[i].path, "w");
+        assert(file != NULL);
+        usize written = fwrite(contents, 1, Batch_FileSize(i), file);
+        int closed = fclose(file);
+        assert(written == Batch_FileSize(i) and closed == 0);
+    }
+
+    usize succeeded = AWN_FileReadBatch(&arena, reads, BATCH_FILES);
+    assert(succeeded == BATCH_FILES - 1);
+
+    for (usize i = 0; i < BATCH_FILES; i++) {
+        if (i == BATCH_MISSING) {
+            assert(reads[i].error == ENOENT and reads[i].data.data == NULL);
+            continue;
+        }
+
+        assert(reads[i].error == 0 and reads[i].data.data != NULL);
+        assert(reads[i].data.size == Batch_FileSize(i));
+        assert(reads[i].data.data[reads[i].data.size] == '\0');
+        for (usize offset = 0; offset < reads[i].data.size; offset++) {
+            assert((u8)reads[i].data.data[offset] == Batch_Byte(i, offset));
+        }
+
+        unlink(reads[i].path);
+    }
+
+    rmdir(dir);
+    free(contents);
+    AWN_ArenaFree(arena);
+}
+
+// NOTE(Alex): Every test runs in its own process, so the io_uring decision is made fresh here.
+//              Without io_uring (old kernel, seccomp) this takes the pread path too.
+void test_file_read_batch_uring(void)
+{
+    unsetenv("AWN_NO_IO_URING");
+    Batch_Run();
+}
+
+void test_file_read_batch_pread(void)
+{
+    setenv("AWN_NO_IO_URING", "1", 1);
+    bool uring = AWN_FileReadBatchUsesUring();
+    assert(!uring);
+    Batch_Run();
+}
+
+// NOTE(Alex): Event loop. Sleepers wake in deadline order and never early, a read nobody answers
+//              times out, one that gets data in time does not, and a connect to a closed port
+//              reports the refusal instead of hanging.
+STRUCT(sleeper_t)
+{
+    i64 ms;
+    u64 started;
+    i64* order;
+    int* woken;
+};
+
+function int Sleeper_Run(loop_t *loop, task_t *task)
+{
+    sleeper_t* sleeper = task->locals;
+    AWN_TASK_BEGIN(task);
+    sleeper->started = AWN_LoopNow(loop);
+    AWN_TASK_SLEEP(loop, task, sleeper->ms);
+    assert(AWN_LoopNow(loop) >= sleeper->started + (u64)sleeper->ms);
+    sleeper->order[(*sleeper->woken)++] = sleeper->ms;
+    AWN_TASK_END(task);
+}
+
+void test_loop_timers(void)
+{
+    loop_t loop;
+    bool initialized = AWN_LoopInit(&loop);
+    assert(initialized);
+
+    i64 delays[] = { 30, 10, 20, 0 };
+    i64 order[4] = { 0 };
+    int woken = 0;
+
+    for (int i = 0; i < 4; i++) {
+        task_t* task = AWN_LoopSpawn(&loop, Sleeper_Run, sizeof(sleeper_t), 0);
+        sleeper_t* sleeper = task->locals;
+        sleeper->ms = delays[i];
+        sleeper->order = order;
+        sleeper->woken = &woken;
+    }
+
+    bool ran = AWN_LoopRun(&loop);
+    assert(ran);
+    assert(woken == 4);
+    assert(order[0] == 0 and order[1] == 10 and order[2] == 20 and order[3] == 30);
+
+    AWN_LoopFree(&loop);
+}
+
+STRUCT(pipe_task_t)
+{
+    int fd;
+    i64 timeout_ms;
+    i64 delay_ms;
+    char buffer[16];
+    u64 started;
+    i64 result;
+    u64 elapsed;
+};
+
+function int PipeReader_Run(loop_t *loop, task_t *task)
+{
+    pipe_task_t* reader = task->locals;
+    AWN_TASK_BEGIN(task);
+    reader->started = AWN_LoopNow(loop);
+    AWN_TASK_READ(loop, task, reader->fd, reader->buffer, sizeof(reader->buffer), reader->timeout_ms);
+    reader->result = task->result;
+    reader->elapsed = AWN_LoopNow(loop) - reader->started;
+    AWN_TASK_END(task);
+}
+
+function int PipeWriter_Run(loop_t *loop, task_t *task)
+{
+    pipe_task_t* writer = task->locals;
+    AWN_TASK_BEGIN(task);
+    AWN_TASK_SLEEP(loop, task, writer->delay_ms);
+    AWN_TASK_WRITE(loop, task, writer->fd, "ping", 4, 1000);
+    writer->result = task->result;
+    AWN_TASK_END(task);
+}
+
+void test_loop_read_timeout(void)
+{
+    loop_t loop;
+    bool initialized = AWN_LoopInit(&loop);
+    assert(initialized);
+
+    int silent[2];
+    int talking[2];
+    int opened = pipe(silent) | pipe(talking);
+    assert(opened == 0);
+    for (int i = 0; i < 2; i++) {
+        AWN_SocketNonBlocking(silent[i]);
+        AWN_SocketNonBlocking(talking[i]);
+    }
+
+    task_t* timed_out = AWN_LoopSpawn(&loop, PipeReader_Run, sizeof(pipe_task_t), 0);
+    pipe_task_t* timed_out_reader = timed_out->locals;
+    *timed_out_reader = (pipe_task_t){ .fd = silent[0], .timeout_ms = 40 };
+
+    task_t* answered = AWN_LoopSpawn(&loop, PipeReader_Run, sizeof(pipe_task_t), 0);
+    pipe_task_t* answered_reader = answered->locals;
+    *answered_reader = (pipe_task_t){ .fd = talking[0], .timeout_ms = 5000 };
+
+    task_t* writer_task = AWN_LoopSpawn(&loop, PipeWriter_Run, sizeof(pipe_task_t), 0);
+    pipe_task_t* writer = writer_task->locals;
+    *writer = (pipe_task_t){ .fd = talking[1], .delay_ms = 10 };
+
+    bool ran = AWN_LoopRun(&loop);
+    assert(ran);
+
+    assert(timed_out_reader->result == -ETIMEDOUT);
+    assert(timed_out_reader->elapsed >= 40);
+
+    assert(writer->result == 4);
+    assert(answered_reader->result == 4 and memcmp(answered_reader->buffer, "ping", 4) == 0);
+    assert(answered_reader->elapsed < 5000);
+
+    for (int i = 0; i < 2; i++) {
+        close(silent[i]);
+        close(talking[i]);
+    }
+    AWN_LoopFree(&loop);
+}
+
+STRUCT(connector_t)
+{
+    u16 port;
+    int fd;
+    i64 result;
+};
+
+function int Connector_Run(loop_t *loop, task_t *task)
+{
+    connector_t* connector = task->locals;
+    AWN_TASK_BEGIN(task);
+    connector->fd = AWN_TcpConnectStart("127.0.0.1", connector->port);
+
+    // NOTE(Alex): Loopback may refuse right away, then there is nothing to wait for.
+    if (connector->fd < 0) {
+        connector->result = -(i64)errno;
+        return AWN_TASK_DONE;
+    }
+
+    AWN_TASK_CONNECT(loop, task, connector->fd, 1000);
+    connector->result = task->result;
+    AWN_TaskClose(loop, task, connector->fd);
+    AWN_TASK_END(task);
+}
+
+void test_loop_connect_refused(void)
+{
+    // NOTE(Alex): Bind a free port and close it again, so nobody is listening there.
+    int listener = AWN_TcpListen("127.0.0.1", 0, 1);
+    assert(listener >= 0);
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int named = getsockname(listener, (struct sockaddr*)&address, &length);
+    assert(named == 0);
+    close(listener);
+
+    loop_t loop;
+    bool initialized = AWN_LoopInit(&loop);
+    assert(initialized);
+
+    task_t* task = AWN_LoopSpawn(&loop, Connector_Run, sizeof(connector_t), 0);
+    connector_t* connector = task->locals;
+    connector->port = ntohs(address.sin_port);
+
+    bool ran = AWN_LoopRun(&loop);
+    assert(ran);
+    assert(connector->result == -ECONNREFUSED);
+
+    AWN_LoopFree(&loop);
+}
@@ -0,0 +1,159 @@
+#include "../src/awn.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// NOTE(Alex): Aguilar's own main, renamed by `aguilar test`.
+int main_src_aguilar(int argc, char** argv);
+
+// NOTE(Alex): A few hundred sources in one target push the build graph far past the first
+//              block of the main arena. This used to read freed memory once the arena grew.
+//              The names are long enough that the link line is past MAX_ARG_STRLEN (128 KB),
+//              the most a single exec argument (like the one `sh -c` gets) may hold.
+#define LARGE_PROJECT_FILES 600
+#define LARGE_PROJECT_NAME_PADDING 200
+
+function void Test_WriteFile(const char* path, const char* contents)
+{
+    FILE* file = fopen(path, "w");
+    assert(file != NULL);
+    fputs(contents, file);
+
+    int closed = fclose(file);
+    assert(closed == 0);
+}
+
+// NOTE(Alex): Runs body in a child inside a fresh temporary directory, and removes the directory
+//              before checking anything, so a failed assert never leaves it behind. Whatever
+//              the child wrote to stdout is copied into output.
+function void Test_RunInTempDir(void (*body)(void), char* output, usize output_size)
+{
+    char dir[] = "/tmp/aguilar-test-XXXXXX";
+    char* created = mkdtemp(dir);
+    assert(created != NULL);
+
+    char output_path[64];
+    snprintf(output_path, sizeof(output_path), "%s/stdout.txt", dir);
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        int entered = chdir(dir);
+        assert(entered == 0);
+
+        setenv("HOME", dir, 1);
+        setenv("AGUILAR_NO_DAEMON", "1", 1);
+        unsetenv("AGUILAR_WORKERS");
+        unsetenv("AGUILAR_CACHE_DIR");
+
+        FILE* redirected = freopen(output_path, "w", stdout);
+        assert(redirected != NULL);
+
+        body();
+        fflush(stdout);
+        _exit(0);
+    }
+
+    int status = 0;
+    pid_t waited = waitpid(pid, &status, 0);
+
+    usize output_length = 0;
+    FILE* file = fopen(output_path, "r");
+    if (file != NULL) {
+        output_length = fread(output, 1, output_size - 1, file);
+        fclose(file);
+    }
+    output[output_length] = '\0';
+
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    int removed = system(command);
+
+    assert(waited == pid);
+    assert(WIFEXITED(status) and WEXITSTATUS(status) == 0);
+    assert(removed == 0);
+}
+
+function void Test_BuildLargeProject(void)
+{
+    int made = mkdir("src", 0755);
+    assert(made == 0);
+
+    char padding[LARGE_PROJECT_NAME_PADDING + 1];
+    memset(padding, 'x', LARGE_PROJECT_NAME_PADDING);
+    padding[LARGE_PROJECT_NAME_PADDING] = '\0';
+
+    for (int i = 0; i < LARGE_PROJECT_FILES; i++) {
+        char path[512];
+        char contents[128];
+        snprintf(path, sizeof(path), "src/file_%d_%s.c", i, padding);
+        snprintf(contents, sizeof(contents), "int file_%d(void) { return %d; }\n", i, i);
+        Test_WriteFile(path, contents);
+    }
+
+    char main_source[256];
+    snprintf(main_source, sizeof(main_source), "int file_%d(void);\nint main(void) { return file_%d() == %d ? 0 : 1; }\n",
+             LARGE_PROJECT_FILES - 1, LARGE_PROJECT_FILES - 1, LARGE_PROJECT_FILES - 1);
+    Test_WriteFile("src/main.c", main_source);
+    Test_WriteFile(".aguilar", "flags: -O0\nexe: large; src\n");
+
+    char* argv[] = { "aguilar", "build", NULL };
+    int result = main_src_aguilar(2, argv);
+    assert(result == 0);
+
+    assert(access("large", X_OK) == 0);
+    int ran = system("./large");
+    assert(ran == 0);
+}
+
+void test_large_project_build(void)
+{
+    char output[4096];
+    Test_RunInTempDir(Test_BuildLargeProject, output, sizeof(output));
+}
+
+// NOTE(Alex): Tests are found line by line. A line longer than the old 1024 byte buffer used to
+//              be split, so its tail was read as the start of a line, and CRLF files are common.
+function void Test_ListTests(void)
+{
+    int made = mkdir("tests", 0755);
+    assert(made == 0);
+
+    char* long_line = malloc(KB(64));
+    assert(long_line != NULL);
+    memset(long_line, 'x', KB(64) - 1);
+    long_line[KB(64) - 1] = '\0';
+    // NOTE(Alex): After "// " this starts at byte 1023, where fgets into 1024 bytes cut the line.
+    memcpy(long_line + 1020, "void test_split(void) {}", 24);
+
+    FILE* file = fopen("tests/list_test.c", "w");
+    assert(file != NULL);
+    fprintf(file, "// %s\n", long_line);
+    fprintf(file, "void test_crlf(void)\r\n{\r\n}\r\n");
+    fprintf(file, "void test_after_long(void) {}\n");
+    fprintf(file, "/* %s */\n", long_line);
+    fprintf(file, "void test_last_line(void) {}");
+    int closed = fclose(file);
+    assert(closed == 0);
+    free(long_line);
+
+    char* argv[] = { "aguilar", "test", "--list", NULL };
+    int result = main_src_aguilar(3, argv);
+    assert(result == 0);
+}
+
+void test_find_tests_long_lines_and_crlf(void)
+{
+    char output[KB(16)];
+    Test_RunInTempDir(Test_ListTests, output, sizeof(output));
+
+    assert(strstr(output, "test_crlf (tests/list_test.c)\n") != NULL);
+    assert(strstr(output, "test_after_long (tests/list_test.c)\n") != NULL);
+    assert(strstr(output, "test_last_line (tests/list_test.c)\n") != NULL);
+    assert(strstr(output, "test_split") == NULL);
+}